@@ -18,9 +18,8 @@
 #include "omnibook.h"
 #include "hardware.h"
 
-static int omnibook_ac_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_ac_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	u8 ac;
 	int retval;
 
@@ -28,9 +27,9 @@ static int omnibook_ac_read(char *buffer, struct omnibook_operation *io_op)
 	if (retval < 0)
 		return retval;
 
-	len += sprintf(buffer + len, "AC %s\n", (!!ac) ? "on-line" : "off-line");
+	seq_printf(m, "AC %s\n", (!!ac) ? "on-line" : "off-line");
 
-	return len;
+	return 0;
 }
 
 static struct omnibook_tbl ac_table[] __initdata = {
@@ -42,6 +41,17 @@ static struct omnibook_tbl ac_table[] __initdata = {
 	{0,}
 };
 
+static int omnibook_ac_telemetry(struct omnibook_telemetry *t, struct omnibook_operation *io_op)
+{
+	u8 ac;
+
+	if (__backend_byte_read(io_op, &ac))
+		return -EIO;
+	t->ac = !!ac;
+	t->valid |= OMNIBOOK_TM_AC;
+	return 0;
+}
+
 static struct omnibook_feature __declared_feature ac_driver = {
 	.name = "ac",
 #ifdef CONFIG_OMNIBOOK_LEGACY
@@ -50,6 +60,7 @@ static struct omnibook_feature __declared_feature ac_driver = {
 	.enabled = 0,
 #endif
 	.read = omnibook_ac_read,
+	.telemetry = omnibook_ac_telemetry,
 	.ectypes = XE3GF | XE3GC | OB500 | OB510 | OB6000 | OB6100 | XE4500 | OB4150 | XE2 | AMILOD | TSP10 | TSM70 | TSM30X,
 	.tbl = ac_table,
 };
@@ -375,6 +375,8 @@ static int omnibook_acpi_execute(acpi_handle dev_handle, char *method, const int
 	struct acpi_object_list args_list;
 	struct acpi_buffer buff;
 	union acpi_object arg, out_objs[1];
+	acpi_status status;
+	ktime_t start;
 	
 	if (param) {
 		args_list.count = 1;
@@ -387,7 +389,13 @@ static int omnibook_acpi_execute(acpi_handle dev_handle, char *method, const int
 	buff.length = sizeof(out_objs);
 	buff.pointer = out_objs;
 
-	if (acpi_evaluate_object(dev_handle, method, &args_list, &buff) != AE_OK) {
+	start = ktime_get();
+	status = acpi_evaluate_object(dev_handle, method, &args_list, &buff);
+	omnibook_histogram_add(&acpi_backend, OMNIBOOK_HIST_ACPI, start);
+	if (unlikely(omnibook_recording))
+		__omnibook_record(&acpi_backend, OMNIBOOK_REC_ACPI, omnibook_record_name(method),
+				  param ? *param : 0, status == AE_OK ? 0 : -EIO, start);
+	if (status != AE_OK) {
 		printk(O_ERR "ACPI method execution failed\n");
 		return -EIO;
 	}
@@ -423,7 +431,7 @@ static int omnibook_acpi_init(const struct omnibook_operation *io_op)
 	if (!io_op->backend->data) {
 		dprintk("Try to init ACPI backend\n");
 		mutex_init(&io_op->backend->mutex);
-		mutex_lock(&io_op->backend->mutex);
+		omnibook_backend_lock(io_op->backend, "init");
 		kref_init(&io_op->backend->kref);
 		priv_data = kzalloc(sizeof(struct acpi_backend_data), GFP_KERNEL);
 		if (!priv_data) {
@@ -498,7 +506,7 @@ static int omnibook_acpi_init(const struct omnibook_operation *io_op)
 
 		io_op->backend->data = (void *) priv_data;
 		
-		mutex_unlock(&io_op->backend->mutex);
+		omnibook_backend_unlock(io_op->backend);
 		
 		/* attempt to register Toshiba bluetooth ACPI driver */
 		acpi_bus_register_driver(&omnibook_bt_driver);
@@ -517,7 +525,7 @@ static int omnibook_acpi_init(const struct omnibook_operation *io_op)
 	kfree(priv_data);
 	io_op->backend->data = NULL;
 	error0:
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_backend_unlock(io_op->backend);
 	mutex_destroy(&io_op->backend->mutex);
 	return retval;
 }
@@ -540,10 +548,10 @@ static void omnibook_acpi_free(struct kref *ref)
 	input_unregister_handler(&hook_handler);
 	input_unregister_device(priv_data->acpi_input_dev);
 	
-	mutex_lock(&backend->mutex);
+	omnibook_backend_lock(backend, "exit");
 	kfree(backend->data);
 	backend->data = NULL;
-	mutex_unlock(&backend->mutex);
+	omnibook_backend_unlock(backend);
 	mutex_destroy(&backend->mutex);
 }
 
@@ -565,6 +573,7 @@ static acpi_status hci_raw(const u32 in[HCI_WORDS], u32 out[HCI_WORDS])
 	struct acpi_buffer results;
 	union acpi_object out_objs[HCI_WORDS + 1];
 	acpi_status status;
+	ktime_t start;
 	int i;
 
 	params.count = HCI_WORDS;
@@ -577,8 +586,13 @@ static acpi_status hci_raw(const u32 in[HCI_WORDS], u32 out[HCI_WORDS])
 	results.length = sizeof(out_objs);
 	results.pointer = out_objs;
 
+	start = ktime_get();
 	status = acpi_evaluate_object(priv_data->hci_handle, (char *)HCI_METHOD, &params,
 				      &results);
+	omnibook_histogram_add(&acpi_backend, OMNIBOOK_HIST_ACPI, start);
+	if (unlikely(omnibook_recording))
+		__omnibook_record(&acpi_backend, OMNIBOOK_REC_ACPI, omnibook_record_name(HCI_METHOD),
+				  in[1], status == AE_OK ? 0 : -EIO, start);
 	if ((status == AE_OK) && (out_objs->package.count <= HCI_WORDS)) {
 		for (i = 0; i < out_objs->package.count; ++i) {
 			out[i] = out_objs->package.elements[i].integer.value;
@@ -625,10 +639,10 @@ static int omnibook_acpi_bt_add(struct acpi_device *device)
 
 	/* Save handle in backend private data structure. ugly. */
 
-	mutex_lock(&acpi_backend.mutex);
+	omnibook_backend_lock(&acpi_backend, "bluetooth");
 	priv_data->bt_handle = device->handle;
 	retval = set_bt_status(priv_data, 1);
-	mutex_unlock(&acpi_backend.mutex);
+	omnibook_backend_unlock(&acpi_backend);
 
 	return retval;
 }
@@ -638,11 +652,11 @@ static int omnibook_acpi_bt_remove(struct acpi_device *device, int type)
 	int retval;
 	struct acpi_backend_data *priv_data = acpi_backend.data;
 
-	mutex_lock(&acpi_backend.mutex);
+	omnibook_backend_lock(&acpi_backend, "bluetooth");
 	dprintk("Disabling Toshiba Bluetooth ACPI device.\n");
 	retval = set_bt_status(priv_data, 0);
 	priv_data->bt_handle = NULL;
-	mutex_unlock(&acpi_backend.mutex);
+	omnibook_backend_unlock(&acpi_backend);
 	
 	return retval;
 }
@@ -768,7 +782,7 @@ static int set_tsx205_wireless_status(const struct acpi_backend_data *priv_data,
 	raw_state |= !!(state & BT_STA) << 0x1;	/* bit 1 */
 
 	/* BT status */
-	retval = set_bt_status(priv_data->bt_handle, state);
+	retval = set_bt_status(priv_data, state & BT_STA);
 
 	return retval;
 }
@@ -980,12 +994,12 @@ static int omnibook_acpi_get_throttle(const struct omnibook_operation *io_op, un
 static int omnibook_acpi_set_throttle(const struct omnibook_operation *io_op, unsigned int state)
 {
 	struct acpi_backend_data *priv_data = io_op->backend->data;
+	int param;
 	/* THTL_DTY and ACPI T-state are reverse mapped */
 	/* throttling.c already clamped state between 0 and 7 */
-	if (state) 
-		state = 8 - state;
+	param = state ? 8 - state : 0;
 
-	return omnibook_acpi_execute(priv_data->ec_handle, SET_THROTTLE_METHOD, &state, NULL);
+	return omnibook_acpi_execute(priv_data->ec_handle, SET_THROTTLE_METHOD, &param, NULL);
 }
 
 /*
@@ -1036,7 +1050,7 @@ static int omnibook_acpi_get_events(unsigned int *state)
 	}
 
 	/* Now we can poll the INFO method to get last pressed hotkey */
-	status = omnibook_acpi_execute(priv_data->hci_handle, TSX205_EVENTS_METHOD, NULL, state);
+	status = omnibook_acpi_execute(priv_data->hci_handle, TSX205_EVENTS_METHOD, NULL, (int *) state);
 	if (status != AE_OK) {
 		dprintk(O_ERR "Failed to get Hotkey event.\n");
 		return -EIO;
@@ -1051,24 +1065,17 @@ static int omnibook_acpi_get_events(unsigned int *state)
 
 /*
  * Adjust the lcd backlight level by delta.
- * Used for Fn+F6/F7 keypress
+ * Used for Fn+F6/F7 keypress, run from the backend request queue so the
+ * Fn key handler never waits for the hardware.
  */
-static int adjust_brighness(int delta)
+static int adjust_brighness_request(struct omnibook_request *req)
 {
-	struct omnibook_feature *lcd_feature = omnibook_find_feature("lcd");
-	struct omnibook_operation *io_op;
+	int delta = (long) req->context;
 	int retval = 0;
 	u8 brgt;
 
-	if(!lcd_feature)
-		return -ENODEV;
-
-	io_op = lcd_feature->io_op;
-
-	mutex_lock(&io_op->backend->mutex);
-
-	if(( retval = __backend_byte_read(io_op, &brgt)))
-		goto out;	
+	if(( retval = __backend_byte_read(req->io_op, &brgt)))
+		return retval;
 
 	dprintk("Fn-F6/F7 pressed: adjusting brightness.\n");
 
@@ -1079,10 +1086,27 @@ static int adjust_brighness(int delta)
 	else
 		brgt += delta;
 
-	retval = __backend_byte_write(io_op, brgt);
+	return __backend_byte_write(req->io_op, brgt);
+}
+
+static int adjust_brighness(int delta)
+{
+	struct omnibook_feature *lcd_feature = omnibook_find_feature("lcd");
+	struct omnibook_request *req;
+	int retval;
 
-	out:
-	mutex_unlock(&io_op->backend->mutex);
+	if(!lcd_feature)
+		return -ENODEV;
+
+	req = omnibook_request_alloc(OMNIBOOK_REQ_FUNC, lcd_feature->io_op, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+	req->func = adjust_brighness_request;
+	req->context = (void *) (long) delta;
+
+	retval = omnibook_request_submit(req);
+	if (retval)
+		kfree(req);
 	return retval;
 }
 
@@ -1096,6 +1120,7 @@ static void omnibook_handle_fnkey(void* data)
 #endif
 {
 	int i;
+	unsigned int keycode = 0;
 	u32 gen_scan;
 	struct input_dev *input_dev;
 	acpi_status status;
@@ -1123,9 +1148,12 @@ static void omnibook_handle_fnkey(void* data)
 			input_dev = ((struct acpi_backend_data *) data)->acpi_input_dev;
 #endif
 			omnibook_report_key(input_dev, acpi_scan_table[i].keycode);
+			keycode = acpi_scan_table[i].keycode;
 			break;
 		}
 	}
+
+	omnibook_event_raise(OMNIBOOK_EV_FNKEY, gen_scan, keycode);
 }
 
 struct omnibook_backend acpi_backend = {
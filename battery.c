@@ -43,26 +43,25 @@ enum {
 
 #define BAT_OFFSET 0x10
 
-static int __backend_u16_read(struct omnibook_operation *io_op, u16 *data)
-{
-	int retval;
-	u8 byte;
+/*
+ * Battery registers are read by contiguous blocks, from first to last
+ * (included) of battery num, into regs in one backend transaction.
+ * Backend mutex held.
+ */
+#define BAT_BLOCK_READ(io_op, first, last, num, regs) \
+	__backend_block_read(io_op, (first) + (BAT_OFFSET * (num)), regs, (last) - (first) + 1)
 
-	retval = __backend_byte_read(io_op, &byte);
-	if (retval)
-		return retval;
-	*data = byte;
-	io_op->read_addr += 1;
-	retval = __backend_byte_read(io_op, &byte);
-	*data += (byte << 8);
-	return retval;
-}
+/* Little endian 16 bit value at register reg of a block starting at first */
+#define BAT_U16(regs, first, reg) ((regs)[(reg) - (first)] | ((regs)[(reg) - (first) + 1] << 8))
+#define BAT_U8(regs, first, reg) ((regs)[(reg) - (first)])
 
 static int omnibook_battery_present(struct omnibook_operation *io_op, int num)
 {
+	struct omnibook_operation op = *io_op;
 	int retval;
-	u8 bat;
-	int i;
+	u8 bat, mask;
+
+	op.read_mask = 0;
 
 	/*
 	 * XE3GF
@@ -71,28 +70,24 @@ static int omnibook_battery_present(struct omnibook_operation *io_op, int num)
 	 * TSM70
 	 */
 	if (omnibook_ectype & (XE3GF | TSP10 | TSM70 | TSM30X)) {
-		io_op->read_addr = XE3GF_BAL;
-		io_op->read_mask = XE3GF_BAL0_MASK;
-		for (i = 0; i < num; i++)
-			io_op->read_mask = io_op->read_mask << 1;
-		retval = __backend_byte_read(io_op, &bat);
+		op.read_addr = XE3GF_BAL;
+		retval = __backend_byte_read(&op, &bat);
+		mask = XE3GF_BAL0_MASK << num;
 	/*
 	 * XE3GC
 	 * AMILOD
 	 */
 	} else if (omnibook_ectype & (XE3GC | AMILOD)) {
-		io_op->read_addr = XE3GC_BAT;
-		io_op->read_mask = XE3GC_BAT0_MASK;
-		for (i = 0; i < num; i++)
-			io_op->read_mask = io_op->read_mask << 1;
-		retval = __backend_byte_read(io_op, &bat);
+		op.read_addr = XE3GC_BAT;
+		retval = __backend_byte_read(&op, &bat);
+		mask = XE3GC_BAT0_MASK << num;
 	} else
 		retval = -ENODEV;
 
-	/* restore default read_mask */
-	io_op->read_mask = 0;
+	if (retval)
+		return retval;
 
-	return !!bat;
+	return !!(bat & mask);
 }
 
 /*
@@ -110,6 +105,7 @@ static int omnibook_get_battery_info(struct omnibook_operation *io_op,
 				     struct omnibook_battery_info *battinfo)
 {
 	int retval;
+	u8 regs[BAT_OFFSET];
 	/*
 	 * XE3GF
 	 * TSP10
@@ -121,18 +117,12 @@ static int omnibook_get_battery_info(struct omnibook_operation *io_op,
 		if (retval < 0)
 			return retval;
 		if (retval) {
-			io_op->read_addr = XE3GF_BTY0 + (BAT_OFFSET * num);
-			if ((retval = __backend_byte_read(io_op, &(*battinfo).type)))
-				return retval;
-			io_op->read_addr = XE3GF_BSN0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battinfo).sn)))
-				return retval;
-			io_op->read_addr = XE3GF_BDV0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battinfo).dv)))
-				return retval;
-			io_op->read_addr = XE3GF_BDC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battinfo).dc)))
+			if ((retval = BAT_BLOCK_READ(io_op, XE3GF_BTY0, XE3GF_BDC0 + 1, num, regs)))
 				return retval;
+			(*battinfo).type = BAT_U8(regs, XE3GF_BTY0, XE3GF_BTY0);
+			(*battinfo).sn = BAT_U16(regs, XE3GF_BTY0, XE3GF_BSN0);
+			(*battinfo).dv = BAT_U16(regs, XE3GF_BTY0, XE3GF_BDV0);
+			(*battinfo).dc = BAT_U16(regs, XE3GF_BTY0, XE3GF_BDC0);
 
 			(*battinfo).type = ((*battinfo).type & XE3GF_BTY_MASK) ? 1 : 0;
 		} else
@@ -145,15 +135,11 @@ static int omnibook_get_battery_info(struct omnibook_operation *io_op,
 		if (retval < 0)
 			return retval;
 		if (retval) {
-			io_op->read_addr = XE3GC_BDV0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battinfo).dv)))
-				return retval;
-			io_op->read_addr = XE3GC_BDC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battinfo).dc)))
-				return retval;
-			io_op->read_addr = XE3GC_BTY0 + (BAT_OFFSET * num);
-			if ((retval = __backend_byte_read(io_op, &(*battinfo).type)))
+			if ((retval = BAT_BLOCK_READ(io_op, XE3GC_BDV0, XE3GC_BTY0, num, regs)))
 				return retval;
+			(*battinfo).dv = BAT_U16(regs, XE3GC_BDV0, XE3GC_BDV0);
+			(*battinfo).dc = BAT_U16(regs, XE3GC_BDV0, XE3GC_BDC0);
+			(*battinfo).type = BAT_U8(regs, XE3GC_BDV0, XE3GC_BTY0);
 
 			(*battinfo).type = ((*battinfo).type & XE3GC_BTY_MASK) ? 1 : 0;
 			(*battinfo).sn = 0;	/* Unknown */
@@ -167,15 +153,11 @@ static int omnibook_get_battery_info(struct omnibook_operation *io_op,
 		if (retval < 0)
 			return retval;
 		if (retval) {
-			io_op->read_addr = AMILOD_BDV0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battinfo).dv)))
-				return retval;
-			io_op->read_addr = AMILOD_BDC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battinfo).dc)))
-				return retval;
-			io_op->read_addr = AMILOD_BTY0 + (BAT_OFFSET * num);
-			if ((retval = __backend_byte_read(io_op, &(*battinfo).type)))
+			if ((retval = BAT_BLOCK_READ(io_op, AMILOD_BDC0, AMILOD_BTY0, num, regs)))
 				return retval;
+			(*battinfo).dc = BAT_U16(regs, AMILOD_BDC0, AMILOD_BDC0);
+			(*battinfo).dv = BAT_U16(regs, AMILOD_BDC0, AMILOD_BDV0);
+			(*battinfo).type = BAT_U8(regs, AMILOD_BDC0, AMILOD_BTY0);
 
 			(*battinfo).type = ((*battinfo).type & AMILOD_BTY_MASK) ? 1 : 0;
 			(*battinfo).sn = 0;	/* Unknown */
@@ -230,6 +212,7 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 	u8 status;
 	u16 dc;
 	int gauge;
+	u8 regs[BAT_OFFSET];
 
 	/*
 	 * XE3GF
@@ -241,21 +224,13 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 		if (retval < 0)
 			return retval;
 		if (retval) {
-			io_op->read_addr = XE3GF_BST0 + (BAT_OFFSET * num);
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = XE3GF_BRC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = XE3GF_BPV0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
-				return retval;
-			io_op->read_addr = XE3GF_BFC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battstat).lc)))
-				return retval;
-			io_op->read_addr = XE3GF_GAU0 + (BAT_OFFSET * num);
-			if ((retval = __backend_byte_read(io_op, &(*battstat).gauge)))
+			if ((retval = BAT_BLOCK_READ(io_op, XE3GF_BST0, XE3GF_GAU0, num, regs)))
 				return retval;
+			status = BAT_U8(regs, XE3GF_BST0, XE3GF_BST0);
+			(*battstat).rc = BAT_U16(regs, XE3GF_BST0, XE3GF_BRC0);
+			(*battstat).pv = BAT_U16(regs, XE3GF_BST0, XE3GF_BPV0);
+			(*battstat).lc = BAT_U16(regs, XE3GF_BST0, XE3GF_BFC0);
+			(*battstat).gauge = BAT_U8(regs, XE3GF_BST0, XE3GF_GAU0);
 
 			if (status & XE3GF_BST_MASK_CRT)
 				(*battstat).status = OMNIBOOK_BATTSTAT_CRITICAL;
@@ -278,18 +253,12 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 		if (retval < 0)
 			return retval;
 		if (retval) {
-			io_op->read_addr = XE3GC_BST0 + (BAT_OFFSET * num);
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = XE3GC_BRC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = XE3GC_BPV0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
-				return retval;
-			io_op->read_addr = XE3GC_BDC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &dc)))
+			if ((retval = BAT_BLOCK_READ(io_op, XE3GC_BST0, XE3GC_BDC0 + 1, num, regs)))
 				return retval;
+			status = BAT_U8(regs, XE3GC_BST0, XE3GC_BST0);
+			(*battstat).rc = BAT_U16(regs, XE3GC_BST0, XE3GC_BRC0);
+			(*battstat).pv = BAT_U16(regs, XE3GC_BST0, XE3GC_BPV0);
+			dc = BAT_U16(regs, XE3GC_BST0, XE3GC_BDC0);
 
 			if (status & XE3GC_BST_MASK_CRT)
 				(*battstat).status = OMNIBOOK_BATTSTAT_CRITICAL;
@@ -302,7 +271,8 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 			else {
 				(*battstat).status = OMNIBOOK_BATTSTAT_CHARGED;
 			}
-			gauge = ((*battstat).rc * 100) / dc;
+			/* No design capacity yet right after insertion */
+			gauge = dc ? ((*battstat).rc * 100) / dc : 0;
 			(*battstat).gauge = gauge;
 			(*battstat).lc = 0;	/* Unknown */
 		} else
@@ -315,18 +285,12 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 		if (retval < 0)
 			return retval;
 		if (retval) {
-			io_op->read_addr = AMILOD_BST0 + (BAT_OFFSET * num);
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = AMILOD_BRC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = AMILOD_BPV0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
-				return retval;
-			io_op->read_addr = AMILOD_BDC0 + (BAT_OFFSET * num);
-			if ((retval = __backend_u16_read(io_op, &dc)))
+			if ((retval = BAT_BLOCK_READ(io_op, AMILOD_BDC0, AMILOD_BPV0 + 1, num, regs)))
 				return retval;
+			dc = BAT_U16(regs, AMILOD_BDC0, AMILOD_BDC0);
+			status = BAT_U8(regs, AMILOD_BDC0, AMILOD_BST0);
+			(*battstat).rc = BAT_U16(regs, AMILOD_BDC0, AMILOD_BRC0);
+			(*battstat).pv = BAT_U16(regs, AMILOD_BDC0, AMILOD_BPV0);
 
 			if (status & AMILOD_BST_MASK_CRT)
 				(*battstat).status = OMNIBOOK_BATTSTAT_CRITICAL;
@@ -339,7 +303,8 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 			else {
 				(*battstat).status = OMNIBOOK_BATTSTAT_CHARGED;
 			}
-			gauge = ((*battstat).rc * 100) / dc;
+			/* No design capacity yet right after insertion */
+			gauge = dc ? ((*battstat).rc * 100) / dc : 0;
 			(*battstat).gauge = gauge;
 			(*battstat).lc = 0;	/* Unknown */
 		} else
@@ -351,37 +316,25 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 	} else if (omnibook_ectype & (OB500 | OB510)) {
 		switch (num) {
 		case 0:
-			io_op->read_addr = OB500_BT1S;
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = OB500_BT1C;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = OB500_BT1V;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
+			if ((retval = BAT_BLOCK_READ(io_op, OB500_BT1C, OB500_BT1S, 0, regs)))
 				return retval;
+			status = BAT_U8(regs, OB500_BT1C, OB500_BT1S);
+			(*battstat).rc = BAT_U16(regs, OB500_BT1C, OB500_BT1C);
+			(*battstat).pv = BAT_U16(regs, OB500_BT1C, OB500_BT1V);
 			break;
 		case 1:
-			io_op->read_addr = OB500_BT2S;
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = OB500_BT2C;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = OB500_BT2V;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
+			if ((retval = BAT_BLOCK_READ(io_op, OB500_BT2C, OB500_BT2S, 0, regs)))
 				return retval;
+			status = BAT_U8(regs, OB500_BT2C, OB500_BT2S);
+			(*battstat).rc = BAT_U16(regs, OB500_BT2C, OB500_BT2C);
+			(*battstat).pv = BAT_U16(regs, OB500_BT2C, OB500_BT2V);
 			break;
 		case 2:
-			io_op->read_addr = OB500_BT3S;
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = OB500_BT3C;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = OB500_BT3V;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
+			if ((retval = BAT_BLOCK_READ(io_op, OB500_BT3C, OB500_BT3S, 0, regs)))
 				return retval;
+			status = BAT_U8(regs, OB500_BT3C, OB500_BT3S);
+			(*battstat).rc = BAT_U16(regs, OB500_BT3C, OB500_BT3C);
+			(*battstat).pv = BAT_U16(regs, OB500_BT3C, OB500_BT3V);
 			break;
 		default:
 			return -EINVAL;
@@ -405,26 +358,18 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 	} else if (omnibook_ectype & (OB6000 | OB6100 | XE4500)) {
 		switch (num) {
 		case 0:
-			io_op->read_addr = OB500_BT1S;
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = OB500_BT1C;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = OB500_BT1V;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
+			if ((retval = BAT_BLOCK_READ(io_op, OB500_BT1C, OB500_BT1S, 0, regs)))
 				return retval;
+			status = BAT_U8(regs, OB500_BT1C, OB500_BT1S);
+			(*battstat).rc = BAT_U16(regs, OB500_BT1C, OB500_BT1C);
+			(*battstat).pv = BAT_U16(regs, OB500_BT1C, OB500_BT1V);
 			break;
 		case 1:
-			io_op->read_addr = OB500_BT3S;
-			if ((retval = __backend_byte_read(io_op, &status)))
-				return retval;
-			io_op->read_addr = OB500_BT3C;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).rc)))
-				return retval;
-			io_op->read_addr = OB500_BT3V;
-			if ((retval = __backend_u16_read(io_op, &(*battstat).pv)))
+			if ((retval = BAT_BLOCK_READ(io_op, OB500_BT3C, OB500_BT3S, 0, regs)))
 				return retval;
+			status = BAT_U8(regs, OB500_BT3C, OB500_BT3S);
+			(*battstat).rc = BAT_U16(regs, OB500_BT3C, OB500_BT3C);
+			(*battstat).pv = BAT_U16(regs, OB500_BT3C, OB500_BT3V);
 			break;
 		default:
 			return -EINVAL;
@@ -446,17 +391,11 @@ static int omnibook_get_battery_status(struct omnibook_operation *io_op,
 	return 0;
 }
 
-static int omnibook_battery_read(char *buffer, struct omnibook_operation *io_op)
+/*
+ * Number of batteries the model can hold
+ */
+static int omnibook_battery_max(void)
 {
-	char *statustr;
-	char *typestr;
-	int max = 0;
-	int num = 0;
-	int len = 0;
-	int retval;
-	int i;
-	struct omnibook_battery_info battinfo;
-	struct omnibook_battery_state battstat;
 	/*
 	 * XE3GF
 	 * XE3GC
@@ -467,21 +406,34 @@ static int omnibook_battery_read(char *buffer, struct omnibook_operation *io_op)
 	 * TSP10
 	 */
 	if (omnibook_ectype & (XE3GF | XE3GC | OB6000 | OB6100 | XE4500 | AMILOD | TSP10))
-		max = 2;
+		return 2;
 	/*
 	 * OB500
 	 * 0B510
 	 */
 	else if (omnibook_ectype & (OB500 | OB510))
-		max = 3;
+		return 3;
 	/*
 	 * TSM30X
 	 * TSM70
 	 */
 	else if (omnibook_ectype & (TSM70 | TSM30X))
-		max = 1;
+		return 1;
+	return 0;
+}
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+static int omnibook_battery_read(struct seq_file *m, struct omnibook_operation *io_op)
+{
+	char *statustr;
+	char *typestr;
+	int max = omnibook_battery_max();
+	int num = 0;
+	int retval;
+	int i;
+	struct omnibook_battery_info battinfo;
+	struct omnibook_battery_state battstat;
+
+	if(omnibook_op_lock_interruptible(io_op))
 			return -ERESTARTSYS;
 
 	for (i = 0; i < max; i++) {
@@ -507,32 +459,58 @@ static int omnibook_battery_read(char *buffer, struct omnibook_operation *io_op)
 				statustr = "unknown";
 			}
 
-			len += sprintf(buffer + len, "Battery:            %11d\n", i);
-			len += sprintf(buffer + len, "Type:               %11s\n", typestr);
+			seq_printf(m, "Battery:            %11d\n", i);
+			seq_printf(m, "Type:               %11s\n", typestr);
 			if (battinfo.sn)
-				len +=
-				    sprintf(buffer + len, "Serial Number:      %11d\n",
-					    battinfo.sn);
-			len += sprintf(buffer + len, "Present Voltage:    %11d mV\n", battstat.pv);
-			len += sprintf(buffer + len, "Design Voltage:     %11d mV\n", battinfo.dv);
-			len += sprintf(buffer + len, "Remaining Capacity: %11d mAh\n", battstat.rc);
+				seq_printf(m, "Serial Number:      %11d\n", battinfo.sn);
+			seq_printf(m, "Present Voltage:    %11d mV\n", battstat.pv);
+			seq_printf(m, "Design Voltage:     %11d mV\n", battinfo.dv);
+			seq_printf(m, "Remaining Capacity: %11d mAh\n", battstat.rc);
 			if (battstat.lc)
-				len +=
-				    sprintf(buffer + len, "Last Full Capacity: %11d mAh\n",
-					    battstat.lc);
-			len += sprintf(buffer + len, "Design Capacity:    %11d mAh\n", battinfo.dc);
-			len +=
-			    sprintf(buffer + len, "Gauge:              %11d %%\n", battstat.gauge);
-			len += sprintf(buffer + len, "Status:             %11s\n", statustr);
-			len += sprintf(buffer + len, "\n");
+				seq_printf(m, "Last Full Capacity: %11d mAh\n", battstat.lc);
+			seq_printf(m, "Design Capacity:    %11d mAh\n", battinfo.dc);
+			seq_printf(m, "Gauge:              %11d %%\n", battstat.gauge);
+			seq_printf(m, "Status:             %11s\n", statustr);
+			seq_printf(m, "\n");
 		}
 	}
 	if (num == 0)
-		len += sprintf(buffer + len, "No battery present\n");
+		seq_printf(m, "No battery present\n");
+
+	omnibook_op_unlock(io_op);
 
-	mutex_unlock(&io_op->backend->mutex);
+	return 0;
+}
 
-	return len;
+static int omnibook_battery_telemetry(struct omnibook_telemetry *t,
+				      struct omnibook_operation *io_op)
+{
+	struct omnibook_telemetry_battery *bat;
+	struct omnibook_battery_info battinfo;
+	struct omnibook_battery_state battstat;
+	int max = min(omnibook_battery_max(), OMNIBOOK_TELEMETRY_BATTERIES);
+	int i;
+
+	for (i = 0; i < max; i++) {
+		if (omnibook_get_battery_info(io_op, i, &battinfo))
+			continue;
+		bat = &t->battery[i];
+		bat->present = 1;
+		bat->type = battinfo.type;
+		bat->sn = battinfo.sn;
+		bat->dv = battinfo.dv;
+		bat->dc = battinfo.dc;
+		if (omnibook_get_battery_status(io_op, i, &battstat))
+			continue;
+		bat->pv = battstat.pv;
+		bat->rc = battstat.rc;
+		bat->lc = battstat.lc;
+		bat->gauge = battstat.gauge;
+		bat->status = battstat.status;
+	}
+	t->battery_count = max;
+	t->valid |= OMNIBOOK_TM_BATTERY;
+	return 0;
 }
 
 static struct omnibook_tbl battery_table[] __initdata = {
@@ -548,6 +526,7 @@ static struct omnibook_feature __declared_feature battery_driver = {
 	.enabled = 0,
 #endif
 	.read = omnibook_battery_read,
+	.telemetry = omnibook_battery_telemetry,
 	.ectypes = XE3GF | XE3GC | AMILOD | TSP10 | TSM70 | TSM30X,	/* FIXME: OB500|OB6000|OB6100|XE4500 */
 	.tbl = battery_table,
 };
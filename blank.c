@@ -70,19 +70,17 @@ static int console_blank_unregister_hook(void)
 	return retval;
 }
 
-static int omnibook_console_blank_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_console_blank_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 
 	spin_lock(&blank_spinlock);
 
-	len +=
-	    sprintf(buffer + len, "LCD console blanking hook is %s\n",
-		    (console_blank_hook == omnibook_lcd_blank) ? "enabled" : "disabled");
+	seq_printf(m, "LCD console blanking hook is %s\n",
+		   (console_blank_hook == omnibook_lcd_blank) ? "enabled" : "disabled");
 
 	spin_unlock(&blank_spinlock);
 
-	return len;
+	return 0;
 }
 
 static int omnibook_console_blank_write(char *buffer, struct omnibook_operation *io_op)
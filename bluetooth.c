@@ -18,22 +18,19 @@
 #include "omnibook.h"
 #include "hardware.h"
 
-static int omnibook_bt_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_bt_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	int retval;
 	unsigned int state;
 
 	if ((retval = backend_aerial_get(io_op, &state)))
 		return retval;
 
-	len +=
-	    sprintf(buffer + len, "Bluetooth adapter is %s",
-		    (state & BT_EX) ? "present" : "absent");
+	seq_printf(m, "Bluetooth adapter is %s", (state & BT_EX) ? "present" : "absent");
 	if (state & BT_EX)
-		len += sprintf(buffer + len, " and %s", (state & BT_STA) ? "enabled" : "disabled");
-	len += sprintf(buffer + len, ".\n");
-	return len;
+		seq_printf(m, " and %s", (state & BT_STA) ? "enabled" : "disabled");
+	seq_printf(m, ".\n");
+	return 0;
 
 }
 
@@ -42,7 +39,7 @@ static int omnibook_bt_write(char *buffer, struct omnibook_operation *io_op)
 	int retval = 0;
 	unsigned int state;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;	
 
 	if ((retval = __backend_aerial_get(io_op, &state)))
@@ -60,7 +57,7 @@ static int omnibook_bt_write(char *buffer, struct omnibook_operation *io_op)
 	retval = __backend_aerial_set(io_op, state);
 
 	out:		
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
@@ -90,11 +87,24 @@ static struct omnibook_tbl wireless_table[] __initdata = {
 	{0,}
 };
 
+static int omnibook_bt_telemetry(struct omnibook_telemetry *t, struct omnibook_operation *io_op)
+{
+	unsigned int state;
+	int retval;
+
+	if ((retval = __backend_aerial_get(io_op, &state)))
+		return retval;
+	t->bluetooth = state & (BT_EX | BT_STA);
+	t->valid |= OMNIBOOK_TM_BLUETOOTH;
+	return 0;
+}
+
 static struct omnibook_feature __declared_feature bt_driver = {
 	.name = "bluetooth",
 	.enabled = 1,
 	.read = omnibook_bt_read,
 	.write = omnibook_bt_write,
+	.telemetry = omnibook_bt_telemetry,
 	.init = omnibook_bt_init,
 	.ectypes = TSM70 | TSM40 | TSA105 | TSX205,
 	.tbl = wireless_table,
@@ -0,0 +1,155 @@
+/*
+ * breaker.c -- circuit breaker for unresponsive backends
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/jiffies.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include "hardware.h"
+
+/*
+ * already_failed keeps a backend whose init failed from being retried.
+ * The breaker does the same at runtime: after breaker_threshold
+ * consecutive timeouts every call fails fast with -EIO for
+ * OMNIBOOK_BREAKER_COOLDOWN ms, then a single call is let through as a
+ * probe. Its success closes the breaker, another timeout reopens it.
+ *
+ * All state is protected by the backend mutex, which the helpers in
+ * hardware.h hold around every call.
+ */
+
+#define OMNIBOOK_BREAKER_COOLDOWN	5000
+
+static int omnibook_breaker_threshold = 3;
+
+static const char *omnibook_breaker_state_name[] = {
+	[OMNIBOOK_BREAKER_CLOSED] = "closed",
+	[OMNIBOOK_BREAKER_OPEN] = "open",
+	[OMNIBOOK_BREAKER_HALF_OPEN] = "half-open",
+};
+
+/*
+ * Slow path of omnibook_breaker_check: return -EIO to fail fast
+ */
+int __omnibook_breaker_check(struct omnibook_backend *backend)
+{
+	struct omnibook_breaker *br = &backend->breaker;
+
+	if (br->state != OMNIBOOK_BREAKER_OPEN)
+		return 0;
+
+	if (time_before(jiffies, br->opened + msecs_to_jiffies(OMNIBOOK_BREAKER_COOLDOWN))) {
+		br->rejected++;
+		return -EIO;
+	}
+
+	dprintk("Backend %s cool-down over, probing.\n", backend->name);
+	br->state = OMNIBOOK_BREAKER_HALF_OPEN;
+	return 0;
+}
+
+/*
+ * Slow path of omnibook_breaker_result: account the result of a call
+ */
+int __omnibook_breaker_result(struct omnibook_backend *backend, int retval)
+{
+	struct omnibook_breaker *br = &backend->breaker;
+
+	if (retval != -ETIME) {
+		if (br->state == OMNIBOOK_BREAKER_HALF_OPEN)
+			printk(O_INFO "Backend %s responding again.\n", backend->name);
+		br->state = OMNIBOOK_BREAKER_CLOSED;
+		br->failures = 0;
+		return retval;
+	}
+
+	br->failures++;
+	if (br->state == OMNIBOOK_BREAKER_HALF_OPEN ||
+	    (omnibook_breaker_threshold && br->failures >= omnibook_breaker_threshold)) {
+		if (br->state == OMNIBOOK_BREAKER_CLOSED)
+			printk(O_WARN "Backend %s not responding, failing fast for %i ms.\n",
+			       backend->name, OMNIBOOK_BREAKER_COOLDOWN);
+		br->state = OMNIBOOK_BREAKER_OPEN;
+		br->opened = jiffies;
+		br->trips++;
+	}
+	return retval;
+}
+
+/*
+ * Give the hardware a new chance, e.g. after resume
+ */
+void omnibook_breaker_reset(struct omnibook_backend *backend)
+{
+	/* Also avoids touching the mutex of a backend never initialised */
+	if (backend->breaker.state == OMNIBOOK_BREAKER_CLOSED && !backend->breaker.failures)
+		return;
+
+	omnibook_backend_lock(backend, "resume");
+	backend->breaker.state = OMNIBOOK_BREAKER_CLOSED;
+	backend->breaker.failures = 0;
+	omnibook_backend_unlock(backend);
+}
+
+static int omnibook_breaker_show(struct seq_file *m, void *v)
+{
+	struct omnibook_backend *backend = m->private;
+	struct omnibook_breaker *br = &backend->breaker;
+
+	if (omnibook_backend_lock_interruptible(backend, "debugfs"))
+		return -ERESTARTSYS;
+
+	seq_printf(m, "state:\t\t%s\n", omnibook_breaker_state_name[br->state]);
+	if (br->state == OMNIBOOK_BREAKER_OPEN)
+		seq_printf(m, "open for:\t%u ms\n", jiffies_to_msecs(jiffies - br->opened));
+	seq_printf(m, "failures:\t%u\n", br->failures);
+	seq_printf(m, "threshold:\t%i\n", omnibook_breaker_threshold);
+	seq_printf(m, "cool-down:\t%i ms\n", OMNIBOOK_BREAKER_COOLDOWN);
+	seq_printf(m, "trips:\t\t%lu\n", br->trips);
+	seq_printf(m, "rejected:\t%lu\n", br->rejected);
+
+	omnibook_backend_unlock(backend);
+	return 0;
+}
+
+static int omnibook_breaker_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omnibook_breaker_show, inode->i_private);
+}
+
+static const struct file_operations omnibook_breaker_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_breaker_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Expose the breaker of a backend once it is in use
+ * Called from probe, a backend can be matched by several features.
+ */
+void omnibook_breaker_debugfs(struct omnibook_backend *backend)
+{
+	if (backend->breaker.dentry)
+		return;
+	backend->breaker.dentry = omnibook_debugfs_file(backend, "breaker", S_IRUGO,
+							&omnibook_breaker_fops);
+}
+
+module_param_named(breaker_threshold, omnibook_breaker_threshold, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(breaker_threshold, "Consecutive hardware timeouts before a backend fails fast for a while, 0 to never fail fast");
+
+/* End of file */
@@ -56,6 +56,11 @@
 #define PIO_PORT_COMMAND2	0x2
 #define PIO_PORT_DATA		0x3
 
+/*
+ * Worst case time in us we poll the interface for a state change
+ */
+#define COMPAL_CHECK_BUDGET	25000
+
 /*
  * Private data of this backend
  */
@@ -133,16 +138,22 @@ static int check_cdimode_flag(unsigned int mode)
 {
 	int i;
 	int retval;
+	unsigned int timeout = omnibook_timeout(&compal_backend, COMPAL_CHECK_BUDGET);
+	ktime_t start = ktime_get();
 
 	/*dprintk("Index mode:");*/
-	for (i = 1; i <= 250; i++) {
+	for (i = 1; timeout; i++) {
 		retval = lowlevel_read(0xfbfc);
 		/*dprintk_simple(" [%i]", retval);*/
 		if (retval == mode) {
 			/*dprintk_simple(".\n");
 			dprintk("Index Mode Ok (%i) after %i iter\n", mode, i);*/
+			omnibook_latency_add(&compal_backend, start);
 			return 0;
 		}
+		if (i * 100 >= timeout)
+			timeout = omnibook_latency_expired(&compal_backend, timeout,
+							   COMPAL_CHECK_BUDGET);
 		udelay(100);
 	}
 	printk(O_ERR "check_cdimode_flag timeout.\n");
@@ -155,11 +166,18 @@ static int check_cdimode_flag(unsigned int mode)
 static int check_default_state(void)
 {
 	int i;
+	unsigned int timeout = omnibook_timeout(&compal_backend, COMPAL_CHECK_BUDGET);
+	ktime_t start = ktime_get();
 
-	for (i = 1; i <= 250; i++) {
+	for (i = 1; timeout; i++) {
 		if ((inb(ioport_base + PIO_PORT_COMMAND1) == 0xf4)
-		    && (inb(ioport_base + PIO_PORT_COMMAND2) == 0x32))
+		    && (inb(ioport_base + PIO_PORT_COMMAND2) == 0x32)) {
+			omnibook_latency_add(&compal_backend, start);
 			return 0;
+		}
+		if (i * 100 >= timeout)
+			timeout = omnibook_latency_expired(&compal_backend, timeout,
+							   COMPAL_CHECK_BUDGET);
 		udelay(100);
 	}
 	printk(O_ERR "check_default_state timeout.\n");
@@ -232,12 +250,16 @@ static int enable_cdimode(void)
  */
 static int send_ec_cmd(unsigned int command, u8 code)
 {
+	ktime_t start = ktime_get();
+	int retval = 0;
+
 	lowlevel_write(0xfbfc, 0x2);
 	lowlevel_write(command, code);
 	lowlevel_write(0xfbfc, 0x1);
 	if (check_cdimode_flag(2))
-		return -ETIME;
-	return 0;
+		retval = -ETIME;
+	omnibook_histogram_add(&compal_backend, OMNIBOOK_HIST_CDI, start);
+	return retval;
 }
 
 /*
@@ -248,11 +270,15 @@ static int send_ec_cmd(unsigned int command, u8 code)
  */
 static int read_ec_cmd(unsigned int command, u8 * value)
 {
+	ktime_t start = ktime_get();
+	int retval = 0;
+
 	*value = lowlevel_read(command);
 	lowlevel_write(0xfbfc, 0x1);
 	if (check_cdimode_flag(2))
-		return -ETIME;
-	return 0;
+		retval = -ETIME;
+	omnibook_histogram_add(&compal_backend, OMNIBOOK_HIST_CDI, start);
+	return retval;
 }
 
 /*
@@ -318,7 +344,7 @@ static int omnibook_cdimode_init(const struct omnibook_operation *io_op)
 		/* Fist use of the backend */
 		dprintk("Try to init cdimode\n");
 		mutex_init(&io_op->backend->mutex);
-		mutex_lock(&io_op->backend->mutex);
+		omnibook_backend_lock(io_op->backend, "init");
 		kref_init(&io_op->backend->kref);
 
 		/* PCI probing: find the LPC Super I/O bridge PCI device */
@@ -367,7 +393,7 @@ static int omnibook_cdimode_init(const struct omnibook_operation *io_op)
 		clear_cdimode_pci();
 
 		dprintk("Cdimode init ok\n");
-		mutex_unlock(&io_op->backend->mutex);
+		omnibook_backend_unlock(io_op->backend);
 		return 0;
 	} else {
 		dprintk("Cdimode has already been initialized\n");
@@ -383,7 +409,7 @@ static int omnibook_cdimode_init(const struct omnibook_operation *io_op)
 	lpc_bridge = NULL;
       error1:
 	io_op->backend->already_failed = 1;
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_backend_unlock(io_op->backend);
 	mutex_destroy(&io_op->backend->mutex);
 	return retval;
 }
@@ -396,11 +422,11 @@ static void cdimode_free(struct kref *ref)
 
 	backend = container_of(ref, struct omnibook_backend, kref);
 
-	mutex_lock(&backend->mutex);
+	omnibook_backend_lock(backend, "exit");
 	pci_dev_put(lpc_bridge);
 	release_region(ioport_base, 4);
 	lpc_bridge = NULL;
-	mutex_unlock(&backend->mutex);
+	omnibook_backend_unlock(backend);
 	mutex_destroy(&backend->mutex);
 }
 
@@ -467,6 +493,61 @@ static int omnibook_cdimode_write(const struct omnibook_operation *io_op, u8 val
 
 }
 
+/*
+ * Block read/write: cdimode is entered only once for the whole sequence
+ */
+static int omnibook_cdimode_block_read(const struct omnibook_operation *io_op, unsigned long addr,
+				       u8 *buf, int len)
+{
+	int retval = 0;
+	int i;
+
+	if (!lpc_bridge)
+		return -ENODEV;
+
+	retval = enable_cdimode();
+	if (retval)
+		goto out;
+	for (i = 0; i < len; i++) {
+		retval = send_ec_cmd(0xfbfd, (unsigned int)(addr + i));
+		if (retval)
+			break;
+		retval = read_ec_cmd(0xfbfe, &buf[i]);
+		if (retval)
+			break;
+	}
+	clear_cdimode();
+      out:
+	clear_cdimode_pci();
+	return retval;
+}
+
+static int omnibook_cdimode_block_write(const struct omnibook_operation *io_op, unsigned long addr,
+					const u8 *buf, int len)
+{
+	int retval = 0;
+	int i;
+
+	if (!lpc_bridge)
+		return -ENODEV;
+
+	retval = enable_cdimode();
+	if (retval)
+		goto out;
+	for (i = 0; i < len; i++) {
+		retval = send_ec_cmd(0xfbfd, (unsigned int)(addr + i));
+		if (retval)
+			break;
+		retval = send_ec_cmd(0xfbfe, buf[i]);
+		if (retval)
+			break;
+	}
+	clear_cdimode();
+      out:
+	clear_cdimode_pci();
+	return retval;
+}
+
 /*
  * Fn+foo and multimedia hotkeys handling
  */
@@ -520,6 +601,8 @@ struct omnibook_backend compal_backend = {
 	.exit = omnibook_cdimode_exit,
 	.byte_read = omnibook_cdimode_read,
 	.byte_write = omnibook_cdimode_write,
+	.block_read = omnibook_cdimode_block_read,
+	.block_write = omnibook_cdimode_block_write,
 	.hotkeys_set = omnibook_cdimode_hotkeys,
 };
 
@@ -27,6 +27,7 @@
 #define	mutex_init(lock)		init_MUTEX(lock)
 #define mutex_lock(lock)		down(lock)
 #define mutex_lock_interruptible(lock)	down_interruptible(lock)
+#define mutex_trylock(lock)		(!down_trylock(lock))
 #define mutex_unlock(lock)		up(lock)
 #define mutex_destroy(lock)		do { } while(0)
 #else
@@ -55,6 +56,14 @@ static void inline *kzalloc(size_t size, int flags)
 #define DEFINE_SPINLOCK(s)              spinlock_t s = SPIN_LOCK_UNLOCKED
 #endif
 
+/*
+ * For compatibility with kernel older than 2.6.16, attributes are not pollable
+ */
+
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(2,6,16))
+#define sysfs_notify(kobj, dir, attr)	do { } while (0)
+#endif
+
 /*
  * Those kernel don't have ICH7 southbridge pcids
  */
@@ -17,25 +17,24 @@
 #include "omnibook.h"
 #include "hardware.h"
 
-static int omnibook_cooling_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_cooling_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
-	len += sprintf(buffer + len, "Cooling method : %s\n", 
-			io_op->backend->cooling_state ? "Performance"  : "Powersave" );
+	seq_printf(m, "Cooling method : %s\n",
+		   io_op->backend->cooling_state ? "Performance"  : "Powersave" );
 
-	mutex_unlock(&io_op->backend->mutex);
-	return len;
+	omnibook_op_unlock(io_op);
+	return 0;
 }
 
 static int omnibook_cooling_write(char *buffer, struct omnibook_operation *io_op)
 {
 	int retval = 0;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
 
@@ -54,7 +53,7 @@ static int omnibook_cooling_write(char *buffer, struct omnibook_operation *io_op
 	if (!retval)
 		io_op->backend->cooling_state = *buffer - '0' ;
 
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 
 	out:
 	return retval;
@@ -62,10 +61,10 @@ static int omnibook_cooling_write(char *buffer, struct omnibook_operation *io_op
 
 static int __init omnibook_cooling_init(struct omnibook_operation *io_op)
 {
-	mutex_lock(&io_op->backend->mutex);
+	omnibook_op_lock(io_op);
 	/* XXX: Assumed default cooling method: performance */
 	io_op->backend->cooling_state = TSM70_COOLING_PERF;
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return 0;
 }
 
@@ -0,0 +1,118 @@
+/*
+ * debugfs.c -- debugfs interface for backend statistics
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/debugfs.h>
+#include "hardware.h"
+
+/*
+ * Layout is /sys/kernel/debug/omnibook/<backend name>/<file>
+ * Everything is torn down in one go at module unload.
+ */
+
+/*
+ * debugfs_remove_recursive() appeared in 2.6.25
+ */
+#if defined(CONFIG_DEBUG_FS) && (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,25))
+
+static struct dentry *omnibook_debugfs_root;
+
+int __init omnibook_debugfs_init(void)
+{
+	omnibook_debugfs_root = debugfs_create_dir(OMNIBOOK_MODULE_NAME, NULL);
+	if (IS_ERR(omnibook_debugfs_root))
+		omnibook_debugfs_root = NULL;
+	if (!omnibook_debugfs_root)
+		printk(O_WARN "Unable to create debugfs directory, statistics unavailable.\n");
+	else {
+		omnibook_flight_debugfs();
+		omnibook_record_debugfs();
+		omnibook_stall_debugfs();
+	}
+	/* Not fatal: the driver works without debugfs */
+	return 0;
+}
+
+void omnibook_debugfs_exit(void)
+{
+	debugfs_remove_recursive(omnibook_debugfs_root);
+	omnibook_debugfs_root = NULL;
+}
+
+/*
+ * Return the debugfs directory of a backend, creating it on first use.
+ * Return NULL if debugfs is unavailable, callers must cope with it.
+ */
+struct dentry *omnibook_debugfs_dir(struct omnibook_backend *backend)
+{
+	struct dentry *dir;
+
+	if (!omnibook_debugfs_root)
+		return NULL;
+
+	if (backend->debugfs_dir)
+		return backend->debugfs_dir;
+
+	dir = debugfs_create_dir(backend->name, omnibook_debugfs_root);
+	if (IS_ERR(dir))
+		dir = NULL;
+	backend->debugfs_dir = dir;
+	return dir;
+}
+
+/*
+ * Create a file in a backend directory, with the backend as private data,
+ * or in the top directory if backend is NULL.
+ */
+struct dentry *omnibook_debugfs_file(struct omnibook_backend *backend, const char *name,
+				     mode_t mode, const struct file_operations *fops)
+{
+	struct dentry *dir, *file;
+
+	dir = backend ? omnibook_debugfs_dir(backend) : omnibook_debugfs_root;
+	if (!dir)
+		return NULL;
+
+	file = debugfs_create_file(name, mode, dir, backend, fops);
+	if (IS_ERR(file))
+		file = NULL;
+	return file;
+}
+
+#else /* CONFIG_DEBUG_FS && 2.6.25 */
+
+int __init omnibook_debugfs_init(void)
+{
+	return 0;
+}
+
+void omnibook_debugfs_exit(void)
+{
+}
+
+struct dentry *omnibook_debugfs_dir(struct omnibook_backend *backend)
+{
+	return NULL;
+}
+
+struct dentry *omnibook_debugfs_file(struct omnibook_backend *backend, const char *name,
+				     mode_t mode, const struct file_operations *fops)
+{
+	return NULL;
+}
+
+#endif /* CONFIG_DEBUG_FS && 2.6.25 */
+
+/* End of file */
@@ -25,9 +25,8 @@ static const char display_name[][16] = {
 	"External DVI",
 };
 
-static int omnibook_display_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_display_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	int retval;
 	unsigned int sta, en_mask, det_mask;
 
@@ -39,19 +38,15 @@ static int omnibook_display_read(char *buffer, struct omnibook_operation *io_op)
 		det_mask = en_mask << 4;	/* see display masks in omnibook.h */
 		if (!(retval & en_mask) && !(retval & det_mask))
 			continue;	/* not supported */
-		len += sprintf(buffer + len, "%s:", display_name[ffs(en_mask) - 1]);
+		seq_printf(m, "%s:", display_name[ffs(en_mask) - 1]);
 		if (retval & det_mask)
-			len +=
-			    sprintf(buffer + len, " display %s",
-				    (sta & det_mask) ? "present" : "absent");
+			seq_printf(m, " display %s", (sta & det_mask) ? "present" : "absent");
 		if (retval & en_mask)
-			len +=
-			    sprintf(buffer + len, " port %s",
-				    (sta & en_mask) ? "enabled" : "disabled");
-		len += sprintf(buffer + len, "\n");
+			seq_printf(m, " port %s", (sta & en_mask) ? "enabled" : "disabled");
+		seq_printf(m, "\n");
 	}
 
-	return len;
+	return 0;
 }
 
 static int omnibook_display_write(char *buffer, struct omnibook_operation *io_op)
@@ -97,12 +92,28 @@ static struct omnibook_tbl display_table[] __initdata = {
 	{0,}
 };
 
+static int omnibook_display_telemetry(struct omnibook_telemetry *t,
+				      struct omnibook_operation *io_op)
+{
+	unsigned int sta;
+	int retval;
+
+	retval = __backend_display_get(io_op, &sta);
+	if (retval < 0)
+		return retval;
+	t->display = sta;
+	t->display_cap = retval;
+	t->valid |= OMNIBOOK_TM_DISPLAY;
+	return 0;
+}
+
 static struct omnibook_feature __declared_feature display_driver = {
 	.name = "display",
 	.enabled = 1,
 	.init = omnibook_display_init,
 	.read = omnibook_display_read,
 	.write = omnibook_display_write,
+	.telemetry = omnibook_display_telemetry,
 	.ectypes =
 	    XE3GF | XE3GC | OB500 | OB510 | OB6000 | OB6100 | XE4500 | OB4150 | TSP10 | TSM70 | TSM30X |
 	    TSM40 | TSX205,
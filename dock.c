@@ -18,18 +18,17 @@
 #include "omnibook.h"
 #include "hardware.h"
 
-static int omnibook_dock_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_dock_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	u8 dock;
 	int retval;
 
 	if ((retval = backend_byte_read(io_op, &dock)))
 		return retval;
 
-	len += sprintf(buffer + len, "Laptop is %s\n", (dock) ? "docked" : "undocked");
+	seq_printf(m, "Laptop is %s\n", (dock) ? "docked" : "undocked");
 
-	return len;
+	return 0;
 }
 
 static int omnibook_dock_write(char *buffer, struct omnibook_operation *io_op)
@@ -50,6 +49,18 @@ static int omnibook_dock_write(char *buffer, struct omnibook_operation *io_op)
 	return retval;
 }
 
+static int omnibook_dock_telemetry(struct omnibook_telemetry *t, struct omnibook_operation *io_op)
+{
+	u8 dock;
+	int retval;
+
+	if ((retval = __backend_byte_read(io_op, &dock)))
+		return retval;
+	t->dock = !!dock;
+	t->valid |= OMNIBOOK_TM_DOCK;
+	return 0;
+}
+
 static struct omnibook_feature dock_driver;
 
 static int __init omnibook_dock_init(struct omnibook_operation *io_op)
@@ -75,6 +86,7 @@ static struct omnibook_feature __declared_feature dock_driver = {
 	.init = omnibook_dock_init,
 	.read = omnibook_dock_read,
 	.write = omnibook_dock_write,
+	.telemetry = omnibook_dock_telemetry,
 	.ectypes = XE3GF | OB500 | OB510 | OB6000 | OB6100 | OB4150 | TSM40,
 	.tbl = dock_table,
 };
@@ -24,55 +24,51 @@
 
 static u8 ecdump_regs[256];
 
-static int ecdump_read(char *buffer, struct omnibook_operation *io_op)
+static int ecdump_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	int i, j;
 	u8 v;
+	u8 row[16];
 
-	len +=
-	    sprintf(buffer + len,
-		    "EC      " " +00 +01 +02 +03 +04 +05 +06 +07"
-		    " +08 +09 +0a +0b +0c +0d +0e +0f\n");
+	seq_printf(m, "EC      " " +00 +01 +02 +03 +04 +05 +06 +07"
+		   " +08 +09 +0a +0b +0c +0d +0e +0f\n");
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 			return -ERESTARTSYS;
 
+	/* The dump shows live registers, not what the EC shadow remembers */
 	for (i = 0; i < 255; i += 16) {
-		len += sprintf(buffer + len, "EC 0x%02x:", i);
+		if (io_op->backend == &ec_backend)
+			__omnibook_ec_shadow_forget(i, 16);
+		if (__backend_block_read(io_op, i, row, 16))
+			break;
+		seq_printf(m, "EC 0x%02x:", i);
 		for (j = 0; j < 16; j++) {
-			io_op->read_addr = i +j;
-			if (__backend_byte_read(io_op, &v))
-				break;
+			v = row[j];
 			if (v != ecdump_regs[i + j])
-				len += sprintf(buffer + len, " *%02x", v);
+				seq_printf(m, " *%02x", v);
 			else
-				len += sprintf(buffer + len, "  %02x", v);
+				seq_printf(m, "  %02x", v);
 			ecdump_regs[i + j] = v;
 		}
-		len += sprintf(buffer + len, "\n");
-		if (j != 16)
-			break;
+		seq_printf(m, "\n");
 	}
 
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 
 	/* These are way too dangerous to advertise openly... */
 #if 0
-	len +=
-	    sprintf(buffer + len,
-		    "commands:\t0x<offset> 0x<value>" " (<offset> is 00-ff, <value> is 00-ff)\n");
-	len +=
-	    sprintf(buffer + len,
-		    "commands:\t0x<offset> <value>  " " (<offset> is 00-ff, <value> is 0-255)\n");
+	seq_printf(m, "commands:\t0x<offset> 0x<value>" " (<offset> is 00-ff, <value> is 00-ff)\n");
+	seq_printf(m, "commands:\t0x<offset> <value>  " " (<offset> is 00-ff, <value> is 0-255)\n");
 #endif
-	return len;
+	return 0;
 }
 
 static int ecdump_write(char *buffer, struct omnibook_operation *io_op)
 {
 
 	int i, v;
+	u8 data;
 
 	if (sscanf(buffer, "0x%x 0x%x", &i, &v) == 2) {
 		/* i and v set */
@@ -81,8 +77,8 @@ static int ecdump_write(char *buffer, struct omnibook_operation *io_op)
 	} else
 		return -EINVAL;
 	if (i >= 0 && i < 256 && v >= 0 && v < 256) {
-		io_op->write_addr = i;
-		return backend_byte_write(io_op, v);
+		data = v;
+		return backend_block_write(io_op, i, &data, 1);
 	} else
 		return -EINVAL;
 
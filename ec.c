@@ -22,12 +22,21 @@
 #include <linux/sched.h>
 #include <linux/spinlock.h>
 #include <linux/ioport.h>
+#include <linux/kref.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <linux/interrupt.h>
+#include <linux/wait.h>
 
 #include <asm/io.h>
+#include <asm/div64.h>
 #include "hardware.h"
 
 /*
- * Interrupt control
+ * Interrupt control:
+ * Transactions are serialized by the backend mutex, this lock only
+ * protects the individual port accesses which are done with interrupts off.
  */
 
 static DEFINE_SPINLOCK(omnibook_ec_lock);
@@ -53,30 +62,256 @@ static DEFINE_SPINLOCK(omnibook_ec_lock);
 
 #define OMNIBOOK_EC_CMD_READ		0x80
 #define OMNIBOOK_EC_CMD_WRITE		0x81
+#define OMNIBOOK_EC_CMD_BURST_ENABLE	0x82
+#define OMNIBOOK_EC_CMD_BURST_DISABLE	0x83
+
+#define OMNIBOOK_EC_BURST_ACK		0x90	/* Burst mode acknowledge byte */
+
+/*
+ * Time in us we busy-wait on the status register before we start
+ * sleeping between polls. Most ECs answer well within this delay.
+ */
+
+#define OMNIBOOK_EC_SPIN		20
+
+/*
+ * Transaction statistics, access with backend mutex held
+ */
+
+static struct {
+	unsigned long transactions;	/* completed or failed transactions */
+	unsigned long sleeps;		/* sleeps between status polls */
+	unsigned long timeouts;		/* transactions which timed out */
+	u64 irqoff_cur;			/* irq-off time of the running transaction (ns) */
+	u64 irqoff_last;		/* irq-off time of the last transaction (ns) */
+	u64 irqoff_max;			/* worst irq-off time of a transaction (ns) */
+	u64 irqoff_total;		/* cumulated irq-off time (ns) */
+	unsigned long irq_waits;	/* waits ended by the EC interrupt */
+	unsigned long irq_misses;	/* slices the EC got ready without interrupt */
+	unsigned long shadow_hits;	/* reads served from the shadow */
+	unsigned long shadow_misses;	/* shadowed registers read from the EC */
+} ec_stats;
+
+/*
+ * Sleep between two status polls
+ * usleep_range appeared in 2.6.36
+ */
+static inline void omnibook_ec_sleep(void)
+{
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36))
+	usleep_range(50, 100);
+#else
+	msleep(1);
+#endif
+	ec_stats.sleeps++;
+}
+
+static inline int omnibook_ec_ready(u8 event)
+{
+	if (event == OMNIBOOK_EC_STAT_OBF)
+		return inb(OMNIBOOK_EC_SC) & OMNIBOOK_EC_STAT_OBF;
+	else
+		return !(inb(OMNIBOOK_EC_SC) & OMNIBOOK_EC_STAT_IBF);
+}
+
+/*
+ * Interrupt driven waits:
+ * The EC raises its SCI when OBF gets set or IBF gets cleared. With ACPI
+ * the ACPI EC driver takes care of it, without ACPI nobody services that
+ * line and the user can hand it to us with ec_irq=<line> (usually 9).
+ * The line is requested shared and we only claim interrupts which happen
+ * while a transaction is waiting and the status shows the awaited event.
+ * If the line stays silent, we fall back to polling for good.
+ */
 
 /*
- * Wait for embedded controller buffer
+ * For compatibility with kernel older than 2.6.18
+ */
+#ifndef IRQF_SHARED
+#define IRQF_SHARED SA_SHIRQ
+#endif
+
+#define OMNIBOOK_EC_IRQ_SLICE		msecs_to_jiffies(10)	/* Re-check status at least that often */
+#define OMNIBOOK_EC_IRQ_MAX_MISSES	16	/* Consecutive missed interrupts before we give up */
+
+static int omnibook_ec_irq = -1;
+static int ec_irq_active;		/* interrupt line requested and trusted */
+static int ec_irq_misses;		/* consecutive missed interrupts */
+static u8 ec_irq_event;			/* event awaited by the running transaction, 0 if none */
+static DECLARE_WAIT_QUEUE_HEAD(ec_irq_wait);
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+static irqreturn_t omnibook_ec_interrupt(int irq, void *dev_id)
+#else
+static irqreturn_t omnibook_ec_interrupt(int irq, void *dev_id, struct pt_regs *regs)
+#endif
+{
+	u8 event = ec_irq_event;
+
+	if (!event || !omnibook_ec_ready(event))
+		return IRQ_NONE;
+	wake_up(&ec_irq_wait);
+	return IRQ_HANDLED;
+}
+
+static void omnibook_ec_irq_release(void)
+{
+	if (!ec_irq_active)
+		return;
+	free_irq(omnibook_ec_irq, &ec_backend);
+	ec_irq_active = 0;
+}
+
+static void omnibook_ec_irq_setup(void)
+{
+	int retval;
+
+	if (omnibook_ec_irq < 0)
+		return;
+#ifdef CONFIG_ACPI_EC
+	if (!acpi_disabled) {
+		printk(O_INFO "ACPI EC driver in use, ec_irq ignored.\n");
+		return;
+	}
+#endif
+	retval = request_irq(omnibook_ec_irq, omnibook_ec_interrupt, IRQF_SHARED,
+			     OMNIBOOK_MODULE_NAME, &ec_backend);
+	if (retval) {
+		printk(O_WARN "Unable to get EC interrupt %i (error %i), polling.\n",
+		       omnibook_ec_irq, retval);
+		return;
+	}
+	ec_irq_misses = 0;
+	ec_irq_active = 1;
+	dprintk("EC interrupt driven mode on line %i.\n", omnibook_ec_irq);
+}
+
+/*
+ * Sleep until the EC interrupt fires or a time slice elapsed
+ * A slice ending with the EC ready is a missed interrupt, one ending with
+ * the EC still busy says nothing about the line.
+ */
+static void omnibook_ec_irq_sleep(u8 event)
+{
+	if (wait_event_timeout(ec_irq_wait, omnibook_ec_ready(event), OMNIBOOK_EC_IRQ_SLICE)) {
+		ec_stats.irq_waits++;
+		ec_irq_misses = 0;
+		return;
+	}
+	if (!omnibook_ec_ready(event))
+		return;
+	ec_stats.irq_misses++;
+	if (++ec_irq_misses >= OMNIBOOK_EC_IRQ_MAX_MISSES) {
+		printk(O_WARN "No EC interrupt seen on line %i, falling back to polling.\n",
+		       omnibook_ec_irq);
+		ec_irq_event = 0;
+		omnibook_ec_irq_release();
+	}
+}
+
+/*
+ * Wait for embedded controller buffer:
+ * spin for a few us, then sleep until the EC interrupt fires or between
+ * polls, until the learned timeout elapsed, or OMNIBOOK_TIMEOUT ms if the
+ * EC answered its last wait, see timeout.c.
+ * Interrupts are enabled all along.
  */
 
 static int omnibook_ec_wait(u8 event)
 {
-	int timeout = OMNIBOOK_TIMEOUT;
-
-	switch (event) {
-	case OMNIBOOK_EC_STAT_OBF:
-		while (!(inb(OMNIBOOK_EC_SC) & event) && timeout--)
-			mdelay(1);
-		break;
-	case OMNIBOOK_EC_STAT_IBF:
-		while ((inb(OMNIBOOK_EC_SC) & event) && timeout--)
-			mdelay(1);
-		break;
-	default:
+	unsigned int timeout, ceiling = OMNIBOOK_TIMEOUT * 1000;
+	unsigned long begin, expire;
+	ktime_t start;
+	int retval = 0;
+	int i;
+
+	if (event != OMNIBOOK_EC_STAT_OBF && event != OMNIBOOK_EC_STAT_IBF)
 		return -EINVAL;
+
+	start = ktime_get();
+	for (i = 0; i < OMNIBOOK_EC_SPIN; i++) {
+		if (omnibook_ec_ready(event))
+			goto out;
+		udelay(1);
 	}
-	if (timeout > 0)
-		return 0;
-	return -ETIME;
+
+	timeout = omnibook_timeout(&ec_backend, ceiling);
+	begin = jiffies;
+	expire = begin + usecs_to_jiffies(timeout);
+	if (ec_irq_active) {
+		ec_irq_event = event;
+		smp_mb();
+	}
+	while (!omnibook_ec_ready(event)) {
+		if (time_after(jiffies, expire)) {
+			/* We may have slept past the deadline, give it a last chance */
+			if (omnibook_ec_ready(event))
+				break;
+			timeout = omnibook_latency_expired(&ec_backend, timeout, ceiling);
+			if (timeout) {
+				expire = begin + usecs_to_jiffies(timeout);
+				continue;
+			}
+			ec_stats.timeouts++;
+			retval = -ETIME;
+			break;
+		}
+		if (ec_irq_active)
+			omnibook_ec_irq_sleep(event);
+		else
+			omnibook_ec_sleep();
+	}
+	ec_irq_event = 0;
+      out:
+	if (!retval)
+		omnibook_latency_add(&ec_backend, start);
+	return retval;
+}
+
+/*
+ * Port accesses with interrupts disabled, the time spent is accounted
+ * to the running transaction.
+ */
+
+static void omnibook_ec_outb(u8 value, unsigned long port)
+{
+	unsigned long flags;
+	ktime_t start;
+
+	spin_lock_irqsave(&omnibook_ec_lock, flags);
+	start = ktime_get();
+	outb(value, port);
+	ec_stats.irqoff_cur += ktime_to_ns(ktime_sub(ktime_get(), start));
+	spin_unlock_irqrestore(&omnibook_ec_lock, flags);
+}
+
+static u8 omnibook_ec_inb(unsigned long port)
+{
+	unsigned long flags;
+	ktime_t start;
+	u8 value;
+
+	spin_lock_irqsave(&omnibook_ec_lock, flags);
+	start = ktime_get();
+	value = inb(port);
+	ec_stats.irqoff_cur += ktime_to_ns(ktime_sub(ktime_get(), start));
+	spin_unlock_irqrestore(&omnibook_ec_lock, flags);
+
+	return value;
+}
+
+static inline void omnibook_ec_begin(void)
+{
+	ec_stats.irqoff_cur = 0;
+}
+
+static inline void omnibook_ec_end(void)
+{
+	ec_stats.transactions++;
+	ec_stats.irqoff_last = ec_stats.irqoff_cur;
+	ec_stats.irqoff_total += ec_stats.irqoff_cur;
+	if (ec_stats.irqoff_cur > ec_stats.irqoff_max)
+		ec_stats.irqoff_max = ec_stats.irqoff_cur;
 }
 
 /*
@@ -84,39 +319,37 @@ static int omnibook_ec_wait(u8 event)
  * Decide at run-time if we can use the much cleaner ACPI EC driver instead of
  * this implementation, this is the case if ACPI has been compiled and is not
  * disabled.
+ * The legacy implementation may sleep: it must be called with the backend
+ * mutex held.
  */
 
-static int omnibook_ec_read(const struct omnibook_operation *io_op, u8 * data)
+static int omnibook_ec_raw_read(u8 addr, u8 *data)
 {
 	int retval;
 
 #ifdef CONFIG_ACPI_EC
 	if (likely(!acpi_disabled)) {
-		retval = ec_read((u8) io_op->read_addr, data);
-		if (io_op->read_mask)
-			*data &= io_op->read_mask;
-//		dprintk("ACPI EC read at %lx success %i.\n", io_op->read_addr, retval);
+		retval = ec_read(addr, data);
+//		dprintk("ACPI EC read at %x success %i.\n", addr, retval);
 		return retval;
 	}
 #endif
-	spin_lock_irq(&omnibook_ec_lock);
+	omnibook_ec_begin();
 	retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
 	if (retval)
 		goto end;
-	outb(OMNIBOOK_EC_CMD_READ, OMNIBOOK_EC_SC);
+	omnibook_ec_outb(OMNIBOOK_EC_CMD_READ, OMNIBOOK_EC_SC);
 	retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
 	if (retval)
 		goto end;
-	outb((u8) io_op->read_addr, OMNIBOOK_EC_DATA);
+	omnibook_ec_outb(addr, OMNIBOOK_EC_DATA);
 	retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_OBF);
 	if (retval)
 		goto end;
-	*data = inb(OMNIBOOK_EC_DATA);
-	if (io_op->read_mask)
-		*data &= io_op->read_mask;
+	*data = omnibook_ec_inb(OMNIBOOK_EC_DATA);
       end:
-	spin_unlock_irq(&omnibook_ec_lock);
-//	dprintk("Custom EC read at %lx success %i.\n", io_op->read_addr, retval);
+	omnibook_ec_end();
+//	dprintk("Custom EC read at %x success %i.\n", addr, retval);
 	return retval;
 }
 
@@ -127,39 +360,446 @@ static int omnibook_ec_read(const struct omnibook_operation *io_op, u8 * data)
  * This is the case if ACPI has been compiled and is not
  * disabled.
  * If OMNIBOOK_LEGACY is unset, we drop our custoim implementation
+ * As for reads, the legacy implementation must be called with the backend
+ * mutex held.
  */
 
-static int omnibook_ec_write(const struct omnibook_operation *io_op, u8 data)
+static int omnibook_ec_raw_write(u8 addr, u8 data)
 {
 	int retval;
 
 #ifdef CONFIG_ACPI_EC
 	if (likely(!acpi_disabled)) {
-		retval = ec_write((u8) io_op->write_addr, data);
-//		dprintk("ACPI EC write at %lx success %i.\n", io_op->write_addr, retval);
+		retval = ec_write(addr, data);
+//		dprintk("ACPI EC write at %x success %i.\n", addr, retval);
 		return retval;
 	}
 #endif
 
-	spin_lock_irq(&omnibook_ec_lock);
+	omnibook_ec_begin();
 	retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
 	if (retval)
 		goto end;
-	outb(OMNIBOOK_EC_CMD_WRITE, OMNIBOOK_EC_SC);
+	omnibook_ec_outb(OMNIBOOK_EC_CMD_WRITE, OMNIBOOK_EC_SC);
 	retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
 	if (retval)
 		goto end;
-	outb((u8) io_op->write_addr, OMNIBOOK_EC_DATA);
+	omnibook_ec_outb(addr, OMNIBOOK_EC_DATA);
 	retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
 	if (retval)
 		goto end;
-	outb(data, OMNIBOOK_EC_DATA);
+	omnibook_ec_outb(data, OMNIBOOK_EC_DATA);
       end:
-	spin_unlock_irq(&omnibook_ec_lock);
-//	dprintk("Custom EC write at %lx success %i.\n", io_op->write_addr, retval);
+	omnibook_ec_end();
+//	dprintk("Custom EC write at %x success %i.\n", addr, retval);
+	return retval;
+}
+
+/*
+ * Read or write len consecutive registers of the embedded controller.
+ * On the legacy path, the EC is put in burst mode for the whole sequence:
+ * it is then dedicated to us and answers each byte without delay, so the
+ * status polls never leave the spinning phase of omnibook_ec_wait.
+ * A single register is not worth the handshake, and an EC refusing burst
+ * mode or not answering the request at all is accessed byte per byte;
+ * one which did not answer is not asked again.
+ * The ACPI EC driver has no multi-byte interface, but it enters burst
+ * mode on its own when it is under load, so we simply loop on ec_read
+ * or ec_write.
+ */
+
+static int ec_burst_silent;		/* EC never answered a burst mode request */
+
+static int omnibook_ec_raw_block(u8 addr, u8 *buf, int len, int write)
+{
+	int retval;
+	int i;
+	int burst = 0;
+
+#ifdef CONFIG_ACPI_EC
+	if (likely(!acpi_disabled)) {
+		for (i = 0; i < len; i++) {
+			if (write)
+				retval = ec_write(addr + i, buf[i]);
+			else
+				retval = ec_read(addr + i, &buf[i]);
+			if (retval)
+				return retval;
+		}
+		return 0;
+	}
+#endif
+	omnibook_ec_begin();
+	if (len > 1 && !ec_burst_silent) {
+		retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
+		if (retval)
+			goto end;
+		omnibook_ec_outb(OMNIBOOK_EC_CMD_BURST_ENABLE, OMNIBOOK_EC_SC);
+		retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_OBF);
+		if (retval) {
+			printk(O_INFO "EC does not answer burst mode requests, accessing byte per byte.\n");
+			ec_burst_silent = 1;
+			retval = 0;
+			/* Do not take a late acknowledge for data */
+			if (omnibook_ec_ready(OMNIBOOK_EC_STAT_OBF))
+				omnibook_ec_inb(OMNIBOOK_EC_DATA);
+		} else if (omnibook_ec_inb(OMNIBOOK_EC_DATA) == OMNIBOOK_EC_BURST_ACK)
+			burst = 1;
+		else
+			dprintk("EC refused burst mode, accessing byte per byte.\n");
+	}
+
+	for (i = 0; i < len; i++) {
+		retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
+		if (retval)
+			goto out;
+		omnibook_ec_outb(write ? OMNIBOOK_EC_CMD_WRITE : OMNIBOOK_EC_CMD_READ,
+				 OMNIBOOK_EC_SC);
+		retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
+		if (retval)
+			goto out;
+		omnibook_ec_outb(addr + i, OMNIBOOK_EC_DATA);
+		if (write) {
+			retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
+			if (retval)
+				goto out;
+			omnibook_ec_outb(buf[i], OMNIBOOK_EC_DATA);
+		} else {
+			retval = omnibook_ec_wait(OMNIBOOK_EC_STAT_OBF);
+			if (retval)
+				goto out;
+			buf[i] = omnibook_ec_inb(OMNIBOOK_EC_DATA);
+		}
+	}
+
+      out:
+	/* Leave burst mode even on error, the EC would do it after a while anyway */
+	if (burst && !omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF)) {
+		omnibook_ec_outb(OMNIBOOK_EC_CMD_BURST_DISABLE, OMNIBOOK_EC_SC);
+		omnibook_ec_wait(OMNIBOOK_EC_STAT_IBF);
+	}
+      end:
+	omnibook_ec_end();
+//	dprintk("Custom EC block access at %x len %i success %i.\n", addr, len, retval);
+	return retval;
+}
+
+/*
+ * Shadow of the EC register space
+ * Each register belongs to a volatility class, depending on the ectype:
+ * - volatile registers are always read from the EC
+ * - slow registers are served from the shadow for a limited time
+ * - static registers are served from the shadow until they are written
+ *   or the system resumes
+ * The shadow holds raw (unmasked) values and is updated by every
+ * successful read or write. Access with backend mutex held.
+ */
+
+enum {
+	EC_SHADOW_VOLATILE = 0,
+	EC_SHADOW_SLOW,
+	EC_SHADOW_STATIC,
+};
+
+struct ec_shadow_class {
+	enum omnibook_ectype_t ectypes;
+	u8 first;		/* first register of the range */
+	u8 last;		/* last register of the range (included) */
+	u8 class;		/* volatility class */
+	unsigned int ttl;	/* validity in ms of EC_SHADOW_SLOW registers */
+};
+
+/*
+ * Battery registers only change when a battery is swapped, we
+ * still let them expire quickly enough to catch that.
+ */
+#define EC_SHADOW_BATTERY_TTL	5000
+
+static const struct ec_shadow_class ec_shadow_classes[] = {
+	{ XE3GF, XE3GF_FOT, XE3GF_FSD7, EC_SHADOW_STATIC, 0 },
+	{ XE3GF, XE3GF_BTY0, XE3GF_BTY0, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GF, XE3GF_BSN0, XE3GF_BSN0 + 1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GF, XE3GF_BDV0, XE3GF_BDC0 + 1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GF, XE3GF_BFC0, XE3GF_BFC0 + 1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GF, XE3GF_BTY1, XE3GF_BTY1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GF, XE3GF_BSN1, XE3GF_BSN1 + 1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GF, XE3GF_BDV1, XE3GF_BDC1 + 1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GF, XE3GF_BFC1, XE3GF_BFC1 + 1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GC, XE3GC_BDV0, XE3GC_BMF0, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ XE3GC, XE3GC_BDV1, XE3GC_BMF1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ AMILOD, AMILOD_BDC0, AMILOD_BTY0, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+	{ AMILOD, AMILOD_BDC1, AMILOD_BTY1, EC_SHADOW_SLOW, EC_SHADOW_BATTERY_TTL },
+};
+
+struct ec_shadow_reg {
+	unsigned long expires;	/* in jiffies, for EC_SHADOW_SLOW registers */
+	unsigned int ttl;	/* in jiffies, for EC_SHADOW_SLOW registers */
+	u8 value;		/* raw register value */
+	u8 class;		/* volatility class */
+	u8 valid;		/* value is meaningful */
+};
+
+static struct ec_shadow_reg ec_shadow[256];
+
+static int omnibook_ec_shadow_enable = 1;
+
+/*
+ * Tag registers according to the current ectype, called once at backend init
+ */
+static void omnibook_ec_shadow_setup(void)
+{
+	int i, reg;
+
+	memset(ec_shadow, 0, sizeof(ec_shadow));
+	for (i = 0; i < ARRAY_SIZE(ec_shadow_classes); i++) {
+		if (!(omnibook_ectype & ec_shadow_classes[i].ectypes))
+			continue;
+		for (reg = ec_shadow_classes[i].first; reg <= ec_shadow_classes[i].last; reg++) {
+			ec_shadow[reg].class = ec_shadow_classes[i].class;
+			ec_shadow[reg].ttl = msecs_to_jiffies(ec_shadow_classes[i].ttl);
+		}
+	}
+}
+
+static inline int omnibook_ec_shadow_fresh(u8 addr)
+{
+	struct ec_shadow_reg *reg = &ec_shadow[addr];
+
+	return omnibook_ec_shadow_enable && reg->class != EC_SHADOW_VOLATILE && reg->valid
+	    && !(reg->class == EC_SHADOW_SLOW && time_after(jiffies, reg->expires));
+}
+
+static int omnibook_ec_shadow_get(u8 addr, u8 *data)
+{
+	if (!omnibook_ec_shadow_fresh(addr)) {
+		if (omnibook_ec_shadow_enable && ec_shadow[addr].class != EC_SHADOW_VOLATILE)
+			ec_stats.shadow_misses++;
+		return 0;
+	}
+	*data = ec_shadow[addr].value;
+	ec_stats.shadow_hits++;
+	return 1;
+}
+
+static void omnibook_ec_shadow_set(u8 addr, u8 data)
+{
+	struct ec_shadow_reg *reg = &ec_shadow[addr];
+
+	if (reg->class == EC_SHADOW_VOLATILE)
+		return;
+	reg->value = data;
+	reg->expires = jiffies + reg->ttl;
+	reg->valid = 1;
+}
+
+/*
+ * Forget all shadowed values, the EC may have been reset while we were
+ * not looking (e.g. suspend to RAM)
+ */
+void omnibook_ec_shadow_invalidate(void)
+{
+	int i;
+
+	omnibook_backend_lock(&ec_backend, "resume");
+	for (i = 0; i < ARRAY_SIZE(ec_shadow); i++)
+		ec_shadow[i].valid = 0;
+	omnibook_backend_unlock(&ec_backend);
+}
+
+/*
+ * Forget the shadowed values of len registers from addr, so that their
+ * next read goes to the EC. Backend mutex held
+ */
+void __omnibook_ec_shadow_forget(unsigned long addr, int len)
+{
+	while (len-- > 0 && addr < ARRAY_SIZE(ec_shadow))
+		ec_shadow[addr++].valid = 0;
+}
+
+static int omnibook_ec_read(const struct omnibook_operation *io_op, u8 * data)
+{
+	int retval;
+	u8 addr = io_op->read_addr;
+
+	if (!omnibook_ec_shadow_get(addr, data)) {
+		retval = omnibook_ec_raw_read(addr, data);
+		if (retval) {
+			ec_shadow[addr].valid = 0;
+			return retval;
+		}
+		omnibook_ec_shadow_set(addr, *data);
+	}
+
+	if (io_op->read_mask)
+		*data &= io_op->read_mask;
+	return 0;
+}
+
+/*
+ * Read len consecutive raw registers (read_mask is not applied). Fresh
+ * registers at both ends are served from the shadow, the EC is read in
+ * one block from the first to the last register which is not: blocks
+ * mixing static and volatile registers, as the battery ones, thus only
+ * read their volatile middle.
+ */
+static int omnibook_ec_block_read(const struct omnibook_operation *io_op, unsigned long addr,
+				  u8 *buf, int len)
+{
+	int first, last;
+	int retval;
+	int i;
+
+	if (len <= 0 || addr + len > ARRAY_SIZE(ec_shadow))
+		return -EINVAL;
+
+	for (first = 0; first < len; first++) {
+		if (!omnibook_ec_shadow_get(addr + first, &buf[first]))
+			break;
+	}
+	if (first == len)
+		return 0;
+	for (last = len - 1; last > first; last--) {
+		if (!omnibook_ec_shadow_get(addr + last, &buf[last]))
+			break;
+	}
+
+	retval = omnibook_ec_raw_block(addr + first, buf + first, last - first + 1, 0);
+	for (i = first; i <= last; i++) {
+		if (retval)
+			ec_shadow[addr + i].valid = 0;
+		else
+			omnibook_ec_shadow_set(addr + i, buf[i]);
+	}
+	return retval;
+}
+
+static int omnibook_ec_block_write(const struct omnibook_operation *io_op, unsigned long addr,
+				   const u8 *buf, int len)
+{
+	int retval;
+	int i;
+
+	if (len <= 0 || addr + len > ARRAY_SIZE(ec_shadow))
+		return -EINVAL;
+
+	retval = omnibook_ec_raw_block(addr, (u8 *) buf, len, 1);
+	for (i = 0; i < len; i++) {
+		if (retval)
+			ec_shadow[addr + i].valid = 0;
+		else
+			omnibook_ec_shadow_set(addr + i, buf[i]);
+	}
+	return retval;
+}
+
+static int omnibook_ec_write(const struct omnibook_operation *io_op, u8 data)
+{
+	int retval;
+	u8 addr = io_op->write_addr;
+
+	retval = omnibook_ec_raw_write(addr, data);
+	if (retval)
+		ec_shadow[addr].valid = 0;
+	else
+		omnibook_ec_shadow_set(addr, data);
 	return retval;
 }
 
+/*
+ * debugfs statistics of the legacy transaction engine
+ */
+
+static int omnibook_ec_stats_show(struct seq_file *m, void *v)
+{
+	struct omnibook_backend *backend = m->private;
+	unsigned long transactions;
+	u64 avg;
+
+	if (omnibook_backend_lock_interruptible(backend, "debugfs"))
+		return -ERESTARTSYS;
+
+#ifdef CONFIG_ACPI_EC
+	seq_printf(m, "mode:\t\t\t%s\n", acpi_disabled ? "legacy" : "acpi");
+#else
+	seq_printf(m, "mode:\t\t\tlegacy\n");
+#endif
+	transactions = ec_stats.transactions;
+	seq_printf(m, "transactions:\t\t%lu\n", transactions);
+	seq_printf(m, "timeouts:\t\t%lu\n", ec_stats.timeouts);
+	seq_printf(m, "sleeps:\t\t\t%lu\n", ec_stats.sleeps);
+	if (ec_irq_active)
+		seq_printf(m, "interrupt:\t\t%i\n", omnibook_ec_irq);
+	else
+		seq_printf(m, "interrupt:\t\tnone\n");
+	seq_printf(m, "irq waits:\t\t%lu\n", ec_stats.irq_waits);
+	seq_printf(m, "irq misses:\t\t%lu\n", ec_stats.irq_misses);
+	seq_printf(m, "irqoff last (ns):\t%llu\n", (unsigned long long) ec_stats.irqoff_last);
+	seq_printf(m, "irqoff max (ns):\t%llu\n", (unsigned long long) ec_stats.irqoff_max);
+	avg = ec_stats.irqoff_total;
+	if (transactions)
+		do_div(avg, transactions);
+	seq_printf(m, "irqoff avg (ns):\t%llu\n", (unsigned long long) avg);
+	seq_printf(m, "shadow:\t\t\t%s\n", omnibook_ec_shadow_enable ? "enabled" : "disabled");
+	seq_printf(m, "shadow hits:\t\t%lu\n", ec_stats.shadow_hits);
+	seq_printf(m, "shadow misses:\t\t%lu\n", ec_stats.shadow_misses);
+
+	omnibook_backend_unlock(backend);
+	return 0;
+}
+
+static int omnibook_ec_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omnibook_ec_stats_show, inode->i_private);
+}
+
+static const struct file_operations omnibook_ec_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_ec_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static struct dentry *ec_stats_file;
+
+/*
+ * Backend init: nothing to probe, only publish statistics once
+ * This function can be called blindly as it use a kref
+ */
+static int omnibook_ec_init(const struct omnibook_operation *io_op)
+{
+	if (!io_op->backend->data) {
+		dprintk("Init EC backend\n");
+		kref_init(&io_op->backend->kref);
+		io_op->backend->data = &ec_stats;
+		omnibook_ec_shadow_setup();
+		omnibook_ec_irq_setup();
+		ec_stats_file = omnibook_debugfs_file(io_op->backend, "stats", S_IRUGO,
+						      &omnibook_ec_stats_fops);
+	} else
+		kref_get(&io_op->backend->kref);
+	return 0;
+}
+
+static void omnibook_ec_free(struct kref *ref)
+{
+	struct omnibook_backend *backend;
+
+	backend = container_of(ref, struct omnibook_backend, kref);
+	dprintk("EC backend not used anymore: disposing\n");
+	omnibook_backend_lock(backend, "exit");
+	omnibook_ec_irq_release();
+	omnibook_backend_unlock(backend);
+	debugfs_remove(ec_stats_file);
+	ec_stats_file = NULL;
+	backend->data = NULL;
+}
+
+static void omnibook_ec_exit(const struct omnibook_operation *io_op)
+{
+	kref_put(&io_op->backend->kref, omnibook_ec_free);
+}
+
 static int omnibook_ec_display(const struct omnibook_operation *io_op, unsigned int *state)
 {
 	int retval;
@@ -180,9 +820,18 @@ static int omnibook_ec_display(const struct omnibook_operation *io_op, unsigned
 
 struct omnibook_backend ec_backend = {
 	.name = "ec",
+	.init = omnibook_ec_init,
+	.exit = omnibook_ec_exit,
 	.byte_read = omnibook_ec_read,
 	.byte_write = omnibook_ec_write,
+	.block_read = omnibook_ec_block_read,
+	.block_write = omnibook_ec_block_write,
 	.display_get = omnibook_ec_display,
 };
 
+module_param_named(ec_shadow, omnibook_ec_shadow_enable, int, S_IRUGO);
+MODULE_PARM_DESC(ec_shadow, "Use 0 to disable, 1 to enable the EC register shadow cache");
+module_param_named(ec_irq, omnibook_ec_irq, int, S_IRUGO);
+MODULE_PARM_DESC(ec_irq, "Interrupt line of the EC (usually 9) for the legacy EC driver, -1 to poll");
+
 /* End of file */
@@ -0,0 +1,296 @@
+/*
+ * events.c -- /dev/omnibook_events, binary stream of hotkey, AC, dock,
+ *             kill switch and thermal events
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <asm/uaccess.h>
+#include "hardware.h"
+
+/*
+ * Fn keys and key poller bits are raised by their handlers. AC, dock,
+ * kill switch and thermal events are found by comparing telemetry
+ * snapshots: while the device is open the notify.c watcher takes one
+ * every event_interval ms, events are as late as that.
+ */
+
+#define OMNIBOOK_EVENT_RING	128	/* events queued per open file, power of 2 */
+#define OMNIBOOK_EVENT_HYST	2	/* C under event_temperature to rearm */
+
+struct omnibook_event_reader {
+	struct list_head list;
+	wait_queue_head_t wait;
+	unsigned int head;	/* free running, under omnibook_event_lock */
+	unsigned int tail;
+	unsigned int lost;	/* since the last queued event */
+	struct omnibook_event ring[OMNIBOOK_EVENT_RING];
+};
+
+static LIST_HEAD(omnibook_event_readers);
+static DEFINE_SPINLOCK(omnibook_event_lock);
+
+static unsigned int omnibook_event_temperature;	/* C, 0 for no thermal event */
+static unsigned int omnibook_event_interval = 1000;	/* ms, 0 for no sampling */
+static struct omnibook_watch omnibook_event_watch;
+
+/* Last values seen by omnibook_event_telemetry, under event_mutex */
+static struct omnibook_telemetry omnibook_event_last;
+static int omnibook_event_hot;
+static DEFINE_MUTEX(event_mutex);
+
+static inline int event_queued(struct omnibook_event_reader *reader)
+{
+	return reader->head - reader->tail;
+}
+
+/* omnibook_event_lock held */
+static int event_push(struct omnibook_event_reader *reader, const struct omnibook_event *ev)
+{
+	if (event_queued(reader) == OMNIBOOK_EVENT_RING)
+		return 0;
+	reader->ring[reader->head++ % OMNIBOOK_EVENT_RING] = *ev;
+	return 1;
+}
+
+/*
+ * Queue an event for every open file. Any context.
+ */
+void omnibook_event_raise(u32 type, u32 code, s32 value)
+{
+	struct omnibook_event_reader *reader;
+	struct omnibook_event ev, overflow;
+	unsigned long flags;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.timestamp = ktime_to_ns(ktime_get());
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	overflow = ev;
+	overflow.type = OMNIBOOK_EV_OVERFLOW;
+	overflow.code = 0;
+
+	spin_lock_irqsave(&omnibook_event_lock, flags);
+	list_for_each_entry(reader, &omnibook_event_readers, list) {
+		if (reader->lost) {
+			overflow.value = reader->lost;
+			if (event_push(reader, &overflow))
+				reader->lost = 0;
+		}
+		if (reader->lost || !event_push(reader, &ev))
+			reader->lost++;
+		wake_up_interruptible(&reader->wait);
+	}
+	spin_unlock_irqrestore(&omnibook_event_lock, flags);
+}
+
+/*
+ * Compare the snapshot t to the previous one. The first value seen of a
+ * field raises nothing. Snapshots are taken concurrently: one started
+ * before the last one applied is dropped, it would raise a change and
+ * its reverse.
+ */
+void omnibook_event_telemetry(struct omnibook_telemetry *t)
+{
+	struct omnibook_telemetry *last = &omnibook_event_last;
+	int on, hot;
+
+	mutex_lock(&event_mutex);
+	if (t->timestamp < last->timestamp)
+		goto out;
+	last->timestamp = t->timestamp;
+	if (t->valid & OMNIBOOK_TM_AC) {
+		if ((last->valid & OMNIBOOK_TM_AC) && t->ac != last->ac)
+			omnibook_event_raise(OMNIBOOK_EV_AC, 0, t->ac);
+		last->ac = t->ac;
+	}
+	if (t->valid & OMNIBOOK_TM_DOCK) {
+		if ((last->valid & OMNIBOOK_TM_DOCK) && t->dock != last->dock)
+			omnibook_event_raise(OMNIBOOK_EV_DOCK, 0, t->dock);
+		last->dock = t->dock;
+	}
+	if (t->valid & OMNIBOOK_TM_WIFI) {
+		on = !!(t->wifi & KILLSWITCH);
+		if ((last->valid & OMNIBOOK_TM_WIFI) && on != !!(last->wifi & KILLSWITCH))
+			omnibook_event_raise(OMNIBOOK_EV_KILLSWITCH, 0, on);
+		last->wifi = t->wifi;
+	}
+	if ((t->valid & OMNIBOOK_TM_TEMPERATURE) && omnibook_event_temperature) {
+		if (omnibook_event_hot)
+			hot = t->temperature + OMNIBOOK_EVENT_HYST > (int) omnibook_event_temperature;
+		else
+			hot = t->temperature >= (int) omnibook_event_temperature;
+		if (hot != omnibook_event_hot)
+			omnibook_event_raise(OMNIBOOK_EV_THERMAL, hot, t->temperature);
+		omnibook_event_hot = hot;
+	}
+	last->valid |= t->valid;
+      out:
+	mutex_unlock(&event_mutex);
+}
+
+static int omnibook_event_open(struct inode *inode, struct file *file)
+{
+	struct omnibook_event_reader *reader;
+	unsigned long flags;
+
+	reader = kzalloc(sizeof(struct omnibook_event_reader), GFP_KERNEL);
+	if (!reader)
+		return -ENOMEM;
+	init_waitqueue_head(&reader->wait);
+	file->private_data = reader;
+
+	spin_lock_irqsave(&omnibook_event_lock, flags);
+	list_add_tail(&reader->list, &omnibook_event_readers);
+	spin_unlock_irqrestore(&omnibook_event_lock, flags);
+
+	if (omnibook_event_interval)
+		omnibook_notify_watch(&omnibook_event_watch);
+	return nonseekable_open(inode, file);
+}
+
+static int omnibook_event_release(struct inode *inode, struct file *file)
+{
+	struct omnibook_event_reader *reader = file->private_data;
+	unsigned long flags;
+
+	if (omnibook_event_interval)
+		omnibook_notify_unwatch(&omnibook_event_watch);
+
+	spin_lock_irqsave(&omnibook_event_lock, flags);
+	list_del(&reader->list);
+	spin_unlock_irqrestore(&omnibook_event_lock, flags);
+
+	kfree(reader);
+	return 0;
+}
+
+/*
+ * Take the next event, or the pending overflow once the ring is empty
+ */
+static int omnibook_event_pop(struct omnibook_event_reader *reader, struct omnibook_event *ev)
+{
+	unsigned long flags;
+	int retval = 1;
+
+	spin_lock_irqsave(&omnibook_event_lock, flags);
+	if (event_queued(reader)) {
+		*ev = reader->ring[reader->tail++ % OMNIBOOK_EVENT_RING];
+	} else if (reader->lost) {
+		memset(ev, 0, sizeof(*ev));
+		ev->timestamp = ktime_to_ns(ktime_get());
+		ev->type = OMNIBOOK_EV_OVERFLOW;
+		ev->value = reader->lost;
+		reader->lost = 0;
+	} else
+		retval = 0;
+	spin_unlock_irqrestore(&omnibook_event_lock, flags);
+	return retval;
+}
+
+static inline int event_pending(struct omnibook_event_reader *reader)
+{
+	return event_queued(reader) || reader->lost;
+}
+
+static ssize_t omnibook_event_read(struct file *file, char __user *buf, size_t count,
+				   loff_t *ppos)
+{
+	struct omnibook_event_reader *reader = file->private_data;
+	struct omnibook_event ev;
+	size_t len = 0;
+	int retval;
+
+	if (count < sizeof(struct omnibook_event))
+		return -EINVAL;
+
+	while (!event_pending(reader)) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		retval = wait_event_interruptible(reader->wait, event_pending(reader));
+		if (retval)
+			return retval;
+	}
+
+	while (len + sizeof(ev) <= count && omnibook_event_pop(reader, &ev)) {
+		if (copy_to_user(buf + len, &ev, sizeof(ev)))
+			return len ? len : -EFAULT;
+		len += sizeof(ev);
+	}
+	return len;
+}
+
+static unsigned int omnibook_event_poll(struct file *file, poll_table *wait)
+{
+	struct omnibook_event_reader *reader = file->private_data;
+
+	poll_wait(file, &reader->wait, wait);
+	return event_pending(reader) ? POLLIN | POLLRDNORM : 0;
+}
+
+static const struct file_operations omnibook_event_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_event_open,
+	.release = omnibook_event_release,
+	.read = omnibook_event_read,
+	.poll = omnibook_event_poll,
+	.llseek = no_llseek,
+};
+
+static struct miscdevice omnibook_event_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = OMNIBOOK_MODULE_NAME "_events",
+	.fops = &omnibook_event_fops,
+};
+
+static int omnibook_event_registered;
+
+/*
+ * Not fatal, as /dev/omnibook
+ */
+void omnibook_event_init(void)
+{
+	u32 mask = OMNIBOOK_TM_AC | OMNIBOOK_TM_DOCK | OMNIBOOK_TM_WIFI;
+
+	if (omnibook_event_temperature)
+		mask |= OMNIBOOK_TM_TEMPERATURE;
+	omnibook_event_watch.mask = mask;
+	omnibook_event_watch.interval = omnibook_event_interval;
+
+	if (misc_register(&omnibook_event_dev)) {
+		printk(O_WARN "Unable to register /dev/%s, events unavailable.\n",
+		       omnibook_event_dev.name);
+		return;
+	}
+	omnibook_event_registered = 1;
+}
+
+void omnibook_event_exit(void)
+{
+	if (omnibook_event_registered)
+		misc_deregister(&omnibook_event_dev);
+	omnibook_event_registered = 0;
+}
+
+module_param_named(event_temperature, omnibook_event_temperature, uint, S_IRUGO);
+MODULE_PARM_DESC(event_temperature, "CPU temperature in C raising thermal events, 0 to disable");
+module_param_named(event_interval, omnibook_event_interval, uint, S_IRUGO);
+MODULE_PARM_DESC(event_interval, "Period in ms of the AC, dock, kill switch and thermal sampling while /dev/omnibook_events is open, 0 to disable");
+
+/* End of file */
@@ -24,6 +24,21 @@
 static const struct omnibook_operation ctmp_io_op = { EC, XE3GF_CTMP, 0, 0, 0, 0 };
 static const struct omnibook_operation fot_io_op = { EC, XE3GF_FOT, XE3GF_FOT, 0, 0, 0 };
 
+/*
+ * For most models the reading is a bool
+ * It as to be inverted on all but OB6000|OB6100|OB4150|AMILOD
+ * TSP10|XE3GF|TSX205 return an integer
+ */
+static int omnibook_fan_state(u8 fan)
+{
+	if (omnibook_ectype & (TSP10 | XE3GF | TSX205))
+		return fan;
+	else if (omnibook_ectype & (OB6000 | OB6100 | OB4150 | AMILOD))
+		return !!fan;
+	else
+		return !fan;
+}
+
 static int omnibook_get_fan(struct omnibook_operation *io_op)
 {
 	u8 fan;
@@ -32,20 +47,7 @@ static int omnibook_get_fan(struct omnibook_operation *io_op)
 	if ((retval = backend_byte_read(io_op, &fan)))
 		return retval;
 
-	/*
-	 * For most models the reading is a bool
-	 * It as to be inverted on all but OB6000|OB6100|OB4150|AMILOD
-	 * TSP10|XE3GF|TSX205 return an integer
-	 */
-
-	if (omnibook_ectype & (TSP10 | XE3GF | TSX205))
-		retval = fan;
-	else if (omnibook_ectype & (OB6000 | OB6100 | OB4150 | AMILOD))
-		retval = !!fan;
-	else
-		retval = !fan;
-
-	return retval;
+	return omnibook_fan_state(fan);
 }
 
 static int omnibook_fan_on(struct omnibook_operation *io_op)
@@ -66,7 +68,7 @@ static int omnibook_fan_off(struct omnibook_operation *io_op)
 	 */
 		u8 fot, temp, fan;
 
-		if(mutex_lock_interruptible(&io_op->backend->mutex))
+		if(omnibook_op_lock_interruptible(io_op))
 			return -ERESTARTSYS;	
 
 		retval = __backend_byte_read(io_op, &fan);
@@ -97,17 +99,16 @@ static int omnibook_fan_off(struct omnibook_operation *io_op)
 		}
 
 		out:		
-		mutex_unlock(&io_op->backend->mutex);
+		omnibook_op_unlock(io_op);
 	}
 		
 
 	return retval;
 }
 
-static int omnibook_fan_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_fan_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
 	int fan;
-	int len = 0;
 	char *str;
 
 	fan = omnibook_get_fan(io_op);
@@ -116,11 +117,11 @@ static int omnibook_fan_read(char *buffer, struct omnibook_operation *io_op)
 	str = (fan) ? "on" : "off";
 
 	if (fan > 1)
-		len += sprintf(buffer + len, "Fan is %s (level %d)\n", str, fan);
+		seq_printf(m, "Fan is %s (level %d)\n", str, fan);
 	else
-		len += sprintf(buffer + len, "Fan is %s\n", str);
+		seq_printf(m, "Fan is %s\n", str);
 
-	return len;
+	return 0;
 }
 
 static int omnibook_fan_write(char *buffer, struct omnibook_operation *io_op)
@@ -168,11 +169,24 @@ static struct omnibook_tbl fan_table[] __initdata = {
 	{0,}
 };
 
+static int omnibook_fan_telemetry(struct omnibook_telemetry *t, struct omnibook_operation *io_op)
+{
+	u8 fan;
+	int retval;
+
+	if ((retval = __backend_byte_read(io_op, &fan)))
+		return retval;
+	t->fan = omnibook_fan_state(fan);
+	t->valid |= OMNIBOOK_TM_FAN;
+	return 0;
+}
+
 static struct omnibook_feature __declared_feature fan_driver = {
 	.name = "fan",
 	.enabled = 1,
 	.read = omnibook_fan_read,
 	.write = omnibook_fan_write,
+	.telemetry = omnibook_fan_telemetry,
 	.init = omnibook_fan_init,
 	.ectypes = XE3GF | OB500 | OB510 | OB6000 | OB6100 | OB4150 | XE2 | AMILOD | TSP10 | TSX205,
 	.tbl = fan_table,
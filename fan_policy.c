@@ -52,69 +52,50 @@ static const u8 fan_defaults[] = {
 
 static int omnibook_get_fan_policy(struct omnibook_operation *io_op, u8 *fan_policy)
 {
-	int retval ;
-	int i;
-
-	for (i = 0; i < OMNIBOOK_FAN_LEVELS; i++) {
-		io_op->read_addr = XE3GF_FOT + i;
-		if ((retval = __backend_byte_read(io_op, &fan_policy[i])))
-			return retval;
-	}
-
-	return 0;
+	return __backend_block_read(io_op, XE3GF_FOT, fan_policy, OMNIBOOK_FAN_LEVELS);
 }
 
 static int omnibook_set_fan_policy(struct omnibook_operation *io_op, const u8 *fan_policy)
 {
-	int retval;
 	int i;
 
 	if (fan_policy[0] > OMNIBOOK_FOT_MAX)
 		return -EINVAL;
 
 	for (i = 0; i < OMNIBOOK_FAN_LEVELS; i++) {
-		if ((fan_policy[i] > fan_policy[i + 1])
+		if ((i < OMNIBOOK_FAN_LEVELS - 1 && fan_policy[i] > fan_policy[i + 1])
 		    || (fan_policy[i] < OMNIBOOK_FAN_MIN)
 		    || (fan_policy[i] > OMNIBOOK_FAN_MAX))
 			return -EINVAL;
 	}
-	for (i = 0; i < OMNIBOOK_FAN_LEVELS; i++) {
-		io_op->write_addr = XE3GF_FOT + i;
-		if ((retval = __backend_byte_write(io_op, fan_policy[i])))
-			return retval;
-	}
-
-	return 0;
+	return __backend_block_write(io_op, XE3GF_FOT, fan_policy, OMNIBOOK_FAN_LEVELS);
 }
 
-static int omnibook_fan_policy_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_fan_policy_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
 	int retval;
-	int len = 0;
 	u8 i;
 	u8 fan_policy[OMNIBOOK_FAN_LEVELS];
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
 	retval = omnibook_get_fan_policy(io_op, &fan_policy[0]);
 
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 
 	if(retval)
 		return retval;
 
-	len += sprintf(buffer + len, "Fan off temperature:        %2d C\n", fan_policy[0]);
-	len += sprintf(buffer + len, "Fan on temperature:         %2d C\n", fan_policy[1]);
+	seq_printf(m, "Fan off temperature:        %2d C\n", fan_policy[0]);
+	seq_printf(m, "Fan on temperature:         %2d C\n", fan_policy[1]);
 	for (i = 2; i < OMNIBOOK_FAN_LEVELS; i++) {
-		len +=
-		    sprintf(buffer + len, "Fan level %1d temperature:    %2d C\n", i,
-			    fan_policy[i]);
+		seq_printf(m, "Fan level %1d temperature:    %2d C\n", i, fan_policy[i]);
 	}
-	len += sprintf(buffer + len, "Minimal temperature to set: %2d C\n", OMNIBOOK_FAN_MIN);
-	len += sprintf(buffer + len, "Maximal temperature to set: %2d C\n", OMNIBOOK_FAN_MAX);
+	seq_printf(m, "Minimal temperature to set: %2d C\n", OMNIBOOK_FAN_MIN);
+	seq_printf(m, "Maximal temperature to set: %2d C\n", OMNIBOOK_FAN_MAX);
 
-	return len;
+	return 0;
 }
 
 static int omnibook_fan_policy_write(char *buffer, struct omnibook_operation *io_op)
@@ -126,7 +107,7 @@ static int omnibook_fan_policy_write(char *buffer, struct omnibook_operation *io
 	int temp;
 	u8 fan_policy[OMNIBOOK_FAN_LEVELS];
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
 	if ((retval = omnibook_get_fan_policy(io_op, &fan_policy[0])))
@@ -165,7 +146,7 @@ static int omnibook_fan_policy_write(char *buffer, struct omnibook_operation *io
 		retval = omnibook_set_fan_policy(io_op, &fan_policy[0]);
 
 	out:
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
@@ -0,0 +1,224 @@
+/*
+ * flight.c -- flight recorder of backend calls
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/percpu.h>
+#include <linux/smp.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <asm/div64.h>
+#include "hardware.h"
+
+/*
+ * Every call made through the helpers of hardware.h is recorded in a ring
+ * of the CPU it runs on, overwriting the oldest entries. Writers only
+ * disable preemption. Readers, which may run on any CPU, rely on the
+ * sequence number of each entry: it is cleared before the entry is
+ * modified and set again once it is complete, so a torn copy is detected
+ * and dropped.
+ *
+ * The rings are dumped, merged by time, in debugfs as omnibook/flight.
+ */
+
+#define OMNIBOOK_FLIGHT_ENTRIES	256	/* per CPU, power of 2 */
+
+struct omnibook_flight_entry {
+	unsigned long seq;	/* 0 while being written */
+	s64 stamp;		/* ns, ktime */
+	u32 duration;		/* ns */
+	int retval;
+	const char *backend;
+	const char *op;
+	unsigned long addr;
+	unsigned int value;
+	int cpu;
+};
+
+struct omnibook_flight_ring {
+	unsigned long seq;	/* entries written so far */
+	struct omnibook_flight_entry entry[OMNIBOOK_FLIGHT_ENTRIES];
+};
+
+/* Too big for the static per-cpu area of modules */
+static struct omnibook_flight_ring *omnibook_flight;
+
+/*
+ * Record a call which started at start
+ */
+void omnibook_flight_record(const struct omnibook_backend *backend, const char *op,
+			    unsigned long addr, unsigned int value, int retval, ktime_t start)
+{
+	struct omnibook_flight_ring *ring;
+	struct omnibook_flight_entry *e;
+	ktime_t now = ktime_get();
+	unsigned long seq;
+	int cpu;
+
+	if (unlikely(!omnibook_flight))
+		return;
+
+	cpu = get_cpu();
+	ring = per_cpu_ptr(omnibook_flight, cpu);
+	seq = ++ring->seq;
+	e = &ring->entry[seq & (OMNIBOOK_FLIGHT_ENTRIES - 1)];
+
+	e->seq = 0;
+	smp_wmb();
+	e->stamp = ktime_to_ns(start);
+	e->duration = min_t(s64, ktime_to_ns(ktime_sub(now, start)), ~0U);
+	e->retval = retval;
+	e->backend = backend->name;
+	e->op = op;
+	e->addr = addr;
+	e->value = value;
+	e->cpu = cpu;
+	smp_wmb();
+	e->seq = seq;
+
+	put_cpu();
+}
+
+/*
+ * debugfs dump: a snapshot of all rings is taken at open
+ */
+
+struct omnibook_flight_snapshot {
+	unsigned int count;
+	struct omnibook_flight_entry entry[0];
+};
+
+static int omnibook_flight_cmp(const void *a, const void *b)
+{
+	const struct omnibook_flight_entry *x = a;
+	const struct omnibook_flight_entry *y = b;
+
+	if (x->stamp < y->stamp)
+		return -1;
+	return x->stamp > y->stamp;
+}
+
+static struct omnibook_flight_snapshot *omnibook_flight_snapshot(void)
+{
+	struct omnibook_flight_snapshot *snap;
+	struct omnibook_flight_ring *ring;
+	struct omnibook_flight_entry *e;
+	unsigned long seq;
+	unsigned int size = 0;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu)
+		size += OMNIBOOK_FLIGHT_ENTRIES;
+
+	snap = vmalloc(sizeof(struct omnibook_flight_snapshot) +
+		       size * sizeof(struct omnibook_flight_entry));
+	if (!snap)
+		return NULL;
+	snap->count = 0;
+	if (!omnibook_flight)
+		return snap;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(omnibook_flight, cpu);
+		for (i = 0; i < OMNIBOOK_FLIGHT_ENTRIES; i++) {
+			e = &snap->entry[snap->count];
+			seq = ring->entry[i].seq;
+			smp_rmb();
+			*e = ring->entry[i];
+			smp_rmb();
+			if (!seq || ring->entry[i].seq != seq)
+				continue;	/* empty or torn */
+			snap->count++;
+		}
+	}
+
+	sort(snap->entry, snap->count, sizeof(struct omnibook_flight_entry),
+	     omnibook_flight_cmp, NULL);
+	return snap;
+}
+
+static int omnibook_flight_show(struct seq_file *m, void *v)
+{
+	struct omnibook_flight_snapshot *snap = m->private;
+	struct omnibook_flight_entry *e;
+	unsigned long nsec;
+	u64 sec;
+	unsigned int i;
+
+	for (i = 0; i < snap->count; i++) {
+		e = &snap->entry[i];
+		sec = e->stamp;
+		nsec = do_div(sec, NSEC_PER_SEC);
+		seq_printf(m, "[%5lu.%09lu] cpu%i %-6s %-12s addr 0x%02lx value 0x%02x ret %i %u ns\n",
+			   (unsigned long) sec, nsec, e->cpu, e->backend, e->op, e->addr,
+			   e->value, e->retval, e->duration);
+	}
+	return 0;
+}
+
+static int omnibook_flight_open(struct inode *inode, struct file *file)
+{
+	struct omnibook_flight_snapshot *snap;
+	int retval;
+
+	snap = omnibook_flight_snapshot();
+	if (!snap)
+		return -ENOMEM;
+	retval = single_open(file, omnibook_flight_show, snap);
+	if (retval)
+		vfree(snap);
+	return retval;
+}
+
+static int omnibook_flight_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	vfree(m->private);
+	return single_release(inode, file);
+}
+
+static const struct file_operations omnibook_flight_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_flight_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = omnibook_flight_release,
+};
+
+/*
+ * Not fatal: the driver works without the recorder
+ */
+int __init omnibook_flight_init(void)
+{
+	omnibook_flight = alloc_percpu(struct omnibook_flight_ring);
+	if (!omnibook_flight)
+		printk(O_WARN "Unable to allocate the flight recorder.\n");
+	return 0;
+}
+
+void omnibook_flight_exit(void)
+{
+	free_percpu(omnibook_flight);
+	omnibook_flight = NULL;
+}
+
+void omnibook_flight_debugfs(void)
+{
+	omnibook_debugfs_file(NULL, "flight", S_IRUSR, &omnibook_flight_fops);
+}
+
+/* End of file */
@@ -16,7 +16,12 @@
  */
 
 #include <linux/acpi.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 #include "compat.h"
+#include "omnibook_telemetry.h"
 
 /*
  * Quite ugly:
@@ -33,6 +38,7 @@ struct omnibook_operation {
 		u8 read_mask; /* read mask */
 		int on_mask; /* mask to set (pos value) or unset (neg value) to put feature in on state */
 		int off_mask; /* mask to set (pos value) or unset (neg value) to put feature in off state */
+		const char *feature; /* name of the feature owning it, for tracing, may be NULL */
 };
 
 #define COMMAND(backend,data_on,data_off) { backend, 0, 0, 0, data_on, data_off }
@@ -43,6 +49,153 @@ struct omnibook_tbl {
 	struct omnibook_operation io_op;
 };
 
+/*
+ * Recent wait latencies of a backend and the timeout derived from them,
+ * see timeout.c
+ */
+
+#define OMNIBOOK_LATENCY_SAMPLES	128
+
+struct omnibook_latency {
+	spinlock_t lock;
+	u32 samples[OMNIBOOK_LATENCY_SAMPLES];	/* ring of recent latencies in us */
+	u32 sorted[OMNIBOOK_LATENCY_SAMPLES];	/* scratch space for estimation */
+	unsigned int head;		/* next slot in samples */
+	unsigned int count;		/* valid entries in samples */
+	unsigned int fresh;		/* samples added since last estimation */
+	u32 p50;			/* median, us */
+	u32 p99;			/* 99th percentile, us */
+	unsigned int learned;		/* timeout derived from p99, 0 until enough samples, us */
+	unsigned int last;		/* last timeout handed out, us */
+	unsigned long expired;		/* waits which ran past their timeout */
+	int wedged;			/* last wait ran out at the ceiling */
+	struct dentry *dentry;		/* debugfs file */
+};
+
+/*
+ * Latency histograms of a backend by operation type, see histogram.c
+ * Bucket i counts operations which took [2^(i-1), 2^i) ns.
+ */
+
+enum omnibook_hist_type {
+	OMNIBOOK_HIST_READ,		/* byte_read */
+	OMNIBOOK_HIST_WRITE,		/* byte_write */
+	OMNIBOOK_HIST_BLOCK_READ,	/* block_read */
+	OMNIBOOK_HIST_BLOCK_WRITE,	/* block_write */
+	OMNIBOOK_HIST_SMI,		/* SMI call */
+	OMNIBOOK_HIST_ACPI,		/* ACPI method evaluation */
+	OMNIBOOK_HIST_CDI,		/* CDI command */
+	OMNIBOOK_HIST_TYPES,
+};
+
+#define OMNIBOOK_HIST_BUCKETS	33
+
+struct omnibook_hist {
+	unsigned long count;
+	u32 min;			/* ns */
+	u32 max;			/* ns */
+	u32 bucket[OMNIBOOK_HIST_BUCKETS];
+};
+
+struct omnibook_histogram {
+	spinlock_t lock;
+	struct omnibook_hist type[OMNIBOOK_HIST_TYPES];
+	struct dentry *dentry;		/* debugfs file */
+};
+
+/*
+ * Binary trace of backend transactions, see record.c
+ * Fields are in the byte order of the machine which recorded the trace.
+ */
+
+#define OMNIBOOK_RECORD_MAGIC		"OBTR"
+#define OMNIBOOK_RECORD_VERSION		1
+#define OMNIBOOK_RECORD_BACKENDS	8
+#define OMNIBOOK_RECORD_NAME_LEN	8
+
+enum omnibook_record_type {
+	OMNIBOOK_REC_READ,		/* byte_read, addr is read_addr */
+	OMNIBOOK_REC_WRITE,		/* byte_write, addr is write_addr */
+	OMNIBOOK_REC_BLOCK_READ,	/* block_read, value is the length */
+	OMNIBOOK_REC_BLOCK_WRITE,	/* block_write, value is the length */
+	OMNIBOOK_REC_AERIAL_GET,
+	OMNIBOOK_REC_AERIAL_SET,
+	OMNIBOOK_REC_HOTKEYS_GET,
+	OMNIBOOK_REC_HOTKEYS_SET,
+	OMNIBOOK_REC_DISPLAY_GET,
+	OMNIBOOK_REC_DISPLAY_SET,
+	OMNIBOOK_REC_THROTTLE_GET,
+	OMNIBOOK_REC_THROTTLE_SET,
+	OMNIBOOK_REC_SMI,		/* SMI call, addr is the function code */
+	OMNIBOOK_REC_ACPI,		/* ACPI method, addr is its last name segment */
+	OMNIBOOK_REC_TYPES,
+};
+
+struct omnibook_record_header {
+	char magic[4];
+	u16 version;
+	u16 record_size;		/* sizeof(struct omnibook_record) */
+	u32 ectype;			/* omnibook_ectype of the recording machine */
+	u32 count;			/* records following the header */
+	u32 dropped;			/* records lost to a full buffer */
+	char backend[OMNIBOOK_RECORD_BACKENDS][OMNIBOOK_RECORD_NAME_LEN];
+};
+
+struct omnibook_record {
+	s32 delta;			/* ns since the start of the previous record */
+	u32 duration;			/* ns */
+	u32 addr;
+	u16 value;
+	s16 retval;
+	u8 backend;			/* index in the header backend names */
+	u8 type;			/* enum omnibook_record_type */
+	u16 reserved;
+};
+
+/*
+ * Backend mutex statistics by owner, see lockstat.c
+ * Access with backend mutex held.
+ */
+
+#define OMNIBOOK_LOCKSTAT_OWNERS	16
+
+struct omnibook_lockstat_owner {
+	const char *name;		/* feature name or backend internal user */
+	unsigned long acquired;
+	unsigned long contended;	/* had to wait for the mutex */
+	u64 wait_total;			/* ns */
+	u64 wait_max;			/* ns */
+	u64 hold_total;			/* ns */
+	u64 hold_max;			/* ns */
+};
+
+struct omnibook_lockstat {
+	struct omnibook_lockstat_owner owner[OMNIBOOK_LOCKSTAT_OWNERS];
+	struct omnibook_lockstat_owner *holder;	/* current holder */
+	ktime_t since;				/* when holder got the mutex */
+	struct dentry *dentry;			/* debugfs file */
+};
+
+/*
+ * Circuit breaker of a backend, see breaker.c
+ * Access with backend mutex held.
+ */
+
+enum omnibook_breaker_state {
+	OMNIBOOK_BREAKER_CLOSED,	/* normal operation */
+	OMNIBOOK_BREAKER_OPEN,		/* failing fast until cool-down is over */
+	OMNIBOOK_BREAKER_HALF_OPEN,	/* letting a probe transaction through */
+};
+
+struct omnibook_breaker {
+	enum omnibook_breaker_state state;
+	unsigned int failures;		/* consecutive timeouts */
+	unsigned long opened;		/* jiffies of the last trip */
+	unsigned long trips;		/* times the breaker opened */
+	unsigned long rejected;		/* calls failed fast */
+	struct dentry *dentry;		/* debugfs file */
+};
+
 /*
  * Backend interface definition
  */
@@ -64,6 +217,8 @@ struct omnibook_backend {
 	void (*exit) (const struct omnibook_operation *);
 	int (*byte_read) (const struct omnibook_operation *, u8 *); 
 	int (*byte_write) (const struct omnibook_operation *, u8);
+	int (*block_read) (const struct omnibook_operation *, unsigned long, u8 *, int);
+	int (*block_write) (const struct omnibook_operation *, unsigned long, const u8 *, int);
 	int (*aerial_get) (const struct omnibook_operation *, unsigned int *);
 	int (*aerial_set) (const struct omnibook_operation *, unsigned int);
 	int (*hotkeys_get) (const struct omnibook_operation *, unsigned int *);
@@ -77,6 +232,15 @@ struct omnibook_backend {
 	struct kref kref;	/* Reference counter of this backend */
 	void *data;		/* private data pointer */
 	int already_failed;	/* Backend init already failed at least once */
+	struct omnibook_breaker breaker;	/* runtime counterpart of already_failed */
+	struct dentry *debugfs_dir;	/* debugfs directory, see debugfs.c */
+	struct list_head queue;		/* pending requests, see queue.c */
+	spinlock_t queue_lock;		/* protects queue and queue_open */
+	int queue_open;			/* requests are accepted */
+	struct work_struct queue_work;	/* drains queue */
+	struct omnibook_latency latency;	/* see timeout.c */
+	struct omnibook_histogram histogram;	/* see histogram.c */
+	struct omnibook_lockstat lockstat;	/* see lockstat.c */
 };
 
 extern struct omnibook_backend kbc_backend;
@@ -85,6 +249,10 @@ extern struct omnibook_backend ec_backend;
 extern struct omnibook_backend acpi_backend;
 extern struct omnibook_backend nbsmi_backend;
 extern struct omnibook_backend compal_backend;
+extern struct omnibook_backend sim_backend;
+
+extern int omnibook_simulated;	/* ectype=sim:<n>, see simulated.c */
+int omnibook_sim_replay_load(const void *trace, size_t len);
 
 #define KBC   &kbc_backend
 #define PIO   &pio_backend
@@ -95,42 +263,281 @@ extern struct omnibook_backend compal_backend;
 
 int __omnibook_apply_write_mask(const struct omnibook_operation *io_op, int toggle);
 int __omnibook_toggle(const struct omnibook_operation *io_op, int toggle);
+int __omnibook_block_read_bytes(const struct omnibook_operation *io_op, unsigned long addr,
+				u8 *buf, int len);
+int __omnibook_block_write_bytes(const struct omnibook_operation *io_op, unsigned long addr,
+				 const u8 *buf, int len);
+
+void omnibook_ec_shadow_invalidate(void);
+void __omnibook_ec_shadow_forget(unsigned long addr, int len);
+
+extern struct omnibook_backend *omnibook_backends[];
+
+int __omnibook_breaker_check(struct omnibook_backend *backend);
+int __omnibook_breaker_result(struct omnibook_backend *backend, int retval);
+void omnibook_breaker_reset(struct omnibook_backend *backend);
+void omnibook_breaker_debugfs(struct omnibook_backend *backend);
+
+void omnibook_flight_record(const struct omnibook_backend *backend, const char *op,
+			    unsigned long addr, unsigned int value, int retval, ktime_t start);
+void omnibook_flight_debugfs(void);
+
+extern int omnibook_recording;	/* see record.c */
+void __omnibook_record(const struct omnibook_backend *backend, enum omnibook_record_type type,
+		       unsigned long addr, unsigned int value, int retval, ktime_t start);
+void __omnibook_record_op(const struct omnibook_backend *backend, const char *op,
+			  unsigned long addr, unsigned int value, int retval, ktime_t start);
+u32 omnibook_record_name(const char *method);
+int omnibook_record_start(unsigned int entries);
+void *omnibook_record_snapshot(size_t *len);
+void omnibook_record_debugfs(void);
+
+void omnibook_lockstat_acquired(struct omnibook_backend *backend, const char *name,
+				const ktime_t *start);
+void omnibook_lockstat_release(struct omnibook_backend *backend);
+void omnibook_lockstat_debugfs(struct omnibook_backend *backend);
+
+extern int omnibook_stalling;	/* see stall.c */
+void __omnibook_stall_op(struct omnibook_backend *backend, enum omnibook_hist_type type);
+struct seq_file;
+int omnibook_stall_run(unsigned int reads, unsigned int cpu);
+int omnibook_stall_show(struct seq_file *m, void *v);
+void omnibook_stall_debugfs(void);
+
+int omnibook_telemetry_sample(struct omnibook_telemetry *t, u32 mask);	/* see telemetry.c */
+int omnibook_telemetry_snapshot(struct omnibook_telemetry *t);
+u32 omnibook_telemetry_available(void);
+struct omnibook_watch {		/* see notify.c */
+	u32 mask;			/* OMNIBOOK_TM_* to sample */
+	unsigned int interval;		/* ms */
+	unsigned int users;
+	struct list_head list;
+};
+void omnibook_notify_update(struct omnibook_telemetry *t);
+void omnibook_notify_watch(struct omnibook_watch *w);
+void omnibook_notify_unwatch(struct omnibook_watch *w);
+void omnibook_event_raise(u32 type, u32 code, s32 value);	/* see events.c */
+void omnibook_event_telemetry(struct omnibook_telemetry *t);
+
+extern const char *omnibook_hist_name[OMNIBOOK_HIST_TYPES];
+void omnibook_histogram_init(struct omnibook_backend *backend);
+void omnibook_histogram_debugfs(struct omnibook_backend *backend);
+void omnibook_histogram_add(struct omnibook_backend *backend, enum omnibook_hist_type type,
+			    ktime_t start);
+
+void omnibook_latency_init(struct omnibook_backend *backend);
+void omnibook_latency_debugfs(struct omnibook_backend *backend);
+void omnibook_latency_reset(struct omnibook_backend *backend);
+void omnibook_latency_add(struct omnibook_backend *backend, ktime_t start);
+unsigned int omnibook_latency_expired(struct omnibook_backend *backend, unsigned int timeout,
+				      unsigned int ceiling);
+unsigned int omnibook_timeout(struct omnibook_backend *backend, unsigned int ceiling);
+
+/*
+ * Whether timeout us elapsed since start, for the waits which poll with
+ * mdelay() rather than count jiffies
+ */
+static inline int omnibook_timed_out(ktime_t start, unsigned int timeout)
+{
+	return ktime_to_ns(ktime_sub(ktime_get(), start)) >= (s64) timeout * NSEC_PER_USEC;
+}
+
+struct dentry;
+struct file_operations;
+struct dentry *omnibook_debugfs_dir(struct omnibook_backend *backend);
+struct dentry *omnibook_debugfs_file(struct omnibook_backend *backend, const char *name,
+				     mode_t mode, const struct file_operations *fops);
+
+/*
+ * Asynchronous requests, see queue.c
+ * The request is run by a worker with the backend mutex held, then the
+ * complete callback is called without the mutex.
+ */
+
+enum omnibook_request_type {
+	OMNIBOOK_REQ_READ,	/* __backend_byte_read into data */
+	OMNIBOOK_REQ_WRITE,	/* __backend_byte_write of data */
+	OMNIBOOK_REQ_TOGGLE,	/* __omnibook_toggle with data as state */
+	OMNIBOOK_REQ_FUNC,	/* call func */
+};
+
+#define OMNIBOOK_REQ_AUTOFREE	(1<<0)	/* kfree after completion, nobody waits */
+
+struct omnibook_request {
+	struct list_head list;
+	enum omnibook_request_type type;
+	const struct omnibook_operation *io_op;
+	u8 data;					/* byte read, written or toggle state */
+	int (*func) (struct omnibook_request *);	/* OMNIBOOK_REQ_FUNC handler */
+	void (*complete) (struct omnibook_request *);	/* completion callback, may be NULL */
+	void *context;					/* free for the submitter */
+	int retval;					/* result of the request */
+	int flags;
+	struct completion done;
+};
+
+int omnibook_queue_init(void);
+void omnibook_queue_exit(void);
+void omnibook_request_init(struct omnibook_request *req, enum omnibook_request_type type,
+			   const struct omnibook_operation *io_op);
+struct omnibook_request *omnibook_request_alloc(enum omnibook_request_type type,
+						const struct omnibook_operation *io_op,
+						gfp_t gfp);
+int omnibook_request_submit(struct omnibook_request *req);
+int omnibook_request_wait(struct omnibook_request *req);
+
+#include "omnibook_trace.h"
+
+/*
+ * Backend mutex wrappers, owner is who is accounted for the wait and hold
+ * times, see lockstat.c. The omnibook_op_ variants use the feature name
+ * of io_op. The uncontended case only costs a trylock and two ktime_get.
+ */
+
+static inline void omnibook_backend_lock(struct omnibook_backend *backend, const char *owner)
+{
+	ktime_t start;
+
+	if (mutex_trylock(&backend->mutex)) {
+		omnibook_lockstat_acquired(backend, owner, NULL);
+		return;
+	}
+	start = ktime_get();
+	mutex_lock(&backend->mutex);
+	omnibook_lockstat_acquired(backend, owner, &start);
+}
+
+static inline int omnibook_backend_lock_interruptible(struct omnibook_backend *backend,
+						      const char *owner)
+{
+	ktime_t start;
+	int retval;
+
+	if (mutex_trylock(&backend->mutex)) {
+		omnibook_lockstat_acquired(backend, owner, NULL);
+		return 0;
+	}
+	start = ktime_get();
+	retval = mutex_lock_interruptible(&backend->mutex);
+	if (!retval)
+		omnibook_lockstat_acquired(backend, owner, &start);
+	return retval;
+}
+
+static inline void omnibook_backend_unlock(struct omnibook_backend *backend)
+{
+	omnibook_lockstat_release(backend);
+	mutex_unlock(&backend->mutex);
+}
+
+static inline void omnibook_op_lock(const struct omnibook_operation *io_op)
+{
+	omnibook_backend_lock(io_op->backend, io_op->feature);
+}
+
+static inline int omnibook_op_lock_interruptible(const struct omnibook_operation *io_op)
+{
+	return omnibook_backend_lock_interruptible(io_op->backend, io_op->feature);
+}
+
+static inline void omnibook_op_unlock(const struct omnibook_operation *io_op)
+{
+	omnibook_backend_unlock(io_op->backend);
+}
+
+/*
+ * Transaction trace, only taken while a recording is in progress
+ */
+static inline void omnibook_record(const struct omnibook_backend *backend,
+				   enum omnibook_record_type type, unsigned long addr,
+				   unsigned int value, int retval, ktime_t start)
+{
+	if (unlikely(omnibook_recording))
+		__omnibook_record(backend, type, addr, value, retval, start);
+}
+
+/*
+ * Account a backend call which started at start: flight recorder,
+ * transaction trace and the omnibook_<event> tracepoint.
+ */
+#define omnibook_op_done(event, io_op, op, addr, value, retval, start) \
+do { \
+	omnibook_flight_record((io_op)->backend, op, addr, value, retval, start); \
+	if (unlikely(omnibook_recording)) \
+		__omnibook_record_op((io_op)->backend, op, addr, value, retval, start); \
+	trace_omnibook_##event(io_op, op, addr, value, retval, start); \
+} while (0)
+
+/*
+ * Circuit breaker hooks, called around every backend call with mutex held.
+ * Only the closed state with no pending failure is handled inline.
+ */
+
+static inline int omnibook_breaker_check(struct omnibook_backend *backend)
+{
+	if (likely(backend->breaker.state == OMNIBOOK_BREAKER_CLOSED))
+		return 0;
+	return __omnibook_breaker_check(backend);
+}
+
+static inline int omnibook_breaker_result(struct omnibook_backend *backend, int retval)
+{
+	if (likely(retval != -ETIME && !backend->breaker.failures &&
+		   backend->breaker.state == OMNIBOOK_BREAKER_CLOSED))
+		return retval;
+	return __omnibook_breaker_result(backend, retval);
+}
 
 /*
  * Lock helper functions. Defines locking and __prefixed non locking variants.
  */
 
 #define helper_func(func) \
-static inline int backend_##func##_get(const struct omnibook_operation *io_op, unsigned int *data) \
+static inline int __backend_##func##_get(const struct omnibook_operation *io_op, unsigned int *data) \
 { \
 	int retval; \
-	if(mutex_lock_interruptible(&io_op->backend->mutex)) \
-		return -ERESTARTSYS; \
+	ktime_t start; \
+	WARN_ON(!mutex_is_locked(&io_op->backend->mutex)); \
+	if ((retval = omnibook_breaker_check(io_op->backend))) \
+		return retval; \
+	start = ktime_get(); \
 	retval = io_op->backend->func##_get(io_op, data); \
-	mutex_unlock(&io_op->backend->mutex); \
-	return retval; \
+	omnibook_op_done(get, io_op, #func "_get", io_op->read_addr, \
+			 retval < 0 ? 0 : *data, retval, start); \
+	return omnibook_breaker_result(io_op->backend, retval); \
 } \
-static inline int backend_##func##_set(const struct omnibook_operation *io_op, unsigned int data) \
+static inline int __backend_##func##_set(const struct omnibook_operation *io_op, unsigned int data) \
 { \
 	int retval; \
-	if(mutex_lock_interruptible(&io_op->backend->mutex)) \
-		return -ERESTARTSYS; \
+	ktime_t start; \
+	WARN_ON(!mutex_is_locked(&io_op->backend->mutex)); \
+	if ((retval = omnibook_breaker_check(io_op->backend))) \
+		return retval; \
+	start = ktime_get(); \
 	retval = io_op->backend->func##_set(io_op, data); \
-	mutex_unlock(&io_op->backend->mutex); \
-	return retval; \
-}\
-static inline int __backend_##func##_get(const struct omnibook_operation *io_op, unsigned int *data) \
+	omnibook_op_done(set, io_op, #func "_set", io_op->write_addr, data, retval, start); \
+	return omnibook_breaker_result(io_op->backend, retval); \
+} \
+static inline int backend_##func##_get(const struct omnibook_operation *io_op, unsigned int *data) \
 { \
 	int retval; \
-	WARN_ON(!mutex_is_locked(&io_op->backend->mutex)); \
-	retval = io_op->backend->func##_get(io_op, data); \
+	ktime_t start = ktime_get(); \
+	if(omnibook_op_lock_interruptible(io_op)) \
+		return -ERESTARTSYS; \
+	retval = __backend_##func##_get(io_op, data); \
+	omnibook_op_unlock(io_op); \
+	trace_omnibook_locked(io_op, #func "_get", io_op->read_addr, retval < 0 ? 0 : *data, retval, start); \
 	return retval; \
 } \
-static inline int __backend_##func##_set(const struct omnibook_operation *io_op, unsigned int data) \
+static inline int backend_##func##_set(const struct omnibook_operation *io_op, unsigned int data) \
 { \
 	int retval; \
-	WARN_ON(!mutex_is_locked(&io_op->backend->mutex)); \
-	retval = io_op->backend->func##_set(io_op, data); \
+	ktime_t start = ktime_get(); \
+	if(omnibook_op_lock_interruptible(io_op)) \
+		return -ERESTARTSYS; \
+	retval = __backend_##func##_set(io_op, data); \
+	omnibook_op_unlock(io_op); \
+	trace_omnibook_locked(io_op, #func "_set", io_op->write_addr, data, retval, start); \
 	return retval; \
 }
 
@@ -139,68 +546,138 @@ helper_func(hotkeys)
 helper_func(display)
 helper_func(throttle)
 
-static inline int backend_byte_read(const struct omnibook_operation *io_op, u8 *data)
+static inline int __backend_byte_read(const struct omnibook_operation *io_op, u8 *data)
 {
 	int retval;
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
-		return -ERESTARTSYS;
+	ktime_t start;
+	WARN_ON(!mutex_is_locked(&io_op->backend->mutex));
+	if ((retval = omnibook_breaker_check(io_op->backend)))
+		return retval;
+	start = ktime_get();
 	retval = io_op->backend->byte_read(io_op, data);
-	mutex_unlock(&io_op->backend->mutex);
-	return retval;
+	omnibook_histogram_add(io_op->backend, OMNIBOOK_HIST_READ, start);
+	omnibook_op_done(byte_read, io_op, "read", io_op->read_addr,
+			 retval < 0 ? 0 : *data, retval, start);
+	return omnibook_breaker_result(io_op->backend, retval);
 }
 
-static inline int backend_byte_write(const struct omnibook_operation *io_op, u8 data)
+static inline int __backend_byte_write(const struct omnibook_operation *io_op, u8 data)
 {
 	int retval;
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
-		return -ERESTARTSYS;
+	ktime_t start;
+	WARN_ON(!mutex_is_locked(&io_op->backend->mutex));
+	if ((retval = omnibook_breaker_check(io_op->backend)))
+		return retval;
+	start = ktime_get();
 	retval = io_op->backend->byte_write(io_op, data);
-	mutex_unlock(&io_op->backend->mutex);
-	return retval;
+	omnibook_histogram_add(io_op->backend, OMNIBOOK_HIST_WRITE, start);
+	omnibook_op_done(byte_write, io_op, "write", io_op->write_addr, data, retval, start);
+	return omnibook_breaker_result(io_op->backend, retval);
 }
 
-static inline int __backend_byte_read(const struct omnibook_operation *io_op, u8 *data)
+static inline int backend_byte_read(const struct omnibook_operation *io_op, u8 *data)
 {
 	int retval;
-	WARN_ON(!mutex_is_locked(&io_op->backend->mutex));
-	retval = io_op->backend->byte_read(io_op, data);
+	ktime_t start = ktime_get();
+	if(omnibook_op_lock_interruptible(io_op))
+		return -ERESTARTSYS;
+	retval = __backend_byte_read(io_op, data);
+	omnibook_op_unlock(io_op);
+	trace_omnibook_locked(io_op, "read", io_op->read_addr, retval < 0 ? 0 : *data, retval, start);
 	return retval;
 }
 
-static inline int __backend_byte_write(const struct omnibook_operation *io_op, u8 data)
+static inline int backend_byte_write(const struct omnibook_operation *io_op, u8 data)
 {
 	int retval;
-	WARN_ON(!mutex_is_locked(&io_op->backend->mutex));
-	retval = io_op->backend->byte_write(io_op, data);
+	ktime_t start = ktime_get();
+	if(omnibook_op_lock_interruptible(io_op))
+		return -ERESTARTSYS;
+	retval = __backend_byte_write(io_op, data);
+	omnibook_op_unlock(io_op);
+	trace_omnibook_locked(io_op, "write", io_op->write_addr, data, retval, start);
 	return retval;
 }
 
+/*
+ * Block helpers: access len consecutive registers starting at addr, the
+ * io_op addresses are ignored and read_mask is never applied.
+ * Backends without block support fall back to a loop of byte accesses.
+ */
+
+#define block_helper_func(func, buf_type, hist) \
+static inline int __backend_block_##func(const struct omnibook_operation *io_op, \
+					 unsigned long addr, buf_type buf, int len) \
+{ \
+	int retval; \
+	ktime_t start; \
+	WARN_ON(!mutex_is_locked(&io_op->backend->mutex)); \
+	if ((retval = omnibook_breaker_check(io_op->backend))) \
+		return retval; \
+	start = ktime_get(); \
+	if (io_op->backend->block_##func) \
+		retval = io_op->backend->block_##func(io_op, addr, buf, len); \
+	else \
+		retval = __omnibook_block_##func##_bytes(io_op, addr, buf, len); \
+	omnibook_histogram_add(io_op->backend, hist, start); \
+	omnibook_op_done(block_##func, io_op, "block_" #func, addr, len, retval, start); \
+	return omnibook_breaker_result(io_op->backend, retval); \
+} \
+static inline int backend_block_##func(const struct omnibook_operation *io_op, \
+				       unsigned long addr, buf_type buf, int len) \
+{ \
+	int retval; \
+	ktime_t start = ktime_get(); \
+	if(omnibook_op_lock_interruptible(io_op)) \
+		return -ERESTARTSYS; \
+	retval = __backend_block_##func(io_op, addr, buf, len); \
+	omnibook_op_unlock(io_op); \
+	trace_omnibook_locked(io_op, "block_" #func, addr, len, retval, start); \
+	return retval; \
+}
+
+block_helper_func(read, u8 *, OMNIBOOK_HIST_BLOCK_READ)
+block_helper_func(write, const u8 *, OMNIBOOK_HIST_BLOCK_WRITE)
+
 static inline int omnibook_apply_write_mask(const struct omnibook_operation *io_op, int toggle)
 {
 	int retval;
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	ktime_t start = ktime_get();
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 	retval = __omnibook_apply_write_mask(io_op, toggle);
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
+	trace_omnibook_locked(io_op, "apply_write_mask", io_op->write_addr, toggle, retval, start);
 	return retval;
 }
 
 static inline int omnibook_toggle(const struct omnibook_operation *io_op, int toggle)
 {
 	int retval;
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	ktime_t start = ktime_get();
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 	retval = __omnibook_toggle(io_op, toggle);
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
+	trace_omnibook_locked(io_op, "toggle", io_op->write_addr, toggle, retval, start);
 	return retval;
 }
 
 /*
  * Timeout in ms for sending to controller
+ * This is the worst case, the effective timeout is learned, see timeout.c
  */
 
 #define OMNIBOOK_TIMEOUT                250
 
+/*
+ * Learned timeouts are OMNIBOOK_TIMEOUT_MULT times the observed 99th
+ * percentile, never less than OMNIBOOK_TIMEOUT_FLOOR us.
+ */
+
+#define OMNIBOOK_TIMEOUT_MULT		4
+#define OMNIBOOK_TIMEOUT_FLOOR		5000
+
 
 /*
  *	Embedded controller adresses
@@ -0,0 +1,173 @@
+/*
+ * histogram.c -- backend latency histograms
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/bitops.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <asm/uaccess.h>
+#include "hardware.h"
+
+/*
+ * Each backend keeps one log2 histogram per operation type, filled by the
+ * byte/block helpers and by the SMI, ACPI and CDI low level calls.
+ * Adding a sample is a few increments under a spinlock, cheap enough to
+ * leave on, unlike tracing.
+ *
+ * /sys/kernel/debug/omnibook/<backend>/latency shows them, writing
+ * anything to it resets them.
+ */
+
+const char *omnibook_hist_name[OMNIBOOK_HIST_TYPES] = {
+	[OMNIBOOK_HIST_READ] = "read",
+	[OMNIBOOK_HIST_WRITE] = "write",
+	[OMNIBOOK_HIST_BLOCK_READ] = "block read",
+	[OMNIBOOK_HIST_BLOCK_WRITE] = "block write",
+	[OMNIBOOK_HIST_SMI] = "smi",
+	[OMNIBOOK_HIST_ACPI] = "acpi",
+	[OMNIBOOK_HIST_CDI] = "cdi",
+};
+
+/*
+ * Record an operation of type type which started at start
+ */
+void omnibook_histogram_add(struct omnibook_backend *backend, enum omnibook_hist_type type,
+			    ktime_t start)
+{
+	struct omnibook_hist *hist = &backend->histogram.type[type];
+	unsigned long flags;
+	s64 delta;
+	u32 ns;
+
+	delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (delta < 0)
+		delta = 0;
+	ns = min_t(s64, delta, ~0U);
+
+	spin_lock_irqsave(&backend->histogram.lock, flags);
+	if (!hist->count || ns < hist->min)
+		hist->min = ns;
+	if (ns > hist->max)
+		hist->max = ns;
+	hist->count++;
+	hist->bucket[fls(ns)]++;
+	spin_unlock_irqrestore(&backend->histogram.lock, flags);
+
+	if (unlikely(omnibook_stalling))
+		__omnibook_stall_op(backend, type);
+}
+
+void omnibook_histogram_init(struct omnibook_backend *backend)
+{
+	memset(&backend->histogram, 0, sizeof(struct omnibook_histogram));
+	spin_lock_init(&backend->histogram.lock);
+}
+
+/*
+ * Upper bound in ns of the bucket holding the given percentile
+ */
+static u32 omnibook_hist_percentile(const struct omnibook_hist *hist, int percent)
+{
+	unsigned long target, seen = 0;
+	int i;
+
+	target = (hist->count * percent + 99) / 100;
+	for (i = 0; i < OMNIBOOK_HIST_BUCKETS; i++) {
+		seen += hist->bucket[i];
+		if (seen >= target)
+			break;
+	}
+	if (i >= 32)
+		return hist->max;
+	return min_t(u32, (1U << i) - 1, hist->max);
+}
+
+static int omnibook_histogram_show(struct seq_file *m, void *v)
+{
+	struct omnibook_backend *backend = m->private;
+	struct omnibook_hist *hist;
+	unsigned long flags;
+	int i, j, last;
+
+	/* The whole set is small enough to be copied */
+	hist = kmalloc(sizeof(backend->histogram.type), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+	spin_lock_irqsave(&backend->histogram.lock, flags);
+	memcpy(hist, backend->histogram.type, sizeof(backend->histogram.type));
+	spin_unlock_irqrestore(&backend->histogram.lock, flags);
+
+	for (i = 0; i < OMNIBOOK_HIST_TYPES; i++) {
+		if (!hist[i].count)
+			continue;
+		seq_printf(m, "%s: count %lu min %u ns max %u ns p50 <= %u ns p99 <= %u ns\n",
+			   omnibook_hist_name[i], hist[i].count, hist[i].min, hist[i].max,
+			   omnibook_hist_percentile(&hist[i], 50),
+			   omnibook_hist_percentile(&hist[i], 99));
+		for (last = OMNIBOOK_HIST_BUCKETS - 1; last > 0 && !hist[i].bucket[last]; last--)
+			;
+		for (j = fls(hist[i].min); j <= last; j++)
+			seq_printf(m, "\t%10u - %10u ns: %u\n", j ? 1U << (j - 1) : 0,
+				   j < 32 ? (1U << j) - 1 : ~0U, hist[i].bucket[j]);
+	}
+
+	kfree(hist);
+	return 0;
+}
+
+static int omnibook_histogram_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omnibook_histogram_show, inode->i_private);
+}
+
+/*
+ * Any write resets the histograms
+ */
+static ssize_t omnibook_histogram_write(struct file *file, const char __user *buf,
+					size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct omnibook_backend *backend = m->private;
+	unsigned long flags;
+
+	spin_lock_irqsave(&backend->histogram.lock, flags);
+	memset(backend->histogram.type, 0, sizeof(backend->histogram.type));
+	spin_unlock_irqrestore(&backend->histogram.lock, flags);
+
+	return count;
+}
+
+static const struct file_operations omnibook_histogram_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_histogram_open,
+	.read = seq_read,
+	.write = omnibook_histogram_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Expose the histograms of a backend once it is in use
+ * Called from probe, a backend can be matched by several features.
+ */
+void omnibook_histogram_debugfs(struct omnibook_backend *backend)
+{
+	if (backend->histogram.dentry)
+		return;
+	backend->histogram.dentry = omnibook_debugfs_file(backend, "latency", S_IRUGO | S_IWUSR,
+							  &omnibook_histogram_fops);
+}
+
+/* End of file */
@@ -29,7 +29,7 @@ static int hotkeys_set_save(struct omnibook_operation *io_op, unsigned int state
 {
 	int retval;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
 	retval = __backend_hotkeys_set(io_op, state);
@@ -40,7 +40,7 @@ static int hotkeys_set_save(struct omnibook_operation *io_op, unsigned int state
 	io_op->backend->hotkeys_state = state & io_op->backend->hotkeys_write_cap;
 
 	out:
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
@@ -53,7 +53,7 @@ static int hotkeys_get_save(struct omnibook_operation *io_op, unsigned int *stat
 	unsigned int read_state = 0;
 	int retval = 0;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
 	if (io_op->backend->hotkeys_get)
@@ -66,7 +66,7 @@ static int hotkeys_get_save(struct omnibook_operation *io_op, unsigned int *stat
 		 (io_op->backend->hotkeys_state & ~io_op->backend->hotkeys_read_cap);
 
 	out:
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return 0;
 }
 
@@ -80,9 +80,9 @@ static int hotkeys_get_save(struct omnibook_operation *io_op, unsigned int *stat
 static int omnibook_hotkeys_resume(struct omnibook_operation *io_op)
 {
 	int retval;
-	mutex_lock(&io_op->backend->mutex);
+	omnibook_op_lock(io_op);
 	retval = __backend_hotkeys_set(io_op, io_op->backend->hotkeys_state);
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
@@ -106,9 +106,8 @@ static const char pretty_name[][27] = {
 	"Fn + F5 hotkey is",
 };
 
-static int omnibook_hotkeys_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_hotkeys_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	int retval;
 	unsigned int read_state = 0; /* buggy gcc 4.1 warning fix */
 	unsigned int shift, mask;
@@ -122,12 +121,11 @@ static int omnibook_hotkeys_read(char *buffer, struct omnibook_operation *io_op)
 		mask = 1 << shift;
 		/* we assume write capability or read capability imply support */
 		if ((io_op->backend->hotkeys_read_cap | io_op->backend->hotkeys_write_cap) & mask)
-			len +=
-			    sprintf(buffer + len, "%s %s.\n", pretty_name[shift],
-				    (read_state & mask) ? "enabled" : "disabled");
+			seq_printf(m, "%s %s.\n", pretty_name[shift],
+				   (read_state & mask) ? "enabled" : "disabled");
 	}
 
-	return len;
+	return 0;
 }
 
 static int omnibook_hotkeys_write(char *buffer, struct omnibook_operation *io_op)
@@ -20,34 +20,28 @@
 #include <linux/dmi.h>
 #include <linux/version.h>
 
-static int omnibook_version_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_version_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
+	seq_printf(m, "%s\n", OMNIBOOK_MODULE_VERSION);
 
-	len += sprintf(buffer + len, "%s\n", OMNIBOOK_MODULE_VERSION);
-
-	return len;
+	return 0;
 }
 
-static int omnibook_dmi_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_dmi_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
-
-	len += sprintf(buffer + len, "BIOS Vendor:   %s\n", dmi_get_system_info(DMI_BIOS_VENDOR));
-	len += sprintf(buffer + len, "BIOS Version:  %s\n", dmi_get_system_info(DMI_BIOS_VERSION));
-	len += sprintf(buffer + len, "BIOS Release:  %s\n", dmi_get_system_info(DMI_BIOS_DATE));
-	len += sprintf(buffer + len, "System Vendor: %s\n", dmi_get_system_info(DMI_SYS_VENDOR));
-	len += sprintf(buffer + len, "Product Name:  %s\n", dmi_get_system_info(DMI_PRODUCT_NAME));
-	len +=
-	    sprintf(buffer + len, "Version:       %s\n", dmi_get_system_info(DMI_PRODUCT_VERSION));
+	seq_printf(m, "BIOS Vendor:   %s\n", dmi_get_system_info(DMI_BIOS_VENDOR));
+	seq_printf(m, "BIOS Version:  %s\n", dmi_get_system_info(DMI_BIOS_VERSION));
+	seq_printf(m, "BIOS Release:  %s\n", dmi_get_system_info(DMI_BIOS_DATE));
+	seq_printf(m, "System Vendor: %s\n", dmi_get_system_info(DMI_SYS_VENDOR));
+	seq_printf(m, "Product Name:  %s\n", dmi_get_system_info(DMI_PRODUCT_NAME));
+	seq_printf(m, "Version:       %s\n", dmi_get_system_info(DMI_PRODUCT_VERSION));
 #if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,15))
-	len +=
-	    sprintf(buffer + len, "Serial Number: %s\n", dmi_get_system_info(DMI_PRODUCT_SERIAL));
+	seq_printf(m, "Serial Number: %s\n", dmi_get_system_info(DMI_PRODUCT_SERIAL));
 #endif
-	len += sprintf(buffer + len, "Board Vendor:  %s\n", dmi_get_system_info(DMI_BOARD_VENDOR));
-	len += sprintf(buffer + len, "Board Name:    %s\n", dmi_get_system_info(DMI_BOARD_VERSION));
+	seq_printf(m, "Board Vendor:  %s\n", dmi_get_system_info(DMI_BOARD_VENDOR));
+	seq_printf(m, "Board Name:    %s\n", dmi_get_system_info(DMI_BOARD_VERSION));
 
-	return len;
+	return 0;
 }
 
 static struct omnibook_feature __declared_feature version_driver = {
@@ -128,6 +128,18 @@ static struct platform_device omnibook_device = {
 /* Linked list of all enabled features */
 static struct omnibook_feature *omnibook_available_feature;
 
+/* All backends, NULL terminated */
+struct omnibook_backend *omnibook_backends[] = {
+	&kbc_backend,
+	&pio_backend,
+	&ec_backend,
+	&acpi_backend,
+	&nbsmi_backend,
+	&compal_backend,
+	&sim_backend,
+	NULL,
+};
+
 /* Delimiters of the .features section wich holds all the omnibook_feature structs */
 extern struct omnibook_feature _start_features_driver[];
 extern struct omnibook_feature _end_features_driver[];
@@ -146,68 +158,71 @@ static int __init dmi_matched(const struct dmi_system_id *dmi)
 	return 1;		/* return non zero means we stop the parsing selecting this entry */
 }
 
-/* 
- * Callback function for procfs file reading: the name of the file read was stored in *data 
+/*
+ * procfs files are seq_files: the feature read function fills the buffer
+ * on the first read of an open file, or again if the buffer was too
+ * small; seq_read serves it at any offset, lseek to 0 refills it.
+ * The feature was stored in the data of the proc entry.
  */
-static int procfile_read_dispatch(char *page, char **start, off_t off, int count, int *eof,
-				  void *data)
+static int procfile_show(struct seq_file *m, void *v)
 {
-	struct omnibook_feature *feature = (struct omnibook_feature *)data;
-	int len = 0;
+	struct omnibook_feature *feature = m->private;
 
-	if (!feature || !feature->read)
-		return -EINVAL;
-
-	if(off)
-		goto out;
+	return feature->read(m, feature->io_op);
+}
 
-	len = feature->read(page, feature->io_op);
-	if (len < 0)
-		return len;
+static int procfile_open(struct inode *inode, struct file *file)
+{
+	struct omnibook_feature *feature = PDE(inode)->data;
 
-	out:
-	*eof = 1;
-	return len;
+	if (!feature || !feature->read)
+		return -EINVAL;
+	return single_open(file, procfile_show, feature);
 }
 
-/* 
- * Callback function for procfs file writing: the name of the file written was stored in *data 
+/*
+ * Longest accepted write, the fan policy being the longest command.
+ * Parsed from the stack.
  */
-static int procfile_write_dispatch(struct file *file, const char __user * userbuf,
-				   unsigned long count, void *data)
+#define OMNIBOOK_WRITE_MAX	64
+
+static ssize_t procfile_write(struct file *file, const char __user *userbuf, size_t count,
+			      loff_t *ppos)
 {
-	struct omnibook_feature *feature = (struct omnibook_feature *)data;
-	char *kernbuf;
+	struct seq_file *m = file->private_data;
+	struct omnibook_feature *feature = m->private;
+	char kernbuf[OMNIBOOK_WRITE_MAX];
 	int retval;
 
-	if (!feature || !feature->write)
+	if (!feature->write)
+		return -EINVAL;
+	if (count > sizeof(kernbuf) - 1)
 		return -EINVAL;
 
-	kernbuf = kmalloc(count + 1, GFP_KERNEL);
-	if (!kernbuf)
-		return -ENOMEM;
-
-	if (copy_from_user(kernbuf, userbuf, count)) {
-		kfree(kernbuf);
+	if (copy_from_user(kernbuf, userbuf, count))
 		return -EFAULT;
-	}
 
 	/* Make sure the string is \0 terminated */
 	kernbuf[count] = '\0';
 
 	retval = feature->write(kernbuf, feature->io_op);
-	if (retval == 0)
-		retval = count;
-
-	kfree(kernbuf);
-
-	return retval;
+	return retval ? retval : count;
 }
 
+static const struct file_operations omnibook_proc_fops = {
+	.owner = THIS_MODULE,
+	.open = procfile_open,
+	.read = seq_read,
+	.write = procfile_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 /*
  * Match an ectype and return pointer to corresponding omnibook_operation.
  * Also make corresponding backend initialisation if necessary, and skip
  * to the next entry if it fails.
+ * With ectype=sim:<n> every entry is routed to the simulated backend.
  */
 static struct omnibook_operation *omnibook_backend_match(struct omnibook_tbl *tbl)
 {
@@ -216,6 +231,8 @@ static struct omnibook_operation *omnibook_backend_match(struct omnibook_tbl *tb
 
 	for (i = 0; tbl[i].ectypes; i++) {
 		if (omnibook_ectype & tbl[i].ectypes) {
+			if (omnibook_simulated)
+				tbl[i].io_op.backend = &sim_backend;
                     dprintk("Attempting backend %s init.\n",
                             tbl[i].io_op.backend->name);
 			if (tbl[i].io_op.backend->init && tbl[i].io_op.backend->init(&tbl[i].io_op)) {
@@ -223,6 +240,10 @@ static struct omnibook_operation *omnibook_backend_match(struct omnibook_tbl *tb
 					tbl[i].io_op.backend->name);
 				continue;
 			}
+			omnibook_latency_debugfs(tbl[i].io_op.backend);
+			omnibook_breaker_debugfs(tbl[i].io_op.backend);
+			omnibook_histogram_debugfs(tbl[i].io_op.backend);
+			omnibook_lockstat_debugfs(tbl[i].io_op.backend);
 			matched = &tbl[i].io_op;
 			dprintk("Returning table entry nr %i.\n", i);
 			break;
@@ -260,6 +281,7 @@ static int __init omnibook_init(struct omnibook_feature *feature)
 		if (!feature->io_op)
 			return -ENOMEM;
 		memcpy(feature->io_op, op, sizeof(struct omnibook_operation));
+		feature->io_op->feature = feature->name;
 	} else
 		dprintk("%s feature has no backend table, io_op not initialized.\n", feature->name);
 
@@ -281,7 +303,16 @@ static int __init omnibook_init(struct omnibook_feature *feature)
 				pmode |= S_IWUGO;
 		}
 
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,26))
+		proc_entry = proc_create_data(feature->name, pmode, omnibook_proc_root,
+					      &omnibook_proc_fops, feature);
+#else
 		proc_entry = create_proc_entry(feature->name, pmode, omnibook_proc_root);
+		if (proc_entry) {
+			proc_entry->data = feature;
+			proc_entry->proc_fops = &omnibook_proc_fops;
+		}
+#endif
 
 		if (!proc_entry) {
 			printk(O_ERR "Unable to create proc entry %s\n", feature->name);
@@ -290,10 +321,6 @@ static int __init omnibook_init(struct omnibook_feature *feature)
 			retval = -ENOENT;
 			goto err;
 		}
-		proc_entry->data = feature;
-		proc_entry->read_proc = &procfile_read_dispatch;
-		if (feature->write)
-			proc_entry->write_proc = &procfile_write_dispatch;
 		#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,30)
 			proc_entry->owner = THIS_MODULE;
 		#endif
@@ -320,10 +347,21 @@ static int __init omnibook_probe(struct platform_device *dev)
 	mutex_init(&kbc_backend.mutex);
 	mutex_init(&pio_backend.mutex);
 	mutex_init(&ec_backend.mutex);
+	mutex_init(&sim_backend.mutex);
+
+	for (i = 0; omnibook_backends[i]; i++) {
+		omnibook_latency_init(omnibook_backends[i]);
+		omnibook_histogram_init(omnibook_backends[i]);
+	}
+
+	if (omnibook_queue_init())
+		return -ENOMEM;
 
 	omnibook_available_feature = kzalloc(sizeof(struct omnibook_feature), GFP_KERNEL);
-	if (!omnibook_available_feature)
+	if (!omnibook_available_feature) {
+		omnibook_queue_exit();
 		return -ENOMEM;
+	}
 	INIT_LIST_HEAD(&omnibook_available_feature->list);
 
         dprintk("Feature range %p - %p\n", _start_features_driver, _end_features_driver);
@@ -348,6 +386,10 @@ static int __init omnibook_probe(struct platform_device *dev)
 	}
 	printk(".\n");
 
+	omnibook_telemetry_init();
+	omnibook_notify_init(&dev->dev);
+	omnibook_event_init();
+
 	return 0;
 }
 
@@ -358,11 +400,21 @@ static int __exit omnibook_remove(struct platform_device *dev)
 {
 	struct omnibook_feature *feature, *temp;
 
-	list_for_each_entry_safe(feature, temp, &omnibook_available_feature->list, list) {
-		list_del(&feature->list);
-		/* Feature specific cleanup */
+	omnibook_event_exit();
+	omnibook_notify_exit();
+	omnibook_telemetry_exit();
+
+	/* Feature specific cleanup first: it unregisters the request producers */
+	list_for_each_entry(feature, &omnibook_available_feature->list, list) {
 		if (feature->exit)
 			feature->exit(feature->io_op);
+	}
+
+	/* Pending requests may refer to io_ops freed below */
+	omnibook_queue_exit();
+
+	list_for_each_entry_safe(feature, temp, &omnibook_available_feature->list, list) {
+		list_del(&feature->list);
 		/* Generic backend cleanup */
 		if (feature->io_op && feature->io_op->backend->exit)
 			feature->io_op->backend->exit(feature->io_op);
@@ -383,6 +435,9 @@ static int omnibook_suspend(struct platform_device *dev, pm_message_t state)
 	int retval;
 	struct omnibook_feature *feature;
 
+	omnibook_notify_suspend();
+	omnibook_telemetry_suspend();
+
 	list_for_each_entry(feature, &omnibook_available_feature->list, list) {
 		if (feature->suspend) {
 			retval = feature->suspend(feature->io_op);
@@ -398,9 +453,15 @@ static int omnibook_suspend(struct platform_device *dev, pm_message_t state)
  */
 static int omnibook_resume(struct platform_device *dev)
 {
-	int retval;
+	int i, retval;
 	struct omnibook_feature *feature;
 
+	omnibook_ec_shadow_invalidate();
+	for (i = 0; omnibook_backends[i]; i++) {
+		omnibook_latency_reset(omnibook_backends[i]);
+		omnibook_breaker_reset(omnibook_backends[i]);
+	}
+
 	list_for_each_entry(feature, &omnibook_available_feature->list, list) {
 		if (feature->resume) {
 			retval = feature->resume(feature->io_op);
@@ -408,6 +469,9 @@ static int omnibook_resume(struct platform_device *dev)
 				printk(O_ERR "Unable to resume the %s feature (error %i).\n", feature->name, retval);
 		}
 	}
+
+	omnibook_telemetry_resume();
+	omnibook_notify_resume();
 	return 0;
 }
 
@@ -428,6 +492,7 @@ struct omnibook_feature *omnibook_find_feature(char *name)
 /*
  * Maintain compatibility with the old ectype numbers:
  * ex: The user set/get ectype=12 for TSM70=2^(12-1)
+ * ectype=sim:12 selects the simulated backend for all features of a TSM70
  */
 static int __init set_ectype_param(const char *val, struct kernel_param *kp)
 {
@@ -437,6 +502,11 @@ static int __init set_ectype_param(const char *val, struct kernel_param *kp)
 	if (!val)
 		return -EINVAL;
 
+	if (!strncmp(val, "sim:", 4)) {
+		omnibook_simulated = 1;
+		val += 4;
+	}
+
 	value = simple_strtol(val, &endp, 10);
 	if (endp == val)	/* No match */
 		return -EINVAL;
@@ -446,7 +516,7 @@ static int __init set_ectype_param(const char *val, struct kernel_param *kp)
 
 static int get_ectype_param(char *buffer, struct kernel_param *kp)
 {
-	return sprintf(buffer, "%i", ffs(omnibook_ectype));
+	return sprintf(buffer, "%s%i", omnibook_simulated ? "sim:" : "", ffs(omnibook_ectype));
 }
 
 static int __init omnibook_module_init(void)
@@ -455,7 +525,9 @@ static int __init omnibook_module_init(void)
 
 	printk(O_INFO "Driver version %s.\n", OMNIBOOK_MODULE_VERSION);
 
-	if (omnibook_ectype != NONE)
+	if (omnibook_simulated)
+		printk(O_WARN "Simulated hardware with EC type %i.\n", ffs(omnibook_ectype));
+	else if (omnibook_ectype != NONE)
 		printk(O_WARN "Forced load with EC type %i.\n", ffs(omnibook_ectype));
 	else if (dmi_check_system(omnibook_ids))
 		printk(O_INFO "%s detected.\n", laptop_model);
@@ -468,6 +540,10 @@ static int __init omnibook_module_init(void)
 		return -ENOENT;
 	}
 
+	omnibook_flight_init();
+	omnibook_record_init();
+	omnibook_debugfs_init();
+
 /*
  * The platform_driver interface was added in linux 2.6.15
  */
@@ -476,34 +552,40 @@ static int __init omnibook_module_init(void)
 
 	retval = platform_driver_register(&omnibook_driver);
 	if (retval < 0)
-		return retval;
+		goto err;
 
 	omnibook_device = platform_device_alloc(OMNIBOOK_MODULE_NAME, -1);
 	if (!omnibook_device) {
 		platform_driver_unregister(&omnibook_driver);
-		return -ENOMEM;
+		retval = -ENOMEM;
+		goto err;
 	}
 
 	retval = platform_device_add(omnibook_device);
 	if (retval) {
 		platform_device_put(omnibook_device);
 		platform_driver_unregister(&omnibook_driver);
-		return retval;
+		goto err;
 	}
 #else				/* 2.6.15 */
 
 	retval = driver_register(&omnibook_driver);
 	if (retval < 0)
-		return retval;
+		goto err;
 
 	retval = platform_device_register(&omnibook_device);
 
 	if (retval) {
 		driver_unregister(&omnibook_driver);
-		return retval;
+		goto err;
 	}
 #endif
 	return 0;
+      err:
+	omnibook_debugfs_exit();
+	omnibook_record_exit();
+	omnibook_flight_exit();
+	return retval;
 }
 
 static void __exit omnibook_module_cleanup(void)
@@ -521,6 +603,10 @@ static void __exit omnibook_module_cleanup(void)
 	driver_unregister(&omnibook_driver);
 #endif
 
+	omnibook_debugfs_exit();
+	omnibook_record_exit();
+	omnibook_flight_exit();
+
 	if (omnibook_proc_root)
 		remove_proc_entry("omnibook", NULL);
 	printk(O_INFO "Module is unloaded.\n");
@@ -536,7 +622,7 @@ MODULE_DESCRIPTION
 MODULE_LICENSE("GPL");
 module_param_call(ectype, set_ectype_param, get_ectype_param, NULL, S_IRUGO);
 module_param_named(userset, omnibook_userset, int, S_IRUGO);
-MODULE_PARM_DESC(ectype, "Type of embedded controller firmware");
+MODULE_PARM_DESC(ectype, "Type of embedded controller firmware, sim:<type> to simulate it");
 MODULE_PARM_DESC(userset, "Use 0 to disable, 1 to enable users to set parameters");
 
 /* End of file */
@@ -50,29 +50,42 @@ extern int omnibook_key_polling_disable(void);
 
 static DEFINE_SPINLOCK(omnibook_kbc_lock);
 
+static inline int omnibook_kbc_ready(u8 event)
+{
+	if (event == OMNIBOOK_KBC_STAT_OBF)
+		return inb(OMNIBOOK_KBC_SC) & event;
+	return !(inb(OMNIBOOK_KBC_SC) & event);
+}
+
 /*
- * Wait for keyboard buffer
+ * Wait for keyboard buffer, polling every ms until the learned timeout
+ * elapsed, or OMNIBOOK_TIMEOUT ms if the controller answered its last
+ * wait, see timeout.c
  */
 
 static int omnibook_kbc_wait(u8 event)
 {
-	int timeout = OMNIBOOK_TIMEOUT;
-
-	switch (event) {
-	case OMNIBOOK_KBC_STAT_OBF:
-		while (!(inb(OMNIBOOK_KBC_SC) & event) && timeout--)
-			mdelay(1);
-		break;
-	case OMNIBOOK_KBC_STAT_IBF:
-		while ((inb(OMNIBOOK_KBC_SC) & event) && timeout--)
-			mdelay(1);
-		break;
-	default:
+	unsigned int timeout, ceiling = OMNIBOOK_TIMEOUT * 1000;
+	ktime_t start;
+
+	if (event != OMNIBOOK_KBC_STAT_OBF && event != OMNIBOOK_KBC_STAT_IBF)
 		return -EINVAL;
+
+	start = ktime_get();
+	timeout = omnibook_timeout(&kbc_backend, ceiling);
+	while (!omnibook_kbc_ready(event)) {
+		if (omnibook_timed_out(start, timeout)) {
+			if (omnibook_kbc_ready(event))
+				break;
+			timeout = omnibook_latency_expired(&kbc_backend, timeout, ceiling);
+			if (!timeout)
+				return -ETIME;
+			continue;
+		}
+		mdelay(1);
 	}
-	if (timeout > 0)
-		return 0;
-	return -ETIME;
+	omnibook_latency_add(&kbc_backend, start);
+	return 0;
 }
 
 /*
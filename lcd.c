@@ -82,18 +82,15 @@ static int omnibook_set_backlight(struct backlight_device *bd)
 }
 #endif /* CONFIG_OMNIBOOK_BACKLIGHT */
 
-static int omnibook_brightness_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_brightness_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	u8 brgt;
 
 	backend_byte_read(io_op, &brgt);
 
-	len +=
-	    sprintf(buffer + len, "LCD brightness: %2d (max value: %d)\n", brgt,
-		    omnibook_max_brightness);
+	seq_printf(m, "LCD brightness: %2d (max value: %d)\n", brgt, omnibook_max_brightness);
 
-	return len;
+	return 0;
 }
 
 static int omnibook_brightness_write(char *buffer, struct omnibook_operation *io_op)
@@ -199,11 +196,25 @@ static struct omnibook_tbl lcd_table[] __initdata = {
 	{0,}
 };
 
+static int omnibook_brightness_telemetry(struct omnibook_telemetry *t,
+					 struct omnibook_operation *io_op)
+{
+	u8 brgt;
+
+	if (__backend_byte_read(io_op, &brgt))
+		return -EIO;
+	t->lcd = brgt;
+	t->lcd_max = omnibook_max_brightness;
+	t->valid |= OMNIBOOK_TM_LCD;
+	return 0;
+}
+
 static struct omnibook_feature __declared_feature lcd_driver = {
 	.name = "lcd",
 	.enabled = 1,
 	.read = omnibook_brightness_read,
 	.write = omnibook_brightness_write,
+	.telemetry = omnibook_brightness_telemetry,
 	.init = omnibook_brightness_init,
 	.exit = omnibook_brightness_cleanup,
 	.ectypes = XE3GF | XE3GC | AMILOD | TSP10 | TSM70 | TSM30X | TSM40 | TSA105 | TSX205,
@@ -31,29 +31,37 @@ int __omnibook_apply_write_mask(const struct omnibook_operation *io_op, int togg
 	int retval = 0;
 	int mask;
 	u8 data;
+	ktime_t start = ktime_get();
 
 	if(!(io_op->backend->byte_read  && io_op->read_addr))
 		return __omnibook_toggle(io_op,toggle);
 
 	if ((retval = __backend_byte_read(io_op, &data)))
-		return retval;
+		goto out;
 
 	if (toggle == 1)
 		mask = io_op->on_mask;
 	else if (toggle == 0)
 		mask = io_op->off_mask;
-	else
-		return -EINVAL;
+	else {
+		retval = -EINVAL;
+		goto out;
+	}
 
 	if (mask > 0)
 		data |= (u8) mask;
 	else if (mask < 0)
 		data &= ~((u8) (-mask));
-	else
-		return -EINVAL;
+	else {
+		retval = -EINVAL;
+		goto out;
+	}
 
 	retval = __backend_byte_write(io_op, data);
 
+      out:
+	trace_omnibook_apply_write_mask(io_op, "apply_write_mask", io_op->write_addr,
+					toggle, retval, start);
 	return retval;
 }
 
@@ -64,12 +72,54 @@ int __omnibook_toggle(const struct omnibook_operation *io_op, int toggle)
 {
 	int retval;
 	u8 data;
+	ktime_t start = ktime_get();
 
 	data = toggle ? io_op->on_mask : io_op->off_mask;
 	retval = __backend_byte_write(io_op, data);
+	trace_omnibook_toggle(io_op, "toggle", io_op->write_addr, toggle, retval, start);
 	return retval;
 }
 
+/*
+ * Block access fallbacks for backends without native support:
+ * loop on byte_read/byte_write using a private copy of the operation,
+ * io_op is shared by all users of the feature.
+ */
+int __omnibook_block_read_bytes(const struct omnibook_operation *io_op, unsigned long addr,
+				u8 *buf, int len)
+{
+	struct omnibook_operation op;
+	int retval;
+	int i;
+
+	op = *io_op;
+	op.read_mask = 0;
+	for (i = 0; i < len; i++) {
+		op.read_addr = addr + i;
+		retval = io_op->backend->byte_read(&op, &buf[i]);
+		if (retval)
+			return retval;
+	}
+	return 0;
+}
+
+int __omnibook_block_write_bytes(const struct omnibook_operation *io_op, unsigned long addr,
+				 const u8 *buf, int len)
+{
+	struct omnibook_operation op;
+	int retval;
+	int i;
+
+	op = *io_op;
+	for (i = 0; i < len; i++) {
+		op.write_addr = addr + i;
+		retval = io_op->backend->byte_write(&op, buf[i]);
+		if (retval)
+			return retval;
+	}
+	return 0;
+}
+
 void omnibook_report_key( struct input_dev *dev, unsigned int keycode)
 {
 	input_report_key(dev, keycode, 1);
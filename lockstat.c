@@ -0,0 +1,161 @@
+/*
+ * lockstat.c -- backend mutex contention and hold time statistics
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/string.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <asm/div64.h>
+#include "hardware.h"
+
+/*
+ * The backend mutex is taken through omnibook_backend_lock() and friends
+ * (hardware.h) which tell who takes it: the feature name of the io_op,
+ * or a fixed name for backend internal users. Time spent waiting for the
+ * mutex and time spent holding it are accounted to that owner.
+ *
+ * Statistics are only updated by the mutex holder, so the mutex itself
+ * protects them. Owners beyond OMNIBOOK_LOCKSTAT_OWNERS share the last
+ * slot.
+ *
+ * /sys/kernel/debug/omnibook/<backend>/lock shows them.
+ */
+
+static struct omnibook_lockstat_owner *omnibook_lockstat_find(struct omnibook_lockstat *ls,
+							       const char *name)
+{
+	int i;
+
+	for (i = 0; i < OMNIBOOK_LOCKSTAT_OWNERS - 1; i++) {
+		if (!ls->owner[i].name) {
+			ls->owner[i].name = name;
+			return &ls->owner[i];
+		}
+		if (ls->owner[i].name == name || !strcmp(ls->owner[i].name, name))
+			return &ls->owner[i];
+	}
+	ls->owner[i].name = "(other)";
+	return &ls->owner[i];
+}
+
+/*
+ * Called with the mutex just acquired, start is when waiting began if the
+ * mutex was contended, NULL otherwise.
+ */
+void omnibook_lockstat_acquired(struct omnibook_backend *backend, const char *name,
+				const ktime_t *start)
+{
+	struct omnibook_lockstat *ls = &backend->lockstat;
+	struct omnibook_lockstat_owner *owner;
+	ktime_t now = ktime_get();
+	u64 wait;
+
+	owner = omnibook_lockstat_find(ls, name ? name : "-");
+	owner->acquired++;
+	if (start) {
+		wait = ktime_to_ns(ktime_sub(now, *start));
+		owner->contended++;
+		owner->wait_total += wait;
+		if (wait > owner->wait_max)
+			owner->wait_max = wait;
+	}
+	ls->holder = owner;
+	ls->since = now;
+}
+
+/*
+ * Called right before the mutex is released
+ */
+void omnibook_lockstat_release(struct omnibook_backend *backend)
+{
+	struct omnibook_lockstat *ls = &backend->lockstat;
+	u64 hold;
+
+	if (unlikely(!ls->holder))
+		return;
+	hold = ktime_to_ns(ktime_sub(ktime_get(), ls->since));
+	ls->holder->hold_total += hold;
+	if (hold > ls->holder->hold_max)
+		ls->holder->hold_max = hold;
+	ls->holder = NULL;
+}
+
+static unsigned long omnibook_lockstat_us(u64 ns)
+{
+	do_div(ns, NSEC_PER_USEC);
+	return ns;
+}
+
+static unsigned long omnibook_lockstat_avg_us(u64 ns, unsigned long count)
+{
+	if (!count)
+		return 0;
+	do_div(ns, count);
+	return omnibook_lockstat_us(ns);
+}
+
+static int omnibook_lockstat_show(struct seq_file *m, void *v)
+{
+	struct omnibook_backend *backend = m->private;
+	struct omnibook_lockstat_owner *o;
+	int i;
+
+	/* Taken directly, we do not want to account ourselves */
+	if (mutex_lock_interruptible(&backend->mutex))
+		return -ERESTARTSYS;
+
+	seq_printf(m, "%-16s %10s %10s %12s %10s %10s %12s %10s\n", "owner", "acquired",
+		   "contended", "wait total", "wait max", "wait avg", "hold total", "hold max");
+	for (i = 0; i < OMNIBOOK_LOCKSTAT_OWNERS; i++) {
+		o = &backend->lockstat.owner[i];
+		if (!o->name)
+			continue;
+		seq_printf(m, "%-16s %10lu %10lu %9lu us %7lu us %7lu us %9lu us %7lu us\n",
+			   o->name, o->acquired, o->contended,
+			   omnibook_lockstat_us(o->wait_total), omnibook_lockstat_us(o->wait_max),
+			   omnibook_lockstat_avg_us(o->wait_total, o->contended),
+			   omnibook_lockstat_us(o->hold_total), omnibook_lockstat_us(o->hold_max));
+	}
+
+	mutex_unlock(&backend->mutex);
+	return 0;
+}
+
+static int omnibook_lockstat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omnibook_lockstat_show, inode->i_private);
+}
+
+static const struct file_operations omnibook_lockstat_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_lockstat_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Expose the lock statistics of a backend once it is in use
+ * Called from probe, a backend can be matched by several features.
+ */
+void omnibook_lockstat_debugfs(struct omnibook_backend *backend)
+{
+	if (backend->lockstat.dentry)
+		return;
+	backend->lockstat.dentry = omnibook_debugfs_file(backend, "lock", S_IRUGO,
+							 &omnibook_lockstat_fops);
+}
+
+/* End of file */
@@ -22,7 +22,7 @@ static int omnibook_muteled_set(struct omnibook_operation *io_op, int status)
 {
 	int retval = 0;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
 	if((retval = __omnibook_toggle(io_op, !!status))) {
@@ -33,25 +33,23 @@ static int omnibook_muteled_set(struct omnibook_operation *io_op, int status)
 	io_op->backend->muteled_state = !!status;
 
 	out:
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
 /*
  * Hardware query is unsupported, reading is unreliable.
  */
-static int omnibook_muteled_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_muteled_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
-	len +=
-	    sprintf(buffer + len, "Last mute LED action was an %s command.\n",
-		    io_op->backend->touchpad_state ? "on" : "off");
+	seq_printf(m, "Last mute LED action was an %s command.\n",
+		   io_op->backend->touchpad_state ? "on" : "off");
 
-	mutex_unlock(&io_op->backend->mutex);
-	return len;
+	omnibook_op_unlock(io_op);
+	return 0;
 }
 
 static int omnibook_muteled_write(char *buffer, struct omnibook_operation *io_op)
@@ -75,9 +73,9 @@ static int omnibook_muteled_write(char *buffer, struct omnibook_operation *io_op
 static int omnibook_muteled_resume(struct omnibook_operation *io_op)
 {	
 	int retval;
-	mutex_lock(&io_op->backend->mutex);
+	omnibook_op_lock(io_op);
 	retval = __omnibook_toggle(io_op, !!io_op->backend->touchpad_state);
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
@@ -108,6 +108,11 @@ static inline u32 ati_do_smi_call(u16 function)
  * retval = -EIO; [too bad]
  * out:
  */
+#ifdef OMNIBOOK_SIM
+	/* User-space simulation, see sim/devices.c */
+	if (omnibook_sim_smi(function, ATI_SMI_PORT) && inw(ATI_SMI_PORT + 1))
+		retval = -EIO;
+#else
 	__asm__ __volatile__("outw  %%ax, %2;	\
 			      orw %%ax, %%ax;	\
 			      jz 1f;		\
@@ -119,6 +124,7 @@ static inline u32 ati_do_smi_call(u16 function)
 			     : "=m" (retval)
 			     : "a"(function), "N"(ATI_SMI_PORT), "N"(ATI_SMI_PORT+1), "i"(-EIO)
 			     : "memory", "ebx", "ecx", "edx", "esi", "edi", "cc");
+#endif
 
 	local_irq_restore(flags);
 	preempt_enable_no_resched();
@@ -159,6 +165,11 @@ static inline u32 intel_do_smi_call(u16 function, struct pci_dev *lpc_bridge)
  * retval = -EIO; [too bad]
  * out:
  */
+#ifdef OMNIBOOK_SIM
+	/* User-space simulation, see sim/devices.c */
+	if (omnibook_sim_smi(function, INTEL_SMI_PORT))
+		retval = -EIO;
+#else
 	__asm__ __volatile__("outw %%ax, %2;	\
 			      orw %%ax, %%ax;	\
 			      jz 1f;		\
@@ -167,6 +178,7 @@ static inline u32 intel_do_smi_call(u16 function, struct pci_dev *lpc_bridge)
 			     : "=m" (retval)
 			     : "a"(function), "N"(INTEL_SMI_PORT), "i"(-EIO)
 			     : "memory", "ebx", "ecx", "edx", "esi", "edi", "cc");
+#endif
 
 	outl(state, sci_en);
 	local_irq_restore(flags);
@@ -181,7 +193,8 @@ static int nbsmi_smi_command(u16 function,
 {
 	int count;
 	u32 retval = 0;
-	
+	u8 code = function & 0xff;
+	ktime_t start = ktime_get();
 
 	for (count = 0; count < BUFFER_SIZE; count++) {
 		outb(count + priv_data->start_offset, RTC_PORT(2));
@@ -214,6 +227,8 @@ static int nbsmi_smi_command(u16 function,
 		*(outputbuffer + count) = inb(RTC_PORT(3));
 	}
 
+	omnibook_histogram_add(&nbsmi_backend, OMNIBOOK_HIST_SMI, start);
+	omnibook_record(&nbsmi_backend, OMNIBOOK_REC_SMI, code, *outputbuffer, retval, start);
 	return retval;
 }
 
@@ -554,7 +569,7 @@ static int omnibook_nbsmi_init(const struct omnibook_operation *io_op)
 		/* Fist use of the backend */
 		dprintk("Try to init NbSmi\n");
 		mutex_init(&io_op->backend->mutex);
-		mutex_lock(&io_op->backend->mutex);
+		omnibook_backend_lock(io_op->backend, "init");
 		kref_init(&io_op->backend->kref);
 
 		priv_data = kzalloc(sizeof(struct nbsmi_backend_data), GFP_KERNEL);
@@ -625,7 +640,7 @@ static int omnibook_nbsmi_init(const struct omnibook_operation *io_op)
 		io_op->backend->data = priv_data;
 
 		dprintk("NbSmi init ok\n");
-		mutex_unlock(&io_op->backend->mutex);
+		omnibook_backend_unlock(io_op->backend);
 		return 0;
 	} else {
 		dprintk("NbSmi has already been initialized\n");
@@ -643,7 +658,7 @@ static int omnibook_nbsmi_init(const struct omnibook_operation *io_op)
 	io_op->backend->data = NULL;
       error0:
 	io_op->backend->already_failed = 1;
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_backend_unlock(io_op->backend);
 	mutex_destroy(&io_op->backend->mutex);
 	return retval;
 }
@@ -666,7 +681,7 @@ static void nbsmi_free(struct kref *ref)
 	input_unregister_handler(&hook_handler);
 	input_unregister_device(priv_data->nbsmi_input_dev);
 
-	mutex_lock(&backend->mutex);
+	omnibook_backend_lock(backend, "exit");
 
 	switch (priv_data->lpc_bridge->vendor) {
 	case PCI_VENDOR_ID_INTEL:
@@ -684,7 +699,7 @@ static void nbsmi_free(struct kref *ref)
 	release_region(EC_INDEX_PORT, 2);
 	kfree(priv_data);
 	backend->data = NULL;
-	mutex_unlock(&backend->mutex);
+	omnibook_backend_unlock(backend);
 	mutex_destroy(&backend->mutex);
 }
 
@@ -698,24 +713,17 @@ static void omnibook_nbsmi_exit(const struct omnibook_operation *io_op)
 
 /*
  * Adjust the lcd backlight level by delta.
- * Used for Fn+F6/F7 keypress
+ * Used for Fn+F6/F7 keypress, run from the backend request queue so the
+ * Fn key handler never waits for the hardware.
  */
-static int adjust_brighness(int delta)
+static int adjust_brighness_request(struct omnibook_request *req)
 {
-	struct omnibook_feature *lcd_feature = omnibook_find_feature("lcd");
-	struct omnibook_operation *io_op;
+	int delta = (long) req->context;
 	int retval = 0;
 	u8 brgt;
 
-	if(!lcd_feature)
-		return -ENODEV;
-
-	io_op = lcd_feature->io_op;
-
-	mutex_lock(&io_op->backend->mutex);
-
-	if(( retval = __backend_byte_read(io_op, &brgt)))
-		goto out;	
+	if(( retval = __backend_byte_read(req->io_op, &brgt)))
+		return retval;
 
 	dprintk("FnF6/F7 pressed: adjusting britghtnes.\n");
 
@@ -726,10 +734,27 @@ static int adjust_brighness(int delta)
 	else
 		brgt += delta;
 
-	retval = __backend_byte_write(io_op, brgt);
+	return __backend_byte_write(req->io_op, brgt);
+}
 
-	out:
-	mutex_unlock(&io_op->backend->mutex);
+static int adjust_brighness(int delta)
+{
+	struct omnibook_feature *lcd_feature = omnibook_find_feature("lcd");
+	struct omnibook_request *req;
+	int retval;
+
+	if(!lcd_feature)
+		return -ENODEV;
+
+	req = omnibook_request_alloc(OMNIBOOK_REQ_FUNC, lcd_feature->io_op, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+	req->func = adjust_brighness_request;
+	req->context = (void *) (long) delta;
+
+	retval = omnibook_request_submit(req);
+	if (retval)
+		kfree(req);
 	return retval;
 }
 
@@ -745,6 +770,7 @@ static void omnibook_handle_fnkey(void* data)
 #endif
 {
 	int i;
+	unsigned int keycode = 0;
 	u8 gen_scan;
 	struct input_dev *input_dev;
 
@@ -770,9 +796,12 @@ static void omnibook_handle_fnkey(void* data)
 			input_dev = ((struct nbsmi_backend_data *) data)->nbsmi_input_dev;
 #endif
 			omnibook_report_key(input_dev, nbsmi_scan_table[i].keycode);
+			keycode = nbsmi_scan_table[i].keycode;
 			break;
 		}
 	}
+
+	omnibook_event_raise(OMNIBOOK_EV_FNKEY, gen_scan, keycode);
 }
 
 static int omnibook_nbsmi_get_wireless(const struct omnibook_operation *io_op, unsigned int *state)
@@ -843,7 +872,9 @@ static int omnibook_nbmsi_hotkeys_get(const struct omnibook_operation *io_op, un
 
 static int omnibook_nbmsi_hotkeys_set(const struct omnibook_operation *io_op, unsigned int state)
 {
-	int i, retval;
+	unsigned int timeout, ceiling = OMNIBOOK_TIMEOUT * 1000;
+	int i, j, retval;
+	ktime_t start;
 	u8 data, rdata;
 	struct omnibook_operation hotkeys_op = SIMPLE_BYTE(SMI, SMI_SET_FN_F5_INTERFACE, 0);	
 	u8* data_array;
@@ -870,13 +901,22 @@ static int omnibook_nbmsi_hotkeys_set(const struct omnibook_operation *io_op, un
 	 * Hardware seems to be quite stubborn and multiple retries may be
 	 * required. The criteria here is simple: retry until probed state match
 	 * the requested one (with timeout).
+	 * The timeout is the learned one, see timeout.c; tries take at least
+	 * 1ms each, so there are at most 250 of them.
 	 */
 
 	data_array = kcalloc(250, sizeof(u8), GFP_KERNEL);
 	if(!data_array)
 		return -ENODEV;
 
+	start = ktime_get();
+	timeout = omnibook_timeout(&nbsmi_backend, ceiling);
 	for (i = 0; i < 250; i++) {
+		if (i && omnibook_timed_out(start, timeout)) {
+			timeout = omnibook_latency_expired(&nbsmi_backend, timeout, ceiling);
+			if (!timeout)
+				break;
+		}
 		retval = nbsmi_smi_write_command(&hotkeys_op, data);
 		if (retval)
 			goto out;
@@ -887,14 +927,18 @@ static int omnibook_nbmsi_hotkeys_set(const struct omnibook_operation *io_op, un
 		data_array[i] = rdata;
 		if(rdata == data) {
 			dprintk("check loop ok after %i iters\n.",i);
+			omnibook_latency_add(&nbsmi_backend, start);
 			retval = 0;
 			goto out;
 		}
 	}
+	/* Out of tries before the ceiling */
+	if (timeout)
+		omnibook_latency_expired(&nbsmi_backend, ceiling, ceiling);
 	dprintk("error or check loop timeout !!\n");
 	dprintk("forensics datas: ");
-	for (i = 0; i < 250; i++)
-		dprintk_simple("%x ", data_array[i]);
+	for (j = 0; j < i; j++)
+		dprintk_simple("%x ", data_array[j]);
 	dprintk_simple("\n");
 out:
 	kfree(data_array);
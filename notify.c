@@ -0,0 +1,305 @@
+/*
+ * notify.c -- pollable sysfs attributes of the changing features
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/device.h>
+#include <linux/jiffies.h>
+#include <linux/workqueue.h>
+#include "hardware.h"
+
+/*
+ * Attributes of the platform device, one per telemetry field worth
+ * waiting for. They show the value seen by the last telemetry snapshot
+ * and sysfs_notify() is raised when a snapshot sees it change, so that
+ * poll() on them returns. Any telemetry snapshot counts: ioctl, mmap
+ * page, or the watcher below.
+ *
+ * The watcher samples the features of its registered watches, at the
+ * shortest of their intervals, and only runs while there is one: the
+ * attributes when notify_interval is set, and events.c while
+ * /dev/omnibook_events is open. Nothing is polled by default, as it
+ * costs an SMI per sample on some models. Watches are counted under
+ * watch_mutex.
+ */
+
+struct omnibook_notify_attr {
+	struct device_attribute dev_attr;
+	const char *feature;	/* filling the field */
+	u32 valid;		/* OMNIBOOK_TM_* */
+	size_t offset;		/* of the field in struct omnibook_telemetry */
+	int created;
+};
+
+static ssize_t omnibook_notify_show(struct device *dev, struct device_attribute *attr, char *buf);
+
+#define NOTIFY_ATTR(_name, _feature, _valid, _field) \
+	{ .dev_attr = __ATTR(_name, S_IRUGO, omnibook_notify_show, NULL), \
+	  .feature = _feature, .valid = _valid, \
+	  .offset = offsetof(struct omnibook_telemetry, _field) }
+
+static struct omnibook_notify_attr omnibook_notify_attrs[] = {
+	NOTIFY_ATTR(ac, "ac", OMNIBOOK_TM_AC, ac),
+	NOTIFY_ATTR(dock, "dock", OMNIBOOK_TM_DOCK, dock),
+	NOTIFY_ATTR(display, "display", OMNIBOOK_TM_DISPLAY, display),
+	NOTIFY_ATTR(wifi, "wifi", OMNIBOOK_TM_WIFI, wifi),
+	NOTIFY_ATTR(bluetooth, "bluetooth", OMNIBOOK_TM_BLUETOOTH, bluetooth),
+	NOTIFY_ATTR(fan, "fan", OMNIBOOK_TM_FAN, fan),
+};
+
+static struct device *omnibook_notify_dev;
+static struct omnibook_telemetry omnibook_notify_last;	/* values shown */
+static unsigned int omnibook_notify_interval;	/* ms, 0 for no watcher */
+static struct omnibook_watch omnibook_notify_attr_watch;
+static DEFINE_MUTEX(notify_mutex);
+
+static LIST_HEAD(omnibook_watches);
+static u32 omnibook_watch_mask;		/* OMNIBOOK_TM_* sampled by the watcher */
+static unsigned int omnibook_watch_interval;	/* ms, 0 when the watcher is stopped */
+static int omnibook_watch_suspended;
+static DEFINE_MUTEX(watch_mutex);
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+static void omnibook_notify_watcher(struct work_struct *work);
+static DECLARE_DELAYED_WORK(omnibook_notify_work, omnibook_notify_watcher);
+#else
+static void omnibook_notify_watcher(void *data);
+static DECLARE_WORK(omnibook_notify_work, omnibook_notify_watcher, NULL);
+#endif
+
+static inline s32 *notify_field(struct omnibook_telemetry *t, struct omnibook_notify_attr *a)
+{
+	return (s32 *) ((char *) t + a->offset);
+}
+
+/*
+ * Record the fields read by the snapshot t, notify the ones that changed.
+ * The first value seen of a field is not a change. A snapshot started
+ * before the last one recorded is dropped, as in events.c.
+ */
+void omnibook_notify_update(struct omnibook_telemetry *t)
+{
+	struct omnibook_notify_attr *a;
+	u32 changed = 0;
+	int i;
+
+	mutex_lock(&notify_mutex);
+	if (t->timestamp < omnibook_notify_last.timestamp)
+		goto out;
+	omnibook_notify_last.timestamp = t->timestamp;
+	for (i = 0; i < ARRAY_SIZE(omnibook_notify_attrs); i++) {
+		a = &omnibook_notify_attrs[i];
+		if (!(t->valid & a->valid))
+			continue;
+		if ((omnibook_notify_last.valid & a->valid) &&
+		    *notify_field(&omnibook_notify_last, a) != *notify_field(t, a))
+			changed |= a->valid;
+		*notify_field(&omnibook_notify_last, a) = *notify_field(t, a);
+		omnibook_notify_last.valid |= a->valid;
+	}
+
+	for (i = 0; changed && omnibook_notify_dev && i < ARRAY_SIZE(omnibook_notify_attrs); i++) {
+		a = &omnibook_notify_attrs[i];
+		if ((changed & a->valid) && a->created) {
+			dprintk("%s changed to %d.\n", a->dev_attr.attr.name,
+				*notify_field(t, a));
+			sysfs_notify(&omnibook_notify_dev->kobj, NULL,
+				     (char *) a->dev_attr.attr.name);
+		}
+	}
+      out:
+	mutex_unlock(&notify_mutex);
+}
+
+/*
+ * Unless watched nothing keeps the value fresh: take a snapshot, as
+ * before the first one of the watcher
+ */
+static ssize_t omnibook_notify_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct omnibook_notify_attr *a = container_of(attr, struct omnibook_notify_attr, dev_attr);
+	struct omnibook_telemetry t;
+	ssize_t retval;
+
+	if ((!(omnibook_watch_mask & a->valid) || !(omnibook_notify_last.valid & a->valid)) &&
+	    (retval = omnibook_telemetry_sample(&t, a->valid)))
+		return retval;
+
+	mutex_lock(&notify_mutex);
+	if (omnibook_notify_last.valid & a->valid)
+		retval = sprintf(buf, "%d\n", *notify_field(&omnibook_notify_last, a));
+	else
+		retval = -EIO;
+	mutex_unlock(&notify_mutex);
+	return retval;
+}
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+static void omnibook_notify_watcher(struct work_struct *work)
+#else
+static void omnibook_notify_watcher(void *data)
+#endif
+{
+	struct omnibook_telemetry t;
+
+	omnibook_telemetry_sample(&t, omnibook_watch_mask);
+	schedule_delayed_work(&omnibook_notify_work,
+			      msecs_to_jiffies(max(omnibook_watch_interval, 10U)));
+}
+
+/* watch_mutex held */
+static void omnibook_notify_watcher_stop(void)
+{
+#ifdef OLD_WORKQUEUE_COMPAT
+	cancel_rearming_delayed_work(&omnibook_notify_work);
+#else
+	cancel_delayed_work_sync(&omnibook_notify_work);
+#endif
+}
+
+/*
+ * Sample the union of the watches at the shortest interval, start or
+ * stop the watcher with the first or last watch. watch_mutex held
+ */
+static void omnibook_notify_rewatch(void)
+{
+	struct omnibook_watch *w;
+	unsigned int interval = 0;
+	u32 mask = 0;
+	int running;
+
+	list_for_each_entry(w, &omnibook_watches, list) {
+		mask |= w->mask;
+		if (!interval || w->interval < interval)
+			interval = w->interval;
+	}
+	mask &= omnibook_telemetry_available();
+	if (!mask)
+		interval = 0;
+
+	running = omnibook_watch_interval && !omnibook_watch_suspended;
+	if (running && !interval)
+		omnibook_notify_watcher_stop();
+	omnibook_watch_mask = mask;
+	omnibook_watch_interval = interval;
+	if (!running && interval && !omnibook_watch_suspended)
+		schedule_delayed_work(&omnibook_notify_work, 0);
+}
+
+/*
+ * Have the watcher sample the features of w->mask (OMNIBOOK_TM_*) every
+ * w->interval ms, until as many omnibook_notify_unwatch(w)
+ */
+void omnibook_notify_watch(struct omnibook_watch *w)
+{
+	mutex_lock(&watch_mutex);
+	if (!w->users++) {
+		list_add_tail(&w->list, &omnibook_watches);
+		omnibook_notify_rewatch();
+	}
+	mutex_unlock(&watch_mutex);
+}
+
+void omnibook_notify_unwatch(struct omnibook_watch *w)
+{
+	mutex_lock(&watch_mutex);
+	if (!--w->users) {
+		list_del(&w->list);
+		omnibook_notify_rewatch();
+	}
+	mutex_unlock(&watch_mutex);
+}
+
+/*
+ * Attributes are created for the enabled features able to fill their
+ * field. Failures only cost the attribute.
+ */
+void omnibook_notify_init(struct device *dev)
+{
+	struct omnibook_notify_attr *a;
+	struct omnibook_feature *feature;
+	u32 mask = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(omnibook_notify_attrs); i++) {
+		a = &omnibook_notify_attrs[i];
+		feature = omnibook_find_feature((char *) a->feature);
+		if (!feature || !feature->telemetry)
+			continue;
+		if (device_create_file(dev, &a->dev_attr)) {
+			printk(O_WARN "Unable to create the %s attribute.\n", a->dev_attr.attr.name);
+			continue;
+		}
+		a->created = 1;
+		mask |= a->valid;
+	}
+	if (!mask)
+		return;
+
+	mutex_lock(&notify_mutex);
+	omnibook_notify_dev = dev;
+	mutex_unlock(&notify_mutex);
+
+	if (omnibook_notify_interval) {
+		omnibook_notify_attr_watch.mask = mask;
+		omnibook_notify_attr_watch.interval = omnibook_notify_interval;
+		omnibook_notify_watch(&omnibook_notify_attr_watch);
+	}
+}
+
+void omnibook_notify_exit(void)
+{
+	struct device *dev = omnibook_notify_dev;
+	int i;
+
+	if (omnibook_notify_attr_watch.users)
+		omnibook_notify_unwatch(&omnibook_notify_attr_watch);
+
+	mutex_lock(&notify_mutex);
+	omnibook_notify_dev = NULL;
+	mutex_unlock(&notify_mutex);
+
+	for (i = 0; i < ARRAY_SIZE(omnibook_notify_attrs); i++) {
+		if (omnibook_notify_attrs[i].created)
+			device_remove_file(dev, &omnibook_notify_attrs[i].dev_attr);
+		omnibook_notify_attrs[i].created = 0;
+	}
+}
+
+/*
+ * No EC access across a suspend. What changed meanwhile, AC or dock
+ * most likely, is seen by the first snapshot after resume.
+ */
+void omnibook_notify_suspend(void)
+{
+	mutex_lock(&watch_mutex);
+	if (omnibook_watch_interval)
+		omnibook_notify_watcher_stop();
+	omnibook_watch_suspended = 1;
+	mutex_unlock(&watch_mutex);
+}
+
+void omnibook_notify_resume(void)
+{
+	mutex_lock(&watch_mutex);
+	omnibook_watch_suspended = 0;
+	if (omnibook_watch_interval)
+		schedule_delayed_work(&omnibook_notify_work, 0);
+	mutex_unlock(&watch_mutex);
+}
+
+module_param_named(notify_interval, omnibook_notify_interval, uint, S_IRUGO);
+MODULE_PARM_DESC(notify_interval, "Period in ms of the change watcher of the pollable sysfs attributes, 0 to disable (default)");
+
+/* End of file */
@@ -19,6 +19,7 @@
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/input.h>
+#include <linux/seq_file.h>
 #include <linux/version.h>
 
 /*
@@ -52,21 +53,24 @@ extern enum omnibook_ectype_t {
  */
 
 struct omnibook_operation;
+struct omnibook_telemetry;
+struct seq_file;
 
 struct omnibook_feature {
 	char *name;						/* Name */
 	int enabled;						/* Set from module parameter */
-	int (*read) (char *,struct omnibook_operation *);	/* Procfile read function */
+	int (*read) (struct seq_file *,struct omnibook_operation *);	/* Procfile read function */
 	int (*write) (char *,struct omnibook_operation *);	/* Procfile write function */
 	int (*init) (struct omnibook_operation *);		/* Specific Initialization function */
 	void (*exit) (struct omnibook_operation *);		/* Specific Cleanup function */
 	int (*suspend) (struct omnibook_operation *);		/* PM Suspend function */
 	int (*resume) (struct omnibook_operation *);		/* PM Resume function */
+	int (*telemetry) (struct omnibook_telemetry *,struct omnibook_operation *);	/* Snapshot fill function, backend locked */
 	int ectypes;						/* Type(s) of EC we support for this feature (bitmask) */
 	struct omnibook_tbl *tbl;
 	struct omnibook_operation *io_op;
 	struct list_head list;
-        long pad[3];
+        long pad[2];
 };
 
 /*
@@ -117,6 +121,23 @@ int set_omnibook_param(const char *val, struct kernel_param *kp);
 int omnibook_lcd_blank(int blank);
 struct omnibook_feature *omnibook_find_feature(char *name);
 void omnibook_report_key(struct input_dev *dev, unsigned int keycode);
+int omnibook_debugfs_init(void);
+void omnibook_debugfs_exit(void);
+int omnibook_flight_init(void);
+void omnibook_flight_exit(void);
+int omnibook_record_init(void);
+void omnibook_record_exit(void);
+void omnibook_telemetry_init(void);
+void omnibook_telemetry_exit(void);
+void omnibook_telemetry_suspend(void);
+void omnibook_telemetry_resume(void);
+struct device;
+void omnibook_notify_init(struct device *dev);
+void omnibook_notify_exit(void);
+void omnibook_notify_suspend(void);
+void omnibook_notify_resume(void);
+void omnibook_event_init(void);
+void omnibook_event_exit(void);
 
 /* 
  * __attribute_used__ is not defined anymore in 2.6.24
@@ -0,0 +1,132 @@
+/*
+ * omnibook_telemetry.h -- binary snapshot and events of the omnibook
+ *                         features, shared with user space
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _OMNIBOOK_TELEMETRY_H
+#define _OMNIBOOK_TELEMETRY_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * OMNIBOOK_IOC_TELEMETRY on /dev/omnibook fills a struct omnibook_telemetry
+ * with the current values of the features, as their procfs files show
+ * them. A field is meaningful only if its bit is set in valid: the feature
+ * is enabled on this model and could be read.
+ *
+ * Fields are only ever added at the end, bumping the version; size is the
+ * size of the structure filled by the driver.
+ */
+
+#define OMNIBOOK_TELEMETRY_VERSION	1
+#define OMNIBOOK_TELEMETRY_BATTERIES	3
+
+/* Bits of valid */
+enum {
+	OMNIBOOK_TM_TEMPERATURE = (1<<0),
+	OMNIBOOK_TM_FAN = (1<<1),
+	OMNIBOOK_TM_AC = (1<<2),
+	OMNIBOOK_TM_BATTERY = (1<<3),
+	OMNIBOOK_TM_LCD = (1<<4),
+	OMNIBOOK_TM_DISPLAY = (1<<5),
+	OMNIBOOK_TM_WIFI = (1<<6),
+	OMNIBOOK_TM_BLUETOOTH = (1<<7),
+	OMNIBOOK_TM_DOCK = (1<<8),
+};
+
+struct omnibook_telemetry_battery {
+	__u8 present;
+	__u8 type;		/* 1 Li-Ion, 0 NiMH */
+	__u8 gauge;		/* % */
+	__u8 status;		/* 0 unknown, 1 charged, 2 discharging, 3 charging, 4 critical */
+	__u16 sn;		/* serial number */
+	__u16 pv;		/* present voltage, mV */
+	__u16 dv;		/* design voltage, mV */
+	__u16 rc;		/* remaining capacity, mAh */
+	__u16 lc;		/* last full capacity, mAh */
+	__u16 dc;		/* design capacity, mAh */
+};
+
+struct omnibook_telemetry {
+	__u32 version;		/* OMNIBOOK_TELEMETRY_VERSION */
+	__u32 size;		/* sizeof(struct omnibook_telemetry) */
+	__u32 valid;		/* OMNIBOOK_TM_* */
+	__u32 ectype;		/* EC type bit, as the ectype parameter is 1 << (n - 1) */
+	__u64 timestamp;	/* ns, CLOCK_MONOTONIC, start of the snapshot */
+	__s32 temperature;	/* CPU, C */
+	__s32 fan;		/* 0 off, 1 on, above: level */
+	__u32 ac;		/* 1 on-line */
+	__u32 lcd;		/* brightness */
+	__u32 lcd_max;		/* highest brightness */
+	__u32 display;		/* DISPLAY_*_ON and _DET bits of omnibook.h */
+	__u32 display_cap;	/* bits of display the model reports */
+	__u32 wifi;		/* WIFI_EX, WIFI_STA and KILLSWITCH bits of omnibook.h */
+	__u32 bluetooth;	/* BT_EX and BT_STA bits of omnibook.h */
+	__u32 battery_count;	/* batteries the model can hold */
+	struct omnibook_telemetry_battery battery[OMNIBOOK_TELEMETRY_BATTERIES];
+	__u32 dock;		/* 1 docked */
+};
+
+/*
+ * The first page of /dev/omnibook can be mapped read-only. It holds a
+ * struct omnibook_telemetry_page, refreshed every interval ms while
+ * mapped. seq is odd during a refresh and changes with each of them: a
+ * copy taken between two equal even reads of seq is consistent.
+ *
+ *	do {
+ *		seq = page->seq;
+ *		rmb();
+ *		t = page->telemetry;
+ *		rmb();
+ *	} while ((seq & 1) || seq != page->seq);
+ *
+ * seq is 0 until the first refresh.
+ */
+struct omnibook_telemetry_page {
+	__u32 seq;
+	__u32 interval;		/* ms between refreshes, telemetry_interval */
+	struct omnibook_telemetry telemetry;
+};
+
+#define OMNIBOOK_IOC_MAGIC	'O'
+#define OMNIBOOK_IOC_TELEMETRY	_IOR(OMNIBOOK_IOC_MAGIC, 0x80, struct omnibook_telemetry)
+
+/*
+ * read() on /dev/omnibook_events returns whole struct omnibook_event,
+ * blocking until there is one unless O_NONBLOCK; poll() is supported.
+ * Each open file has its own queue. Events that do not fit are counted
+ * and reported by an OMNIBOOK_EV_OVERFLOW event where they were lost.
+ */
+
+enum {
+	OMNIBOOK_EV_OVERFLOW = 0,	/* value: events lost */
+	OMNIBOOK_EV_FNKEY = 1,		/* code: scancode, value: keycode reported or 0 */
+	OMNIBOOK_EV_KEYPOLL = 2,	/* code: XE3GC_Q0A bits of the key poller */
+	OMNIBOOK_EV_AC = 3,		/* value: 1 on-line */
+	OMNIBOOK_EV_DOCK = 4,		/* value: 1 docked */
+	OMNIBOOK_EV_KILLSWITCH = 5,	/* value: 1 radio on, as KILLSWITCH */
+	OMNIBOOK_EV_THERMAL = 6,	/* code: 1 above event_temperature, 0 back under, value: C */
+};
+
+struct omnibook_event {
+	__u64 timestamp;	/* ns, CLOCK_MONOTONIC */
+	__u32 type;		/* OMNIBOOK_EV_* */
+	__u32 code;
+	__s32 value;
+	__u32 reserved;
+};
+
+#endif /* _OMNIBOOK_TELEMETRY_H */
+
+/* End of file */
@@ -0,0 +1,111 @@
+/*
+ * omnibook_trace.h -- tracepoints of backend operations
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Events are fired by the helpers of hardware.h and lib.c, see
+ * /sys/kernel/debug/tracing/events/omnibook/ or perf list 'omnibook:*'.
+ * The duration is only computed when the event is enabled.
+ *
+ * DECLARE_EVENT_CLASS appeared in 2.6.33, empty stubs are used before.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM omnibook
+
+#if !defined(_OMNIBOOK_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _OMNIBOOK_TRACE_H
+
+#include <linux/version.h>
+#include <linux/ktime.h>
+
+#if defined(CONFIG_TRACEPOINTS) && (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,33))
+#define OMNIBOOK_TRACEPOINTS
+#endif
+
+struct omnibook_operation;
+
+#ifdef OMNIBOOK_TRACEPOINTS
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(omnibook_op,
+
+	TP_PROTO(const struct omnibook_operation *io_op, const char *op,
+		 unsigned long addr, unsigned int value, int retval, ktime_t start),
+
+	TP_ARGS(io_op, op, addr, value, retval, start),
+
+	TP_STRUCT__entry(
+		__string(backend, io_op->backend->name)
+		__string(feature, io_op->feature ? io_op->feature : "-")
+		__string(op, op)
+		__field(unsigned long, addr)
+		__field(unsigned int, value)
+		__field(int, retval)
+		__field(s64, duration)
+	),
+
+	TP_fast_assign(
+		__assign_str(backend, io_op->backend->name);
+		__assign_str(feature, io_op->feature ? io_op->feature : "-");
+		__assign_str(op, op);
+		__entry->addr = addr;
+		__entry->value = value;
+		__entry->retval = retval;
+		__entry->duration = ktime_to_ns(ktime_sub(ktime_get(), start));
+	),
+
+	TP_printk("backend=%s feature=%s op=%s addr=0x%02lx value=0x%02x ret=%d duration=%lld ns",
+		  __get_str(backend), __get_str(feature), __get_str(op),
+		  __entry->addr, __entry->value, __entry->retval,
+		  (long long) __entry->duration)
+);
+
+#define OMNIBOOK_TRACE_EVENT(name) \
+DEFINE_EVENT(omnibook_op, name, \
+	TP_PROTO(const struct omnibook_operation *io_op, const char *op, \
+		 unsigned long addr, unsigned int value, int retval, ktime_t start), \
+	TP_ARGS(io_op, op, addr, value, retval, start))
+
+#else /* OMNIBOOK_TRACEPOINTS */
+
+#define OMNIBOOK_TRACE_EVENT(name) \
+static inline void trace_##name(const struct omnibook_operation *io_op, const char *op, \
+				unsigned long addr, unsigned int value, int retval, \
+				ktime_t start) \
+{ \
+}
+
+#endif /* OMNIBOOK_TRACEPOINTS */
+
+OMNIBOOK_TRACE_EVENT(omnibook_byte_read);
+OMNIBOOK_TRACE_EVENT(omnibook_byte_write);
+OMNIBOOK_TRACE_EVENT(omnibook_block_read);
+OMNIBOOK_TRACE_EVENT(omnibook_block_write);
+OMNIBOOK_TRACE_EVENT(omnibook_get);
+OMNIBOOK_TRACE_EVENT(omnibook_set);
+OMNIBOOK_TRACE_EVENT(omnibook_apply_write_mask);
+OMNIBOOK_TRACE_EVENT(omnibook_toggle);
+/* Whole locked helper call, including the wait for the backend mutex */
+OMNIBOOK_TRACE_EVENT(omnibook_locked);
+
+#endif /* _OMNIBOOK_TRACE_H */
+
+#ifdef OMNIBOOK_TRACEPOINTS
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE omnibook_trace
+#include <trace/define_trace.h>
+#endif
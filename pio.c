@@ -154,7 +154,7 @@ static int omnibook_io_read(const struct omnibook_operation *io_op, u8 * value)
 
 static int omnibook_io_write(const struct omnibook_operation *io_op, u8 value)
 {
-	outb(io_op->write_addr, value);
+	outb(value, io_op->write_addr);
 	return 0;
 }
 
@@ -28,11 +28,46 @@
 
 #define OMNIBOOK_POLL	msecs_to_jiffies(100)
 
+/*
+ * Event driven mode:
+ * The firmware signals a change of XE3GC_Q0A with EC query event 0x0A.
+ * With key_polling_query=1 we hook this query and only read XE3GC_Q0A
+ * when it fires.
+ *
+ * The ACPI EC driver exports its query handler interface but only
+ * declares it in its private header (drivers/acpi/internal.h): the
+ * declarations below mirror it, hence the OMNIBOOK_WANT_EC_QUERY build
+ * option, off by default, as a mismatch would keep the module from
+ * loading. The driver runs the first handler of a query only, and ours
+ * is added ahead of the one of the DSDT: the _Q0A method is no longer
+ * evaluated while we listen, so whatever else the firmware does on this
+ * event is lost. Hence polling stays the default.
+ */
+
+#define XE3GC_Q0A_QUERY	0x0A
+
+#if defined(CONFIG_OMNIBOOK_EC_QUERY) && defined(CONFIG_ACPI_EC) && \
+    (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,24))
+#define OMNIBOOK_EC_QUERY
+
+struct acpi_ec;
+extern struct acpi_ec *first_ec;
+typedef int (*acpi_ec_query_func) (void *data);
+extern int acpi_ec_add_query_handler(struct acpi_ec *ec, u8 query_bit,
+				     acpi_handle handle, acpi_ec_query_func func,
+				     void *data);
+extern void acpi_ec_remove_query_handler(struct acpi_ec *ec, u8 query_bit);
+#endif
+
 /*
  * workqueue manipulations are mutex protected and thus kept in sync with key_polling_enabled
  */
 static struct workqueue_struct *omnibook_wq;  
 static int key_polling_enabled;
+static int key_polling_query;	/* EC query handler installed instead of polling */
+#ifdef OMNIBOOK_EC_QUERY
+static int key_polling_use_query;
+#endif
 static DEFINE_MUTEX(poll_mutex);
 
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
@@ -43,22 +78,28 @@ static void omnibook_key_poller(void *data);
 DECLARE_WORK(omnibook_poll_work, *omnibook_key_poller, NULL);
 #endif
 
+#ifdef OMNIBOOK_EC_QUERY
+static void omnibook_key_query_work(struct work_struct *work);
+static DECLARE_WORK(omnibook_query_work, omnibook_key_query_work);
+#endif
+
 static struct omnibook_feature key_polling_driver;
 static struct input_dev *poll_input_dev;
 
-#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
-	static void omnibook_key_poller(struct work_struct *work)
-#else
-	static void omnibook_key_poller(void *data)
-#endif
+/*
+ * Read and clear XE3GC_Q0A, then report pressed keys
+ */
+static void omnibook_key_scan(void)
 {
 	u8 q0a;
-	int retval;
 
-	mutex_lock(&key_polling_driver.io_op->backend->mutex);
+	omnibook_op_lock(key_polling_driver.io_op);
 	__backend_byte_read(key_polling_driver.io_op, &q0a);
 	__backend_byte_write(key_polling_driver.io_op, 0);
-	mutex_unlock(&key_polling_driver.io_op->backend->mutex);
+	omnibook_op_unlock(key_polling_driver.io_op);
+
+	if (q0a)
+		omnibook_event_raise(OMNIBOOK_EV_KEYPOLL, q0a, 0);
 
 #ifdef CONFIG_OMNIBOOK_DEBUG
 	if (unlikely(q0a & XE3GC_SLPB_MASK))
@@ -88,12 +129,65 @@ static struct input_dev *poll_input_dev;
 		dprintk("Fn+F7 - Volume mute pressed.\n");
 		omnibook_report_key(poll_input_dev, KEY_MUTE);
 	}
+}
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+	static void omnibook_key_poller(struct work_struct *work)
+#else
+	static void omnibook_key_poller(void *data)
+#endif
+{
+	int retval;
+
+	omnibook_key_scan();
 
 	retval = queue_delayed_work(omnibook_wq, &omnibook_poll_work, OMNIBOOK_POLL);
 	if(unlikely(!retval)) /* here non-zero on success */
 		printk(O_ERR "Key_poller failed to rearm.\n");
 }
 
+#ifdef OMNIBOOK_EC_QUERY
+static void omnibook_key_query_work(struct work_struct *work)
+{
+	omnibook_key_scan();
+}
+
+/*
+ * Called by the ACPI EC driver, defer the EC access to our workqueue
+ */
+static int omnibook_key_query(void *data)
+{
+	queue_work(omnibook_wq, &omnibook_query_work);
+	return 0;
+}
+
+static int omnibook_key_query_enable(void)
+{
+	if (!key_polling_use_query || acpi_disabled || !first_ec)
+		return -ENODEV;
+	if (acpi_ec_add_query_handler(first_ec, XE3GC_Q0A_QUERY, NULL, omnibook_key_query, NULL))
+		return -ENODEV;
+	/* Drop events which happened while nobody was listening */
+	queue_work(omnibook_wq, &omnibook_query_work);
+	return 0;
+}
+
+static void omnibook_key_query_disable(void)
+{
+	acpi_ec_remove_query_handler(first_ec, XE3GC_Q0A_QUERY);
+	flush_workqueue(omnibook_wq);
+}
+#else
+static inline int omnibook_key_query_enable(void)
+{
+	return -ENODEV;
+}
+
+static inline void omnibook_key_query_disable(void)
+{
+}
+#endif
+
 static int omnibook_key_polling_enable(void)
 {
 	int retval = 0;
@@ -104,6 +198,14 @@ static int omnibook_key_polling_enable(void)
 	if(key_polling_enabled)
 		goto out;
 
+	if (!omnibook_key_query_enable()) {
+		dprintk("Scancode emulation for volume buttons enabled (EC query %#x).\n",
+			XE3GC_Q0A_QUERY);
+		key_polling_query = 1;
+		key_polling_enabled = 1;
+		goto out;
+	}
+
 	retval = !queue_delayed_work(omnibook_wq, &omnibook_poll_work, OMNIBOOK_POLL);
 	if(retval)
 		printk(O_ERR "Key_poller enabling failed.\n");
@@ -125,11 +227,16 @@ static int omnibook_key_polling_disable(void)
 	if(!key_polling_enabled)
 		goto out;
 
+	if (key_polling_query) {
+		omnibook_key_query_disable();
+		key_polling_query = 0;
+	} else {
 #ifdef OLD_WORKQUEUE_COMPAT
-	cancel_rearming_delayed_workqueue(omnibook_wq, &omnibook_poll_work);
+		cancel_rearming_delayed_workqueue(omnibook_wq, &omnibook_poll_work);
 #else
-	cancel_delayed_work_sync(&omnibook_poll_work);
+		cancel_delayed_work_sync(&omnibook_poll_work);
 #endif
+	}
 	dprintk("Scancode emulation for volume buttons disabled.\n");
 	key_polling_enabled = 0;
 
@@ -139,22 +246,23 @@ static int omnibook_key_polling_disable(void)
 }
 
 
-static int omnibook_key_polling_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_key_polling_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
-	
 	if(mutex_lock_interruptible(&poll_mutex))
 		return -ERESTARTSYS;
 
-	len += sprintf(buffer + len, "Volume buttons polling is %s.\n",
-		(key_polling_enabled) ? "enabled" : "disabled");
+	seq_printf(m, "Volume buttons polling is %s.\n",
+		   (key_polling_enabled) ? "enabled" : "disabled");
+	if (key_polling_enabled)
+		seq_printf(m, "Key presses are %s.\n",
+			   (key_polling_query) ? "signaled by EC query events" : "polled");
 #ifdef CONFIG_OMNIBOOK_DEBUG
-	if(key_polling_enabled)	
-		len += sprintf(buffer + len, "Will poll in %i msec.\n",
-		jiffies_to_msecs(omnibook_poll_work.timer.expires - jiffies));
+	if(key_polling_enabled && !key_polling_query)
+		seq_printf(m, "Will poll in %i msec.\n",
+			   jiffies_to_msecs(omnibook_poll_work.timer.expires - jiffies));
 #endif
 	mutex_unlock(&poll_mutex);
-	return len;
+	return 0;
 }
 
 static int omnibook_key_polling_write(char *buffer, struct omnibook_operation *io_op)
@@ -182,7 +290,7 @@ static int omnibook_key_polling_resume(struct omnibook_operation *io_op)
 	int retval = 0;
 
 	mutex_lock(&poll_mutex);
-	if(key_polling_enabled)
+	if(key_polling_enabled && !key_polling_query)
 		retval = !queue_delayed_work(omnibook_wq, &omnibook_poll_work, OMNIBOOK_POLL);
 	mutex_unlock(&poll_mutex);
 	return retval;	
@@ -191,7 +299,7 @@ static int omnibook_key_polling_resume(struct omnibook_operation *io_op)
 static int omnibook_key_polling_suspend(struct omnibook_operation *io_op)
 {
 	mutex_lock(&poll_mutex);
-	if(key_polling_enabled) {
+	if(key_polling_enabled && !key_polling_query) {
 #ifdef OLD_WORKQUEUE_COMPAT
 		cancel_rearming_delayed_workqueue(omnibook_wq, &omnibook_poll_work);
 #else
@@ -265,4 +373,8 @@ static struct omnibook_feature __declared_feature key_polling_driver = {
 
 module_param_named(key_polling, key_polling_driver.enabled, int, S_IRUGO);
 MODULE_PARM_DESC(key_polling, "Use 0 to disable, 1 to enable key polling");
+#ifdef OMNIBOOK_EC_QUERY
+module_param_named(key_polling_query, key_polling_use_query, int, S_IRUGO);
+MODULE_PARM_DESC(key_polling_query, "Use 1 to take EC query events instead of polling, the DSDT _Q0A method is then no longer run");
+#endif
 /* End of file */
@@ -0,0 +1,200 @@
+/*
+ * queue.c -- asynchronous backend request queue
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/workqueue.h>
+#include <linux/spinlock.h>
+#include <linux/completion.h>
+#include "hardware.h"
+
+/*
+ * Each backend owns a list of pending requests drained by a single work
+ * item. The worker takes the backend mutex once for everything queued so
+ * far, runs the requests in order, releases the mutex and only then calls
+ * the completion callbacks, which are thus free to submit new requests or
+ * to use the synchronous helpers.
+ *
+ * Submission checks queue_open and queues the work under queue_lock, so
+ * that once omnibook_queue_exit() closed every backend no work can be
+ * queued past the workqueue destruction.
+ */
+
+static struct workqueue_struct *omnibook_queue_wq;
+
+static int omnibook_request_run(struct omnibook_request *req)
+{
+	switch (req->type) {
+	case OMNIBOOK_REQ_READ:
+		return __backend_byte_read(req->io_op, &req->data);
+	case OMNIBOOK_REQ_WRITE:
+		return __backend_byte_write(req->io_op, req->data);
+	case OMNIBOOK_REQ_TOGGLE:
+		return __omnibook_toggle(req->io_op, req->data);
+	case OMNIBOOK_REQ_FUNC:
+		return req->func(req);
+	}
+	return -EINVAL;
+}
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+static void omnibook_queue_worker(struct work_struct *work)
+#else
+static void omnibook_queue_worker(void *data)
+#endif
+{
+	struct omnibook_backend *backend;
+	struct omnibook_request *req, *tmp;
+	LIST_HEAD(batch);
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+	backend = container_of(work, struct omnibook_backend, queue_work);
+#else
+	backend = data;
+#endif
+
+	spin_lock_irq(&backend->queue_lock);
+	list_splice_init(&backend->queue, &batch);
+	spin_unlock_irq(&backend->queue_lock);
+
+	if (list_empty(&batch))
+		return;
+
+	omnibook_backend_lock(backend, "queue");
+	list_for_each_entry(req, &batch, list)
+		req->retval = omnibook_request_run(req);
+	omnibook_backend_unlock(backend);
+
+	list_for_each_entry_safe(req, tmp, &batch, list) {
+		list_del(&req->list);
+		if (req->complete)
+			req->complete(req);
+		if (req->flags & OMNIBOOK_REQ_AUTOFREE)
+			kfree(req);
+		else
+			complete(&req->done);
+	}
+}
+
+/*
+ * Prepare a caller allocated request
+ */
+void omnibook_request_init(struct omnibook_request *req, enum omnibook_request_type type,
+			   const struct omnibook_operation *io_op)
+{
+	memset(req, 0, sizeof(struct omnibook_request));
+	INIT_LIST_HEAD(&req->list);
+	init_completion(&req->done);
+	req->type = type;
+	req->io_op = io_op;
+}
+
+/*
+ * Allocate a request which is freed once its completion callback returned
+ * gfp is GFP_ATOMIC when called from atomic context
+ */
+struct omnibook_request *omnibook_request_alloc(enum omnibook_request_type type,
+						const struct omnibook_operation *io_op,
+						gfp_t gfp)
+{
+	struct omnibook_request *req;
+
+	req = kmalloc(sizeof(struct omnibook_request), gfp);
+	if (!req)
+		return NULL;
+	omnibook_request_init(req, type, io_op);
+	req->flags = OMNIBOOK_REQ_AUTOFREE;
+	return req;
+}
+
+/*
+ * Queue a request, never sleeps
+ */
+int omnibook_request_submit(struct omnibook_request *req)
+{
+	struct omnibook_backend *backend = req->io_op->backend;
+	unsigned long flags;
+	int retval = 0;
+
+	spin_lock_irqsave(&backend->queue_lock, flags);
+	if (likely(backend->queue_open)) {
+		list_add_tail(&req->list, &backend->queue);
+		queue_work(omnibook_queue_wq, &backend->queue_work);
+	} else
+		retval = -ENODEV;
+	spin_unlock_irqrestore(&backend->queue_lock, flags);
+
+	return retval;
+}
+
+/*
+ * Wait for a caller allocated request, return its result
+ */
+int omnibook_request_wait(struct omnibook_request *req)
+{
+	wait_for_completion(&req->done);
+	return req->retval;
+}
+
+int __init omnibook_queue_init(void)
+{
+	struct omnibook_backend *backend;
+	int i;
+
+	for (i = 0; (backend = omnibook_backends[i]); i++) {
+		INIT_LIST_HEAD(&backend->queue);
+		spin_lock_init(&backend->queue_lock);
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+		INIT_WORK(&backend->queue_work, omnibook_queue_worker);
+#else
+		INIT_WORK(&backend->queue_work, omnibook_queue_worker, backend);
+#endif
+	}
+
+	omnibook_queue_wq = create_singlethread_workqueue("omnibook_io");
+	if (!omnibook_queue_wq)
+		return -ENOMEM;
+
+	for (i = 0; (backend = omnibook_backends[i]); i++) {
+		spin_lock_irq(&backend->queue_lock);
+		backend->queue_open = 1;
+		spin_unlock_irq(&backend->queue_lock);
+	}
+	return 0;
+}
+
+/*
+ * Stop accepting requests and run everything still queued
+ * Producers should be gone already: their requests now fail with -ENODEV
+ */
+void omnibook_queue_exit(void)
+{
+	struct omnibook_backend *backend;
+	int i;
+
+	if (!omnibook_queue_wq)
+		return;
+
+	for (i = 0; (backend = omnibook_backends[i]); i++) {
+		spin_lock_irq(&backend->queue_lock);
+		backend->queue_open = 0;
+		spin_unlock_irq(&backend->queue_lock);
+	}
+
+	/* This drains the pending requests */
+	destroy_workqueue(omnibook_queue_wq);
+	omnibook_queue_wq = NULL;
+}
+
+/* End of file */
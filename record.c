@@ -0,0 +1,318 @@
+/*
+ * record.c -- binary trace of hardware transactions
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <asm/uaccess.h>
+#include "hardware.h"
+
+/*
+ * Unlike the flight recorder, which keeps the last calls in memory for
+ * post-mortem inspection, a recording keeps the first calls from its
+ * start in a compact form, struct omnibook_record of hardware.h, with
+ * their timing. It covers the backend calls of the helpers of hardware.h
+ * as well as the SMI calls and the ACPI methods beneath them. Once the
+ * buffer is full further calls are only counted.
+ *
+ * Reading omnibook/record in debugfs returns the trace, header first, as
+ * expected by the replay of the simulated backend (simulated.c). Writing
+ * a number to it starts a new recording of that many entries, 0 stops.
+ */
+
+int omnibook_recording = 0;
+
+static unsigned int omnibook_record_entries = 0;
+
+static DEFINE_SPINLOCK(omnibook_record_lock);	/* protects the buffer */
+static DEFINE_MUTEX(omnibook_record_mutex);	/* serializes start and snapshot */
+
+static struct {
+	struct omnibook_record *buf;
+	unsigned int size;		/* entries in buf */
+	unsigned int count;		/* entries used */
+	unsigned int dropped;		/* calls not recorded, buf was full */
+	s64 last;			/* ns, start of the last record */
+} omnibook_rec;
+
+static const char *omnibook_record_ops[OMNIBOOK_REC_SMI] = {
+	[OMNIBOOK_REC_READ] = "read",
+	[OMNIBOOK_REC_WRITE] = "write",
+	[OMNIBOOK_REC_BLOCK_READ] = "block_read",
+	[OMNIBOOK_REC_BLOCK_WRITE] = "block_write",
+	[OMNIBOOK_REC_AERIAL_GET] = "aerial_get",
+	[OMNIBOOK_REC_AERIAL_SET] = "aerial_set",
+	[OMNIBOOK_REC_HOTKEYS_GET] = "hotkeys_get",
+	[OMNIBOOK_REC_HOTKEYS_SET] = "hotkeys_set",
+	[OMNIBOOK_REC_DISPLAY_GET] = "display_get",
+	[OMNIBOOK_REC_DISPLAY_SET] = "display_set",
+	[OMNIBOOK_REC_THROTTLE_GET] = "throttle_get",
+	[OMNIBOOK_REC_THROTTLE_SET] = "throttle_set",
+};
+
+/*
+ * Index of the backend in omnibook_backends, as named in the header
+ */
+static u8 omnibook_record_backend(const struct omnibook_backend *backend)
+{
+	int i;
+
+	for (i = 0; i < OMNIBOOK_RECORD_BACKENDS && omnibook_backends[i]; i++)
+		if (omnibook_backends[i] == backend)
+			break;
+	return i;
+}
+
+/*
+ * Record a call which started at start
+ */
+void __omnibook_record(const struct omnibook_backend *backend, enum omnibook_record_type type,
+		       unsigned long addr, unsigned int value, int retval, ktime_t start)
+{
+	struct omnibook_record *r;
+	s64 stamp = ktime_to_ns(start);
+	s64 duration = ktime_to_ns(ktime_sub(ktime_get(), start));
+	unsigned long flags;
+
+	spin_lock_irqsave(&omnibook_record_lock, flags);
+	if (!omnibook_rec.buf)
+		goto out;
+	if (omnibook_rec.count == omnibook_rec.size) {
+		omnibook_rec.dropped++;
+		goto out;
+	}
+
+	r = &omnibook_rec.buf[omnibook_rec.count];
+	if (omnibook_rec.count++)
+		r->delta = clamp_t(s64, stamp - omnibook_rec.last, INT_MIN, INT_MAX);
+	else
+		r->delta = 0;
+	omnibook_rec.last = stamp;
+	r->duration = min_t(s64, duration, ~0U);
+	r->addr = addr;
+	r->value = value;
+	r->retval = retval;
+	r->backend = omnibook_record_backend(backend);
+	r->type = type;
+	r->reserved = 0;
+
+      out:
+	spin_unlock_irqrestore(&omnibook_record_lock, flags);
+}
+
+/*
+ * Record a call of the helpers of hardware.h, op names the call
+ */
+void __omnibook_record_op(const struct omnibook_backend *backend, const char *op,
+			  unsigned long addr, unsigned int value, int retval, ktime_t start)
+{
+	int i;
+
+	for (i = 0; i < OMNIBOOK_REC_SMI; i++)
+		if (!strcmp(op, omnibook_record_ops[i]))
+			break;
+	if (i == OMNIBOOK_REC_SMI)
+		return;
+	__omnibook_record(backend, i, addr, value, retval, start);
+}
+
+/*
+ * ACPI methods are recorded by their last name segment, packed in an u32:
+ * "LCD._DCS" as '_' | 'D' << 8 | 'C' << 16 | 'S' << 24
+ */
+u32 omnibook_record_name(const char *method)
+{
+	const char *seg = strrchr(method, '.');
+	u32 name = 0;
+	int i;
+
+	seg = seg ? seg + 1 : method;
+	if (*seg == '\\')
+		seg++;
+	for (i = 0; i < 4 && seg[i]; i++)
+		name |= (u8) seg[i] << (i * 8);
+	return name;
+}
+
+/*
+ * Start a new recording of entries calls, dropping the previous one.
+ * 0 only stops.
+ */
+int omnibook_record_start(unsigned int entries)
+{
+	struct omnibook_record *buf = NULL, *old;
+	unsigned long flags;
+
+	if (entries) {
+		buf = vmalloc(entries * sizeof(struct omnibook_record));
+		if (!buf)
+			return -ENOMEM;
+	}
+
+	mutex_lock(&omnibook_record_mutex);
+	omnibook_recording = 0;
+	spin_lock_irqsave(&omnibook_record_lock, flags);
+	old = omnibook_rec.buf;
+	omnibook_rec.buf = buf;
+	omnibook_rec.size = entries;
+	omnibook_rec.count = 0;
+	omnibook_rec.dropped = 0;
+	spin_unlock_irqrestore(&omnibook_record_lock, flags);
+	omnibook_recording = !!buf;
+	mutex_unlock(&omnibook_record_mutex);
+
+	vfree(old);
+	return 0;
+}
+
+/*
+ * Copy of the trace, header first, to be freed with vfree
+ * The recording goes on.
+ */
+void *omnibook_record_snapshot(size_t *len)
+{
+	struct omnibook_record_header *hdr;
+	unsigned long flags;
+	size_t size;
+	int i;
+
+	mutex_lock(&omnibook_record_mutex);
+	size = sizeof(struct omnibook_record_header) +
+	       omnibook_rec.size * sizeof(struct omnibook_record);
+	hdr = vmalloc(size);
+	if (!hdr)
+		goto out;
+
+	memset(hdr, 0, sizeof(struct omnibook_record_header));
+	memcpy(hdr->magic, OMNIBOOK_RECORD_MAGIC, sizeof(hdr->magic));
+	hdr->version = OMNIBOOK_RECORD_VERSION;
+	hdr->record_size = sizeof(struct omnibook_record);
+	hdr->ectype = omnibook_ectype;
+	for (i = 0; i < OMNIBOOK_RECORD_BACKENDS && omnibook_backends[i]; i++)
+		strncpy(hdr->backend[i], omnibook_backends[i]->name, OMNIBOOK_RECORD_NAME_LEN);
+
+	spin_lock_irqsave(&omnibook_record_lock, flags);
+	hdr->count = omnibook_rec.count;
+	hdr->dropped = omnibook_rec.dropped;
+	memcpy(hdr + 1, omnibook_rec.buf, hdr->count * sizeof(struct omnibook_record));
+	spin_unlock_irqrestore(&omnibook_record_lock, flags);
+
+	*len = sizeof(struct omnibook_record_header) + hdr->count * sizeof(struct omnibook_record);
+      out:
+	mutex_unlock(&omnibook_record_mutex);
+	return hdr;
+}
+
+/*
+ * debugfs interface: the snapshot is taken at open
+ */
+
+struct omnibook_record_file {
+	void *trace;
+	size_t len;
+};
+
+static int omnibook_record_open(struct inode *inode, struct file *file)
+{
+	struct omnibook_record_file *f;
+
+	f = kzalloc(sizeof(struct omnibook_record_file), GFP_KERNEL);
+	if (!f)
+		return -ENOMEM;
+	if (file->f_mode & FMODE_READ) {
+		f->trace = omnibook_record_snapshot(&f->len);
+		if (!f->trace) {
+			kfree(f);
+			return -ENOMEM;
+		}
+	}
+	file->private_data = f;
+	return 0;
+}
+
+static ssize_t omnibook_record_read(struct file *file, char __user *buf, size_t count,
+				    loff_t *ppos)
+{
+	struct omnibook_record_file *f = file->private_data;
+
+	if (!f->trace)
+		return -EINVAL;
+	return simple_read_from_buffer(buf, count, ppos, f->trace, f->len);
+}
+
+static ssize_t omnibook_record_write(struct file *file, const char __user *buf, size_t count,
+				     loff_t *ppos)
+{
+	char tmp[16];
+	unsigned long entries;
+	int retval;
+
+	if (count > sizeof(tmp) - 1)
+		return -EINVAL;
+	if (copy_from_user(tmp, buf, count))
+		return -EFAULT;
+	tmp[count] = 0;
+
+	entries = simple_strtoul(tmp, NULL, 0);
+	if (entries > (64 << 20) / sizeof(struct omnibook_record))
+		return -EINVAL;
+	retval = omnibook_record_start(entries);
+	return retval ? retval : count;
+}
+
+static int omnibook_record_release(struct inode *inode, struct file *file)
+{
+	struct omnibook_record_file *f = file->private_data;
+
+	vfree(f->trace);
+	kfree(f);
+	return 0;
+}
+
+static const struct file_operations omnibook_record_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_record_open,
+	.read = omnibook_record_read,
+	.write = omnibook_record_write,
+	.release = omnibook_record_release,
+};
+
+/*
+ * Not fatal: the driver works without the recording
+ */
+int __init omnibook_record_init(void)
+{
+	if (omnibook_record_entries && omnibook_record_start(omnibook_record_entries))
+		printk(O_WARN "Unable to allocate %u trace entries.\n", omnibook_record_entries);
+	return 0;
+}
+
+void omnibook_record_exit(void)
+{
+	omnibook_record_start(0);
+}
+
+void omnibook_record_debugfs(void)
+{
+	omnibook_debugfs_file(NULL, "record", S_IRUSR | S_IWUSR, &omnibook_record_fops);
+}
+
+module_param_named(record, omnibook_record_entries, uint, S_IRUGO);
+MODULE_PARM_DESC(record, "Record the first <record> hardware transactions from load, see debugfs omnibook/record");
+
+/* End of file */
@@ -0,0 +1,474 @@
+/*
+ * acpica.c -- stand-in for the ACPI namespace and AML methods used by acpi.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook_sim.h"
+#include "sim.h"
+
+/*
+ * The namespace holds the devices and methods acpi.c looks for on TSM70
+ * and TSX205 models, all present at once. Methods are C functions over a
+ * small firmware state. Evaluations are serialized, as by the AML
+ * interpreter mutex, and each takes acpi_ns unless the method has its
+ * own latency.
+ *
+ * Methods can be programmed from the command line, the name matches the
+ * end of the path on a segment boundary so _DCS selects all of them:
+ *   acpi:<method>=<value>	integer result, or out[2] of SPFC
+ *   acpi:<method>=/<ns>	latency
+ *   acpi:<method>=<value>/<ns>	both
+ *   acpi:<method>=fail		evaluation fails
+ */
+
+int acpi_disabled = 0;
+
+/* Toshiba HCI, as used by SPFC */
+#define HCI_GET			0xfe00
+#define HCI_SET			0xff00
+#define HCI_HOTKEY_EVENT	0x001e
+#define HCI_RF_CONTROL		0x0056
+#define HCI_WIRELESS_CHECK	0x0001
+#define HCI_WIRELESS_POWER	0x0200
+#define HCI_SUCCESS		0x0000
+#define HCI_NOT_SUPPORTED	0x8000
+#define HCI_WORDS		6
+
+#define HCI_MUTE		0x101
+
+#define ACPI_SIM_MAX_ARGS	HCI_WORDS
+#define ACPI_SIM_MAX_RESULTS	HCI_WORDS
+
+/* Display bits of DOSS, _DCS derives from the same state */
+#define DSP_LCD			0x1
+#define DSP_CRT			0x2
+#define DSP_TVO			0x4
+#define DSP_DVI			0x8
+
+static struct {
+	int wifi;		/* wireless radio on */
+	int bt_usb;		/* bluetooth attached to USB */
+	int bt_power;		/* bluetooth powered */
+	int killswitch;		/* radios killed by the switch */
+	unsigned int dsp_det;	/* displays detected */
+	unsigned int dsp_en;	/* displays enabled */
+	unsigned int thtl_en;	/* throttling enabled */
+	unsigned int thtl_dty;	/* throttling duty */
+	unsigned int hci_fn;	/* Fn hotkeys enabled */
+	unsigned int sli;	/* dual graphics */
+	unsigned int event;	/* last Fn key event for INFO */
+} fw;
+
+/* Display modes of DOSW and STBL, argument is the row number + 1 */
+static const unsigned int fw_display_modes[] = {
+	DSP_LCD,
+	DSP_CRT,
+	DSP_LCD | DSP_CRT,
+	DSP_TVO,
+	DSP_LCD | DSP_TVO,
+	DSP_CRT | DSP_TVO,
+	DSP_LCD | DSP_CRT | DSP_TVO,
+	DSP_DVI,
+	DSP_LCD | DSP_DVI,
+};
+
+struct acpi_sim_node;
+
+/* Returns the number of results, 0 for none, or -1 if the method fails */
+typedef int (*acpi_sim_method) (const struct acpi_sim_node *node, const u64 *args, int argc,
+				u64 *out);
+
+struct acpi_sim_node {
+	const char *path;
+	acpi_sim_method method;	/* NULL for a device */
+	int arg;		/* passed to shared methods */
+
+	/* Programmed from the command line */
+	int overridden;
+	u64 value;
+	int has_ns;
+	unsigned long ns;
+	int fail;
+};
+
+static int fw_antr(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	out[0] = 0x4 | 0x8;	/* WLEX | BTEX */
+	out[0] |= fw.wifi ? 0x1 : 0;
+	out[0] |= (fw.bt_usb && fw.bt_power) ? 0x2 : 0;
+	out[0] |= fw.killswitch ? 0x10 : 0;
+	return 1;
+}
+
+static int fw_antw(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	if (argc != 1)
+		return -1;
+	fw.wifi = !!(args[0] & 0x1);
+	fw.bt_usb = fw.bt_power = !!(args[0] & 0x2);
+	return 0;
+}
+
+static int fw_set_display(u64 mode)
+{
+	if (mode < 1 || mode > ARRAY_SIZE(fw_display_modes))
+		return -1;
+	fw.dsp_en = fw_display_modes[mode - 1];
+	return 0;
+}
+
+static int fw_doss(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	out[0] = fw.dsp_en | fw.dsp_det << 4;
+	return 1;
+}
+
+static int fw_dosw(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	if (argc != 1)
+		return -1;
+	return fw_set_display(args[0]);
+}
+
+/* 0x1f detected and enabled, 0x1d detected, 0x0f enabled, 0x0d none */
+static int fw_dcs(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	out[0] = 0x0d;
+	out[0] |= (fw.dsp_det & node->arg) ? 0x10 : 0;
+	out[0] |= (fw.dsp_en & node->arg) ? 0x02 : 0;
+	return 1;
+}
+
+static int fw_thro(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	if (argc != 1 || args[0] > 1)
+		return -1;
+	out[0] = args[0] ? fw.thtl_dty : fw.thtl_en;
+	return 1;
+}
+
+static int fw_clck(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	if (argc != 1 || args[0] > 7)
+		return -1;
+	fw.thtl_en = !!args[0];
+	fw.thtl_dty = args[0];
+	return 0;
+}
+
+static int fw_none(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	return 0;
+}
+
+static int fw_klsw(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	out[0] = !fw.killswitch;
+	return 1;
+}
+
+static int fw_info(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	out[0] = fw.event;
+	return 1;
+}
+
+static int fw_csli(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	out[0] = fw.sli;
+	return 1;
+}
+
+static int fw_stbl(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	if (argc != 1)
+		return -1;
+	return fw_set_display(args[0]);
+}
+
+static int fw_spfc(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	int i;
+
+	if (argc != HCI_WORDS)
+		return -1;
+	for (i = 0; i < HCI_WORDS; i++)
+		out[i] = args[i];
+	out[0] = HCI_SUCCESS;
+
+	switch (args[1]) {
+	case HCI_HOTKEY_EVENT:
+		if (args[0] == HCI_SET)
+			fw.hci_fn = !!args[2];
+		out[2] = fw.hci_fn;
+		break;
+	case HCI_RF_CONTROL:
+		if (args[0] == HCI_SET && args[3] == HCI_WIRELESS_POWER)
+			fw.wifi = !!args[2];
+		if (args[3] == HCI_WIRELESS_CHECK)
+			out[2] = 0x1;	/* present */
+		else
+			out[2] = fw.wifi;
+		break;
+	default:
+		out[0] = HCI_NOT_SUPPORTED;
+	}
+	return HCI_WORDS;
+}
+
+static int fw_btst(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	out[0] = 0x1;		/* KSST */
+	out[0] |= fw.bt_usb ? 0x40 : 0;
+	out[0] |= fw.bt_power ? 0x80 : 0;
+	return 1;
+}
+
+static int fw_bt_usb(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	fw.bt_usb = node->arg;
+	return 0;
+}
+
+static int fw_bt_power(const struct acpi_sim_node *node, const u64 *args, int argc, u64 *out)
+{
+	fw.bt_power = node->arg;
+	return 0;
+}
+
+#define EC0	"\\_SB.PCI0.LPCB.EC0"
+#define VALZ	"\\_SB.VALZ"
+#define VGA	"\\_SB.PCI0.PEGP.VGA"
+#define BT	"\\_SB.BT"
+
+static struct acpi_sim_node acpi_sim_nodes[] = {
+	{ EC0 },
+	{ EC0 ".ANTR", fw_antr },
+	{ EC0 ".ANTW", fw_antw },
+	{ EC0 ".DOSS", fw_doss },
+	{ EC0 ".DOSW", fw_dosw },
+	{ EC0 ".THRO", fw_thro },
+	{ EC0 ".CLCK", fw_clck },
+	{ EC0 ".NTFY", fw_none },
+	{ EC0 ".KLSW", fw_klsw },
+	{ VALZ },
+	{ VALZ ".SPFC", fw_spfc },
+	{ VALZ ".INFO", fw_info },
+	{ VGA },
+	{ VGA ".LCD._DCS", fw_dcs, DSP_LCD },
+	{ VGA ".CRT._DCS", fw_dcs, DSP_CRT },
+	{ VGA ".TV._DCS", fw_dcs, DSP_TVO },
+	{ VGA ".DVI._DCS", fw_dcs, DSP_DVI },
+	{ VGA ".SL01.VGA1.LCD._DCS", fw_dcs, DSP_LCD },
+	{ VGA ".SL01.VGA1.CRT._DCS", fw_dcs, DSP_CRT },
+	{ VGA ".SL01.VGA1.TV._DCS", fw_dcs, DSP_TVO },
+	{ VGA ".SL01.VGA1.DVI._DCS", fw_dcs, DSP_DVI },
+	{ VGA ".STBL", fw_stbl },
+	{ VGA ".SL01.VGA1.STBL", fw_stbl },
+	{ VGA ".DSSW", fw_none },
+	{ VGA ".CSLI", fw_csli },
+	{ BT },
+	{ BT ".AUSB", fw_bt_usb, 1 },
+	{ BT ".DUSB", fw_bt_usb, 0 },
+	{ BT ".BTPO", fw_bt_power, 1 },
+	{ BT ".BTPF", fw_bt_power, 0 },
+	{ BT ".BTST", fw_btst },
+};
+
+static pthread_mutex_t acpi_sim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Power-on state of the firmware, the programming is kept
+ */
+void omnibook_sim_acpi_reset(void)
+{
+	pthread_mutex_lock(&acpi_sim_lock);
+	memset(&fw, 0, sizeof(fw));
+	fw.wifi = 1;
+	fw.dsp_det = DSP_LCD | DSP_CRT;
+	fw.dsp_en = DSP_LCD;
+	fw.hci_fn = 1;
+	fw.event = HCI_MUTE;
+	pthread_mutex_unlock(&acpi_sim_lock);
+}
+
+static struct acpi_sim_node *acpi_sim_lookup(acpi_handle parent, const char *pathname)
+{
+	const struct acpi_sim_node *scope = parent;
+	size_t len = 0;
+	int i;
+
+	if (pathname[0] != '\\' && scope)
+		len = strlen(scope->path);
+
+	for (i = 0; i < ARRAY_SIZE(acpi_sim_nodes); i++) {
+		const char *path = acpi_sim_nodes[i].path;
+
+		if (len && (strncmp(path, scope->path, len) || path[len] != '.'))
+			continue;
+		if (!strcmp(path + (len ? len + 1 : 0), pathname))
+			return &acpi_sim_nodes[i];
+	}
+	return NULL;
+}
+
+acpi_status acpi_get_handle(acpi_handle parent, acpi_string pathname, acpi_handle *ret_handle)
+{
+	*ret_handle = acpi_sim_lookup(parent, pathname);
+	return *ret_handle ? AE_OK : AE_NOT_FOUND;
+}
+
+acpi_status acpi_evaluate_object(acpi_handle handle, acpi_string pathname,
+				 struct acpi_object_list *params, struct acpi_buffer *ret)
+{
+	struct acpi_sim_node *node = handle;
+	union acpi_object *obj;
+	u64 args[ACPI_SIM_MAX_ARGS];
+	u64 out[ACPI_SIM_MAX_RESULTS];
+	int argc = params ? params->count : 0;
+	int count, i;
+
+	if (pathname)
+		node = acpi_sim_lookup(handle, pathname);
+	if (!node)
+		return AE_NOT_FOUND;
+	if (!node->method || argc > ACPI_SIM_MAX_ARGS)
+		return AE_BAD_PARAMETER;
+	for (i = 0; i < argc; i++) {
+		if (params->pointer[i].type != ACPI_TYPE_INTEGER)
+			return AE_BAD_PARAMETER;
+		args[i] = params->pointer[i].integer.value;
+	}
+
+	pthread_mutex_lock(&acpi_sim_lock);
+	omnibook_sim_io[OMNIBOOK_SIM_ACPI].out++;
+	ndelay(node->has_ns ? node->ns : omnibook_sim.acpi_ns);
+	count = node->fail ? -1 : node->method(node, args, argc, out);
+	if (count > 0 && node->overridden)
+		out[count > 1 ? 2 : 0] = node->value;
+	pthread_mutex_unlock(&acpi_sim_lock);
+
+	if (count < 0)
+		return AE_ERROR;
+	if (!count || !ret)
+		return AE_OK;
+
+	obj = ret->pointer;
+	if (count == 1) {
+		if (ret->length < sizeof(*obj))
+			return AE_BUFFER_OVERFLOW;
+		obj->integer.type = ACPI_TYPE_INTEGER;
+		obj->integer.value = out[0];
+	} else {
+		if (ret->length < (count + 1) * sizeof(*obj))
+			return AE_BUFFER_OVERFLOW;
+		obj->package.type = ACPI_TYPE_PACKAGE;
+		obj->package.count = count;
+		obj->package.elements = obj + 1;
+		for (i = 0; i < count; i++) {
+			obj[i + 1].integer.type = ACPI_TYPE_INTEGER;
+			obj[i + 1].integer.value = out[i];
+		}
+	}
+	return AE_OK;
+}
+
+/*
+ * The bluetooth device is always there, its driver is bound at once
+ */
+static struct acpi_driver *acpi_sim_bt_driver;
+static struct acpi_device acpi_sim_bt_device;
+
+int acpi_bus_register_driver(struct acpi_driver *driver)
+{
+	if (strcmp(driver->ids[0].id, "TOS6205") || acpi_sim_bt_driver)
+		return 0;
+	acpi_sim_bt_driver = driver;
+	memset(&acpi_sim_bt_device, 0, sizeof(acpi_sim_bt_device));
+	acpi_sim_bt_device.handle = acpi_sim_lookup(NULL, BT);
+	driver->ops.add(&acpi_sim_bt_device);
+	return 0;
+}
+
+void acpi_bus_unregister_driver(struct acpi_driver *driver)
+{
+	if (driver != acpi_sim_bt_driver)
+		return;
+	driver->ops.remove(&acpi_sim_bt_device, 0);
+	acpi_sim_bt_driver = NULL;
+}
+
+/*
+ * Program the methods matching an acpi:<method>=... argument
+ */
+int omnibook_sim_acpi_param(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	const char *spec;
+	size_t len, plen;
+	unsigned long ns = 0;
+	u64 value = 0;
+	int has_value = 0, has_ns = 0, fail = 0;
+	int matched = 0;
+	char *end;
+	int i;
+
+	if (!eq || eq == arg)
+		return -EINVAL;
+	len = eq - arg;
+	spec = eq + 1;
+
+	if (!strcmp(spec, "fail"))
+		fail = 1;
+	else {
+		if (*spec != '/') {
+			value = strtoull(spec, &end, 0);
+			if (end == spec)
+				return -EINVAL;
+			has_value = 1;
+			spec = end;
+		}
+		if (*spec == '/') {
+			ns = strtoul(spec + 1, &end, 0);
+			if (end == spec + 1)
+				return -EINVAL;
+			has_ns = 1;
+			spec = end;
+		}
+		if (*spec)
+			return -EINVAL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(acpi_sim_nodes); i++) {
+		struct acpi_sim_node *node = &acpi_sim_nodes[i];
+
+		plen = strlen(node->path);
+		if (!node->method || plen < len || strncmp(node->path + plen - len, arg, len))
+			continue;
+		if (plen > len && node->path[plen - len - 1] != '.')
+			continue;
+		if (fail)
+			node->fail = 1;
+		if (has_value) {
+			node->overridden = 1;
+			node->value = value;
+		}
+		if (has_ns) {
+			node->has_ns = 1;
+			node->ns = ns;
+		}
+		matched++;
+	}
+	return matched ? 0 : -ENOENT;
+}
+
+/* End of file */
@@ -0,0 +1,597 @@
+/*
+ * bench.c -- transactions per second and latency of the backends against
+ *            the simulated hardware
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <unistd.h>
+
+#include "omnibook.h"
+#include "hardware.h"
+#include "sim.h"
+
+/*
+ * Each case runs one operation through the locked helpers of hardware.h,
+ * as a feature would, for a fixed time. Write cases then read the
+ * register back through the backend to check the whole path.
+ *
+ * -w saves a trace of the run (record.c), -r replays the backend calls of
+ * such a trace through the simulated backend with the recorded timing,
+ * see simulated.c, instead of running the cases.
+ *
+ * -s loads the features of an EC type and runs the stall benchmark of
+ * stall.c over them instead. Interrupts are never masked here: this
+ * checks the benchmark itself more than the backends.
+ */
+
+enum bench_op {
+	BENCH_READ,
+	BENCH_WRITE,
+	BENCH_BLOCK_READ,
+	BENCH_AERIAL_GET,
+	BENCH_AERIAL_SET,
+	BENCH_DISPLAY_GET,
+	BENCH_HOTKEYS_GET,
+	BENCH_THROTTLE_GET,
+	BENCH_FNKEY,		/* Fn key scancode through the input hook */
+	BENCH_REPLAY,		/* i-th backend call of the replayed trace */
+};
+
+#define BENCH_BLOCK_LEN		16
+
+struct bench_case {
+	const char *name;
+	struct omnibook_backend *backend;
+	enum omnibook_ectype_t ectype;
+	enum bench_op op;
+	unsigned long read_addr;
+	unsigned long write_addr;
+	int readable;		/* backend can read back what was written */
+};
+
+static const struct bench_case bench_cases[] = {
+	{ "read", EC, NONE, BENCH_READ, 0x10, 0x10, 1 },
+	{ "write", EC, NONE, BENCH_WRITE, 0x10, 0x10, 1 },
+	{ "block read", EC, NONE, BENCH_BLOCK_READ, 0x10, 0x10, 1 },
+	{ "shadow read", EC, XE3GF, BENCH_READ, XE3GF_FOT, XE3GF_FOT, 1 },
+	{ "write", KBC, NONE, BENCH_WRITE, 0, 0, 0 },
+	{ "read", PIO, OB500, BENCH_READ, OB500_GPO1, OB500_GPO1, 1 },
+	{ "write", PIO, OB500, BENCH_WRITE, OB500_GPO1, OB500_GPO1, 1 },
+	{ "read", CDI, TSM70, BENCH_READ, TSM70_LCD_READ, TSM70_LCD_READ, 1 },
+	{ "write", CDI, TSM70, BENCH_WRITE, TSM70_LCD_READ, TSM70_LCD_READ, 1 },
+	{ "block read", CDI, TSM70, BENCH_BLOCK_READ, 0x40, 0x40, 1 },
+	{ "read", SMI, TSM40, BENCH_READ, SMI_GET_LCD_BRIGHTNESS, SMI_SET_LCD_BRIGHTNESS, 1 },
+	{ "write", SMI, TSM40, BENCH_WRITE, SMI_GET_LCD_BRIGHTNESS, SMI_SET_LCD_BRIGHTNESS, 1 },
+	{ "read", &sim_backend, NONE, BENCH_READ, 0x10, 0x10, 1 },
+	{ "write", &sim_backend, NONE, BENCH_WRITE, 0x10, 0x10, 1 },
+	{ "aerial get", ACPI, TSM70, BENCH_AERIAL_GET, 0, 0, 0 },
+	{ "aerial set", ACPI, TSM70, BENCH_AERIAL_SET, 0, 0, 1 },
+	{ "display get", ACPI, TSM70, BENCH_DISPLAY_GET, 0, 0, 0 },
+	{ "throttle get", ACPI, TSM70, BENCH_THROTTLE_GET, 0, 0, 0 },
+	{ "aerial get", ACPI, TSX205, BENCH_AERIAL_GET, 0, 0, 0 },
+	{ "aerial set", ACPI, TSX205, BENCH_AERIAL_SET, 0, 0, 0 },
+	{ "display get", ACPI, TSX205, BENCH_DISPLAY_GET, 0, 0, 0 },
+	{ "hotkeys get", ACPI, TSX205, BENCH_HOTKEYS_GET, 0, 0, 0 },
+	{ "fn key", ACPI, TSX205, BENCH_FNKEY, 0, 0, 0 },
+};
+
+static unsigned int bench_ms = 500;
+static unsigned long bench_max_ops;
+static const char *bench_filter;
+
+static const struct bench_case bench_replay_case = {
+	"replay", &sim_backend, NONE, BENCH_REPLAY, 0, 0, 0
+};
+
+/* Backend calls of the replayed trace, without the SMI and ACPI records */
+static struct omnibook_record *bench_trace;
+static unsigned long bench_trace_count;
+
+struct bench_result {
+	s64 *samples;		/* ns */
+	unsigned long count;
+	unsigned long size;
+	unsigned long errors;
+	int mismatch;
+	s64 elapsed;		/* ns */
+	unsigned long io;	/* port accesses */
+	unsigned long smi;	/* SMIs */
+	unsigned long acpi;	/* ACPI method evaluations */
+};
+
+static int bench_cmp(const void *a, const void *b)
+{
+	s64 x = *(const s64 *) a;
+	s64 y = *(const s64 *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int bench_add(struct bench_result *res, s64 ns)
+{
+	s64 *samples;
+
+	if (res->count == res->size) {
+		res->size = res->size ? 2 * res->size : 1024;
+		samples = realloc(res->samples, res->size * sizeof(s64));
+		if (!samples)
+			return -ENOMEM;
+		res->samples = samples;
+	}
+	res->samples[res->count++] = ns;
+	return 0;
+}
+
+/* Radio state written by the i-th aerial set */
+static unsigned int bench_aerial(unsigned long i)
+{
+	return (i & 1) ? 0 : WIFI_STA | BT_STA;
+}
+
+/*
+ * The Fn key path as acpi.c runs it: the input hook sees the scancode and
+ * schedules the work which evaluates the ACPI methods and reports the key
+ */
+static int bench_fnkey(void)
+{
+	struct input_handler *handler = omnibook_sim_input_handler;
+	struct input_handle handle = { .handler = handler };
+
+	if (!handler)
+		return -ENODEV;
+	handle.private = handler->private;
+	handler->event(&handle, EV_MSC, MSC_SCAN, ACPI_FN_SCAN);
+	flush_scheduled_work();
+	return 0;
+}
+
+/*
+ * Issue a recorded call, an error only if it does not fail as recorded
+ */
+static int bench_replay(struct omnibook_operation *io_op, unsigned long i)
+{
+	const struct omnibook_record *rec = &bench_trace[i % bench_trace_count];
+	u8 buf[256];
+	unsigned int state = 0;
+	int len = min_t(int, rec->value, sizeof(buf));
+	int retval;
+	u8 data;
+
+	io_op->read_addr = io_op->write_addr = rec->addr;
+	switch (rec->type) {
+	case OMNIBOOK_REC_READ:
+		retval = backend_byte_read(io_op, &data);
+		break;
+	case OMNIBOOK_REC_WRITE:
+		retval = backend_byte_write(io_op, rec->value);
+		break;
+	case OMNIBOOK_REC_BLOCK_READ:
+		retval = backend_block_read(io_op, rec->addr, buf, len);
+		break;
+	case OMNIBOOK_REC_BLOCK_WRITE:
+		memset(buf, 0, len);
+		retval = backend_block_write(io_op, rec->addr, buf, len);
+		break;
+	case OMNIBOOK_REC_AERIAL_GET:
+		retval = backend_aerial_get(io_op, &state);
+		break;
+	case OMNIBOOK_REC_AERIAL_SET:
+		retval = backend_aerial_set(io_op, rec->value);
+		break;
+	case OMNIBOOK_REC_HOTKEYS_GET:
+		retval = backend_hotkeys_get(io_op, &state);
+		break;
+	case OMNIBOOK_REC_HOTKEYS_SET:
+		retval = backend_hotkeys_set(io_op, rec->value);
+		break;
+	case OMNIBOOK_REC_DISPLAY_GET:
+		retval = backend_display_get(io_op, &state);
+		break;
+	case OMNIBOOK_REC_DISPLAY_SET:
+		retval = backend_display_set(io_op, rec->value);
+		break;
+	case OMNIBOOK_REC_THROTTLE_GET:
+		retval = backend_throttle_get(io_op, &state);
+		break;
+	case OMNIBOOK_REC_THROTTLE_SET:
+		retval = backend_throttle_set(io_op, rec->value);
+		break;
+	default:
+		return -EINVAL;
+	}
+	return (retval < 0) != (rec->retval < 0);
+}
+
+static int bench_one(struct omnibook_operation *io_op, enum bench_op op, unsigned long i)
+{
+	u8 buf[BENCH_BLOCK_LEN];
+	unsigned int state = 0;
+	int retval;
+	u8 data;
+
+	switch (op) {
+	case BENCH_READ:
+		return backend_byte_read(io_op, &data);
+	case BENCH_WRITE:
+		return backend_byte_write(io_op, i & 0xff);
+	case BENCH_BLOCK_READ:
+		return backend_block_read(io_op, io_op->read_addr, buf, BENCH_BLOCK_LEN);
+	case BENCH_AERIAL_GET:
+		return backend_aerial_get(io_op, &state);
+	case BENCH_AERIAL_SET:
+		return backend_aerial_set(io_op, bench_aerial(i));
+	case BENCH_DISPLAY_GET:
+		/* Returns the supported displays */
+		retval = backend_display_get(io_op, &state);
+		return retval < 0 ? retval : 0;
+	case BENCH_HOTKEYS_GET:
+		return backend_hotkeys_get(io_op, &state);
+	case BENCH_THROTTLE_GET:
+		return backend_throttle_get(io_op, &state);
+	case BENCH_FNKEY:
+		return bench_fnkey();
+	case BENCH_REPLAY:
+		return bench_replay(io_op, i);
+	}
+	return -EINVAL;
+}
+
+/* Returns 0 if the backend reads back what the i-th write wrote */
+static int bench_check(struct omnibook_operation *io_op, enum bench_op op, unsigned long i)
+{
+	unsigned int state;
+	u8 data;
+
+	switch (op) {
+	case BENCH_WRITE:
+		return backend_byte_read(io_op, &data) || data != (i & 0xff);
+	case BENCH_AERIAL_SET:
+		return backend_aerial_get(io_op, &state) ||
+		       (state & (WIFI_STA | BT_STA)) != bench_aerial(i);
+	default:
+		return 0;
+	}
+}
+
+static unsigned long bench_io(void)
+{
+	unsigned long io = 0;
+	int i;
+
+	for (i = 0; i < OMNIBOOK_SIM_DEVS; i++) {
+		if (i != OMNIBOOK_SIM_SMI && i != OMNIBOOK_SIM_ACPI)
+			io += omnibook_sim_io[i].in + omnibook_sim_io[i].out;
+	}
+	return io;
+}
+
+static int bench_run(const struct bench_case *bc, struct bench_result *res)
+{
+	struct omnibook_operation io_op = {
+		bc->backend, bc->read_addr, bc->write_addr, 0, 0, 0, "bench"
+	};
+	ktime_t start, end, t;
+	unsigned long i, io;
+	int retval;
+
+	omnibook_ectype = bc->ectype;
+	if (bc->backend->init && (retval = bc->backend->init(&io_op)))
+		return retval;
+
+	io = bench_io();
+	res->smi = omnibook_sim_io[OMNIBOOK_SIM_SMI].out;
+	res->acpi = omnibook_sim_io[OMNIBOOK_SIM_ACPI].out;
+	start = ktime_get();
+	end = start + (s64) bench_ms * NSEC_PER_MSEC;
+	for (i = 0; !bench_max_ops || i < bench_max_ops; i++) {
+		t = ktime_get();
+		if (t >= end)
+			break;
+		if (bench_one(&io_op, bc->op, i))
+			res->errors++;
+		retval = bench_add(res, ktime_get() - t);
+		if (retval)
+			goto out;
+	}
+	res->elapsed = ktime_get() - start;
+	res->io = bench_io() - io;
+	res->smi = omnibook_sim_io[OMNIBOOK_SIM_SMI].out - res->smi;
+	res->acpi = omnibook_sim_io[OMNIBOOK_SIM_ACPI].out - res->acpi;
+
+	if (bc->readable && i && bench_check(&io_op, bc->op, i - 1))
+		res->mismatch = 1;
+
+      out:
+	if (bc->backend->exit)
+		bc->backend->exit(&io_op);
+	return retval;
+}
+
+static const char *bench_ectype(enum omnibook_ectype_t ectype)
+{
+	switch (ectype) {
+	case XE3GF:
+		return "XE3GF";
+	case OB500:
+		return "OB500";
+	case TSM70:
+		return "TSM70";
+	case TSM40:
+		return "TSM40";
+	case TSX205:
+		return "TSX205";
+	default:
+		return "-";
+	}
+}
+
+static void bench_report(const struct bench_case *bc, struct bench_result *res)
+{
+	s64 total = 0;
+	unsigned long i;
+
+	qsort(res->samples, res->count, sizeof(s64), bench_cmp);
+	for (i = 0; i < res->count; i++)
+		total += res->samples[i];
+
+	printf("%-7s %-12s %-6s %8lu %10.0f %9.1f %9.1f %9.1f %9.1f %6.1f %5.2f %5.2f %6lu%s\n",
+	       bc->backend->name, bc->name, bench_ectype(bc->ectype), res->count,
+	       res->elapsed ? res->count * (double) NSEC_PER_SEC / res->elapsed : 0,
+	       total / (double) res->count / NSEC_PER_USEC,
+	       res->samples[res->count / 2] / (double) NSEC_PER_USEC,
+	       res->samples[(res->count * 99 + 99) / 100 - 1] / (double) NSEC_PER_USEC,
+	       res->samples[res->count - 1] / (double) NSEC_PER_USEC,
+	       res->io / (double) res->count, res->smi / (double) res->count,
+	       res->acpi / (double) res->count,
+	       res->errors, res->mismatch ? "  read back MISMATCH" : "");
+}
+
+/*
+ * Save the trace of the run
+ */
+static int bench_save(const char *path)
+{
+	const struct omnibook_record_header *hdr;
+	size_t len;
+	FILE *f;
+	int retval = 0;
+
+	hdr = omnibook_record_snapshot(&len);
+	if (!hdr)
+		return -ENOMEM;
+	f = fopen(path, "wb");
+	if (!f || fwrite(hdr, len, 1, f) != 1)
+		retval = -errno;
+	if (f && fclose(f) && !retval)
+		retval = -errno;
+	if (!retval)
+		printf("recorded %u calls to %s, %u dropped\n", hdr->count, path, hdr->dropped);
+	vfree((void *) hdr);
+	return retval;
+}
+
+/*
+ * Load a trace in the simulated backend and keep its backend calls
+ */
+static int bench_load(const char *path)
+{
+	const struct omnibook_record_header *hdr;
+	const struct omnibook_record *rec;
+	char *trace = NULL;
+	size_t len = 0, n;
+	s64 total = 0;
+	FILE *f;
+	int retval;
+	u32 i;
+
+	f = fopen(path, "rb");
+	if (!f)
+		return -errno;
+	do {
+		trace = realloc(trace, len + 65536);
+		if (!trace) {
+			fclose(f);
+			return -ENOMEM;
+		}
+		n = fread(trace + len, 1, 65536, f);
+		len += n;
+	} while (n);
+	fclose(f);
+
+	retval = omnibook_sim_replay_load(trace, len);
+	if (retval)
+		goto out;
+
+	hdr = (const struct omnibook_record_header *) trace;
+	rec = (const struct omnibook_record *) (hdr + 1);
+	bench_trace = calloc(hdr->count, sizeof(struct omnibook_record));
+	if (!bench_trace) {
+		retval = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < hdr->count; i++) {
+		if (rec[i].type >= OMNIBOOK_REC_SMI)
+			continue;
+		bench_trace[bench_trace_count++] = rec[i];
+		total += rec[i].duration;
+	}
+	if (!bench_trace_count) {
+		retval = -ENODATA;
+		goto out;
+	}
+	printf("replaying %lu backend calls of %u records from %s, recorded mean %.1f us\n",
+	       bench_trace_count, hdr->count, path,
+	       total / (double) bench_trace_count / NSEC_PER_USEC);
+      out:
+	free(trace);
+	return retval;
+}
+
+static void bench_usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-t ms] [-n ops] [-b backend] [-w trace] [-r trace] [-s ectype] [-v]\n"
+		"       [name=value ...]\n"
+		"  -t ms       time spent on each case (default %u)\n"
+		"  -n ops      stop a case after that many operations\n"
+		"  -b backend  only run the cases of that backend\n"
+		"  -w trace    record the backend calls of the run to the trace file\n"
+		"  -r trace    replay the backend calls of the trace file instead\n"
+		"  -s ectype   run the stall benchmark over the features of ectype instead,\n"
+		"              reading each one -n times (default 100)\n"
+		"  -v          show all kernel messages\n"
+		"simulated hardware timings (ns):\n", prog, bench_ms);
+	omnibook_sim_params_show(stderr);
+}
+
+/*
+ * Stall benchmark over the features of ectype n, as the module numbers it
+ */
+static int bench_stall(unsigned int n, unsigned int reads)
+{
+	struct file file;
+	char buf[4096];
+	loff_t pos = 0;
+	ssize_t len;
+	int retval;
+
+	if (n < 1 || n > 16)
+		return -EINVAL;
+	omnibook_sim_reset();
+	omnibook_ec_shadow_invalidate();
+	omnibook_ectype = 1 << (n - 1);
+	retval = omnibook_sim_features_load(1);
+	if (retval)
+		return retval;
+
+	retval = omnibook_stall_run(reads, 0);
+	if (!retval)
+		retval = single_open(&file, omnibook_stall_show, NULL);
+	if (!retval) {
+		while ((len = seq_read(&file, buf, sizeof(buf), &pos)) > 0)
+			fwrite(buf, 1, len, stdout);
+		single_release(NULL, &file);
+	}
+
+	omnibook_sim_features_unload();
+	return retval;
+}
+
+static int bench_case(const struct bench_case *bc)
+{
+	struct bench_result res;
+	int failed = 0;
+	int retval;
+
+	memset(&res, 0, sizeof(res));
+	retval = bench_run(bc, &res);
+	if (retval) {
+		printf("%-7s %-12s %-6s failed: %s\n", bc->backend->name, bc->name,
+		       bench_ectype(bc->ectype), strerror(-retval));
+		failed = 1;
+	} else if (res.count) {
+		bench_report(bc, &res);
+		if (res.errors || res.mismatch)
+			failed = 1;
+	}
+	free(res.samples);
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	const char *record = NULL;
+	const char *replay = NULL;
+	unsigned int stall = 0;
+	int failed = 0;
+	int retval;
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "t:n:b:w:r:s:vh")) != -1) {
+		switch (opt) {
+		case 't':
+			bench_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			bench_max_ops = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			bench_filter = optarg;
+			break;
+		case 'w':
+			record = optarg;
+			break;
+		case 'r':
+			replay = optarg;
+			break;
+		case 's':
+			stall = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			omnibook_sim_loglevel = 7;
+			break;
+		default:
+			bench_usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+	for (i = optind; i < argc; i++) {
+		if (omnibook_sim_param(argv[i])) {
+			fprintf(stderr, "%s: bad timing %s\n", argv[0], argv[i]);
+			bench_usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (omnibook_sim_setup()) {
+		fprintf(stderr, "%s: setup failed\n", argv[0]);
+		return 1;
+	}
+
+	if (record && (retval = omnibook_record_start(1 << 20))) {
+		fprintf(stderr, "%s: cannot record: %s\n", argv[0], strerror(-retval));
+		return 1;
+	}
+	if (replay && (retval = bench_load(replay))) {
+		fprintf(stderr, "%s: cannot replay %s: %s\n", argv[0], replay, strerror(-retval));
+		return 1;
+	}
+
+	if (stall) {
+		retval = bench_stall(stall, bench_max_ops ? bench_max_ops : 100);
+		if (retval)
+			fprintf(stderr, "%s: stall benchmark failed: %s\n", argv[0], strerror(-retval));
+		omnibook_sim_cleanup();
+		return !!retval;
+	}
+
+	printf("%-7s %-12s %-6s %8s %10s %9s %9s %9s %9s %6s %5s %5s %6s\n", "backend",
+	       "operation", "ectype", "ops", "ops/s", "mean us", "p50 us", "p99 us", "max us",
+	       "io/op", "smi", "acpi", "errors");
+	if (replay)
+		failed = bench_case(&bench_replay_case);
+	for (i = 0; !replay && i < ARRAY_SIZE(bench_cases); i++) {
+		if (bench_filter && strcmp(bench_filter, bench_cases[i].backend->name))
+			continue;
+		failed |= bench_case(&bench_cases[i]);
+	}
+
+	if (record && (retval = bench_save(record))) {
+		fprintf(stderr, "%s: cannot save %s: %s\n", argv[0], record, strerror(-retval));
+		failed = 1;
+	}
+	omnibook_sim_cleanup();
+	return failed;
+}
+
+/* End of file */
@@ -0,0 +1,425 @@
+/*
+ * budget.c -- hardware operations spent by the features, checked against
+ *             a budget
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <unistd.h>
+
+#include "omnibook.h"
+#include "hardware.h"
+#include "sim.h"
+
+/*
+ * For every EC type all features are loaded, then each one is read and
+ * written once as through its procfs file. The port accesses, SMIs and
+ * ACPI evaluations of each step are compared to the budget file: going
+ * over budget, or a step missing from it, is a failure. Counts do not
+ * depend on timing as the simulated hardware answers at once here.
+ *
+ * Battery 0 is present where the EC tells so. It is read again after
+ * the other steps: its design registers are served from the EC shadow
+ * this time, so the reread step is budgeted below the read one and a
+ * shadow miss shows up as over budget.
+ *
+ * With -u the budget file is rewritten from the counts instead.
+ */
+
+/* What is written to each feature, a valid and harmless request */
+static const struct {
+	const char *feature;
+	const char *value;
+} budget_writes[] = {
+	{ "blank", "1" },
+	{ "bluetooth", "1" },
+	{ "cooling", "1" },
+	{ "display", "1" },
+	{ "dock", "1" },
+	{ "dump", "0x10 0x20" },
+	{ "fan", "1" },
+	{ "fan_policy", "0" },
+	{ "hotkeys", "on" },
+	{ "key_polling", "1" },
+	{ "lcd", "5" },
+	{ "muteled", "1" },
+	{ "throttling", "3" },
+	{ "touchpad", "1" },
+	{ "wifi", "1" },
+};
+
+static const char *budget_ectypes[] = {
+	"XE3GF", "XE3GC", "OB500", "OB510", "OB6000", "OB6100", "XE4500", "OB4150",
+	"XE2", "AMILOD", "TSP10", "TSM70", "TSM40", "TSA105", "TSM30X", "TSX205",
+};
+
+struct budget_count {
+	unsigned long io;	/* port accesses */
+	unsigned long smi;	/* SMIs */
+	unsigned long acpi;	/* ACPI method evaluations */
+};
+
+struct budget_entry {
+	char ectype[8];
+	char feature[16];
+	char op[8];
+	struct budget_count count;
+	int seen;		/* step run this time */
+};
+
+static struct budget_entry *budget;
+static unsigned int budget_size;
+static unsigned int budget_count;
+
+static int budget_verbose;
+
+static void budget_now(struct budget_count *c)
+{
+	int i;
+
+	c->io = 0;
+	for (i = 0; i < OMNIBOOK_SIM_DEVS; i++) {
+		if (i != OMNIBOOK_SIM_SMI && i != OMNIBOOK_SIM_ACPI)
+			c->io += omnibook_sim_io[i].in + omnibook_sim_io[i].out;
+	}
+	c->smi = omnibook_sim_io[OMNIBOOK_SIM_SMI].out;
+	c->acpi = omnibook_sim_io[OMNIBOOK_SIM_ACPI].out;
+}
+
+static struct budget_entry *budget_find(const char *ectype, const char *feature, const char *op)
+{
+	unsigned int i;
+
+	for (i = 0; i < budget_count; i++) {
+		if (!strcmp(budget[i].ectype, ectype) && !strcmp(budget[i].feature, feature) &&
+		    !strcmp(budget[i].op, op))
+			return &budget[i];
+	}
+	return NULL;
+}
+
+static struct budget_entry *budget_add(const char *ectype, const char *feature, const char *op)
+{
+	struct budget_entry *e;
+
+	if (budget_count == budget_size) {
+		budget_size = budget_size ? 2 * budget_size : 256;
+		e = realloc(budget, budget_size * sizeof(struct budget_entry));
+		if (!e)
+			return NULL;
+		budget = e;
+	}
+	e = &budget[budget_count++];
+	memset(e, 0, sizeof(*e));
+	snprintf(e->ectype, sizeof(e->ectype), "%s", ectype);
+	snprintf(e->feature, sizeof(e->feature), "%s", feature);
+	snprintf(e->op, sizeof(e->op), "%s", op);
+	return e;
+}
+
+static int budget_load(const char *path)
+{
+	struct budget_entry *e;
+	char line[256], ectype[8], feature[16], op[8];
+	struct budget_count c;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f)
+		return errno == ENOENT ? 0 : -errno;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%7s %15s %7s %lu %lu %lu", ectype, feature, op, &c.io, &c.smi,
+			   &c.acpi) != 6) {
+			fprintf(stderr, "%s: bad line: %s", path, line);
+			fclose(f);
+			return -EINVAL;
+		}
+		e = budget_add(ectype, feature, op);
+		if (!e) {
+			fclose(f);
+			return -ENOMEM;
+		}
+		e->count = c;
+	}
+	fclose(f);
+	return 0;
+}
+
+static int budget_save(const char *path)
+{
+	unsigned int i;
+	FILE *f;
+
+	f = fopen(path, "w");
+	if (!f)
+		return -errno;
+	fprintf(f, "# Hardware operations per feature step under the simulated hardware,\n"
+		"# checked by make budget (sim/budget.c). Regenerate with make budget-update\n"
+		"# once an increase is justified.\n"
+		"#\n# %-6s %-12s %-6s %6s %4s %4s\n", "ectype", "feature", "step", "io", "smi",
+		"acpi");
+	for (i = 0; i < budget_count; i++) {
+		if (!budget[i].seen)
+			continue;
+		fprintf(f, "%-8s %-12s %-6s %6lu %4lu %4lu\n", budget[i].ectype,
+			budget[i].feature, budget[i].op, budget[i].count.io, budget[i].count.smi,
+			budget[i].count.acpi);
+	}
+	return fclose(f) ? -errno : 0;
+}
+
+/*
+ * Account a step: update the budget, or check it. Returns 1 if over budget.
+ */
+static int budget_step(const char *ectype, const char *feature, const char *op,
+		       const struct budget_count *before, int update)
+{
+	struct budget_count now, c;
+	struct budget_entry *e;
+
+	budget_now(&now);
+	c.io = now.io - before->io;
+	c.smi = now.smi - before->smi;
+	c.acpi = now.acpi - before->acpi;
+
+	if (budget_verbose)
+		printf("%-8s %-12s %-6s %6lu %4lu %4lu\n", ectype, feature, op, c.io, c.smi, c.acpi);
+
+	e = budget_find(ectype, feature, op);
+	if (!e) {
+		e = budget_add(ectype, feature, op);
+		if (!e)
+			return 1;
+		e->seen = 1;
+		e->count = c;
+		if (update)
+			return 0;
+		printf("%s %s %s: not in budget (%lu io, %lu smi, %lu acpi)\n", ectype, feature,
+		       op, c.io, c.smi, c.acpi);
+		return 1;
+	}
+
+	e->seen = 1;
+	if (update) {
+		e->count = c;
+		return 0;
+	}
+	if (c.io > e->count.io || c.smi > e->count.smi || c.acpi > e->count.acpi) {
+		printf("%s %s %s: OVER budget, %lu/%lu io, %lu/%lu smi, %lu/%lu acpi\n", ectype,
+		       feature, op, c.io, e->count.io, c.smi, e->count.smi, c.acpi,
+		       e->count.acpi);
+		return 1;
+	}
+	if (c.io < e->count.io || c.smi < e->count.smi || c.acpi < e->count.acpi)
+		printf("%s %s %s: below budget, %lu/%lu io, %lu/%lu smi, %lu/%lu acpi\n",
+		       ectype, feature, op, c.io, e->count.io, c.smi, e->count.smi, c.acpi,
+		       e->count.acpi);
+	return 0;
+}
+
+static const char *budget_write_value(const char *feature)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(budget_writes); i++) {
+		if (!strcmp(budget_writes[i].feature, feature))
+			return budget_writes[i].value;
+	}
+	return NULL;
+}
+
+/*
+ * Insert battery 0, with a design capacity so that the XE3GC and AMILOD
+ * gauge is computed
+ */
+static void budget_battery(void)
+{
+	u8 *ram = omnibook_sim_ec_ram();
+
+	if (omnibook_ectype & (XE3GF | TSP10 | TSM70 | TSM30X)) {
+		ram[XE3GF_BAL] |= XE3GF_BAL0_MASK;
+		ram[XE3GF_BDC0 + 1] = 0x10;
+	} else if (omnibook_ectype & XE3GC) {
+		ram[XE3GC_BAT] |= XE3GC_BAT0_MASK;
+		ram[XE3GC_BDC0 + 1] = 0x10;
+	} else if (omnibook_ectype & AMILOD) {
+		ram[AMILOD_BAT] |= AMILOD_BAT0_MASK;
+		ram[AMILOD_BDC0 + 1] = 0x10;
+	}
+}
+
+/*
+ * Load, read and write every feature of an EC type, then take a snapshot
+ */
+static int budget_ectype(int n, int update)
+{
+	const char *ectype = budget_ectypes[n];
+	struct omnibook_feature *feature;
+	struct budget_count before;
+	static char page[PAGE_SIZE];
+	struct seq_file m = { .buf = page, .size = sizeof(page) };
+	struct omnibook_telemetry t;
+	const char *value;
+	char buf[64];
+	int failed = 0;
+	int retval;
+
+	omnibook_sim_reset();
+	omnibook_ec_shadow_invalidate();
+	omnibook_ectype = 1 << n;
+	budget_battery();
+
+	budget_now(&before);
+	retval = omnibook_sim_features_load(1);
+	if (retval)
+		return retval;
+	failed |= budget_step(ectype, "-", "load", &before, update);
+
+	list_for_each_entry(feature, &omnibook_sim_features, list) {
+		if (feature->read) {
+			budget_now(&before);
+			m.count = 0;
+			retval = feature->read(&m, feature->io_op);
+			if (retval < 0 && budget_verbose)
+				printf("%s %s read failed: %s\n", ectype, feature->name,
+				       strerror(-retval));
+			failed |= budget_step(ectype, feature->name, "read", &before, update);
+		}
+		if (feature->write) {
+			value = budget_write_value(feature->name);
+			if (!value) {
+				printf("%s %s: nothing to write, see budget_writes\n", ectype,
+				       feature->name);
+				failed = 1;
+				continue;
+			}
+			/* Writes may modify the buffer, as procfs ones do */
+			snprintf(buf, sizeof(buf), "%s", value);
+			budget_now(&before);
+			retval = feature->write(buf, feature->io_op);
+			if (retval < 0 && budget_verbose)
+				printf("%s %s write failed: %s\n", ectype, feature->name,
+				       strerror(-retval));
+			failed |= budget_step(ectype, feature->name, "write", &before, update);
+		}
+	}
+
+	feature = omnibook_find_feature("battery");
+	if (feature && feature->read) {
+		budget_now(&before);
+		m.count = 0;
+		feature->read(&m, feature->io_op);
+		failed |= budget_step(ectype, feature->name, "reread", &before, update);
+	}
+
+	/* One snapshot reads every feature it covers, see telemetry.c */
+	budget_now(&before);
+	retval = omnibook_telemetry_snapshot(&t);
+	if (retval < 0 && budget_verbose)
+		printf("%s telemetry failed: %s\n", ectype, strerror(-retval));
+	failed |= budget_step(ectype, "telemetry", "read", &before, update);
+
+	omnibook_sim_features_unload();
+	return failed;
+}
+
+static void budget_usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-u] [-v] budget\n"
+		"  -u  rewrite the budget file from this run\n"
+		"  -v  show every step and all kernel messages\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path;
+	int update = 0;
+	int failed = 0;
+	unsigned int i;
+	int retval;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "uvh")) != -1) {
+		switch (opt) {
+		case 'u':
+			update = 1;
+			break;
+		case 'v':
+			budget_verbose = 1;
+			omnibook_sim_loglevel = 7;
+			break;
+		default:
+			budget_usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+	if (optind != argc - 1) {
+		budget_usage(argv[0]);
+		return 2;
+	}
+	path = argv[optind];
+
+	if ((retval = budget_load(path))) {
+		fprintf(stderr, "%s: cannot read %s: %s\n", argv[0], path, strerror(-retval));
+		return 1;
+	}
+
+	/* Hardware answering at once: counts must not depend on timing */
+	omnibook_sim.io_ns = 0;
+	omnibook_sim.ec_ibf_ns = 0;
+	omnibook_sim.ec_obf_ns = 0;
+	omnibook_sim.ec_burst_ns = 0;
+	omnibook_sim.kbc_ibf_ns = 0;
+	omnibook_sim.cdi_ns = 0;
+	omnibook_sim.smi_ns = 0;
+	omnibook_sim.acpi_ns = 0;
+
+	if (omnibook_sim_setup()) {
+		fprintf(stderr, "%s: setup failed\n", argv[0]);
+		return 1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(budget_ectypes); i++) {
+		retval = budget_ectype(i, update);
+		if (retval < 0) {
+			fprintf(stderr, "%s: %s: %s\n", argv[0], budget_ectypes[i],
+				strerror(-retval));
+			failed = 1;
+		} else if (retval)
+			failed = 1;
+	}
+
+	for (i = 0; !update && i < budget_count; i++) {
+		if (!budget[i].seen)
+			printf("%s %s %s: in budget but not run\n", budget[i].ectype,
+			       budget[i].feature, budget[i].op);
+	}
+
+	omnibook_sim_cleanup();
+
+	if (update) {
+		if ((retval = budget_save(path))) {
+			fprintf(stderr, "%s: cannot write %s: %s\n", argv[0], path,
+				strerror(-retval));
+			return 1;
+		}
+		printf("%s updated, %u steps\n", path, budget_count);
+		return 0;
+	}
+	if (!failed)
+		printf("%u steps within budget\n", budget_count);
+	return failed;
+}
+
+/* End of file */
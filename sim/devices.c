@@ -0,0 +1,736 @@
+/*
+ * devices.c -- simulated devices behind the I/O ports used by the backends
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook_sim.h"
+#include "sim.h"
+
+/*
+ * Simulated hardware:
+ * - the ACPI style embedded controller at 0x62/0x66 (ec.c)
+ * - the i8042 keyboard controller at 0x60/0x64 (kbc.c)
+ * - GPIO latches of the OmniBook 500/510 (pio.c)
+ * - the LPC bridge and the Compal Command/Data/Index interface it decodes
+ *   (compal.c)
+ * - the ACPI methods, in acpica.c (acpi.c)
+ * - the CMOS buffer at RTC_PORT(2)/(3), the SMI port with a Toshiba SMI
+ *   handler, GPE0_EN and the SMSC mailbox at 0x300 (nbsmi.c)
+ *
+ * Busy flags clear with the delays of omnibook_sim, against the real
+ * clock: a backend polling too early sees the device busy, as it would on
+ * a laptop. Every port access costs io_ns and is serialized.
+ */
+
+struct omnibook_sim_params omnibook_sim = {
+	.io_ns = 1000,
+	.ec_ibf_ns = 5000,
+	.ec_obf_ns = 10000,
+	.ec_burst_ns = 1000,
+	.kbc_ibf_ns = 20000,
+	.cdi_ns = 20000,
+	.smi_ns = 100000,
+	.acpi_ns = 100000,
+	.lpc_device = PCI_DEVICE_ID_INTEL_ICH7_0,
+};
+
+static const struct {
+	const char *name;
+	unsigned long *value;
+	const char *desc;
+} omnibook_sim_param_table[] = {
+	{ "io_ns", &omnibook_sim.io_ns, "duration of a port access" },
+	{ "ec_ibf_ns", &omnibook_sim.ec_ibf_ns, "EC input buffer latency" },
+	{ "ec_obf_ns", &omnibook_sim.ec_obf_ns, "EC output buffer latency" },
+	{ "ec_burst_ns", &omnibook_sim.ec_burst_ns, "EC buffer latency in burst mode" },
+	{ "ec_no_burst", &omnibook_sim.ec_no_burst, "EC refuses burst mode" },
+	{ "kbc_ibf_ns", &omnibook_sim.kbc_ibf_ns, "i8042 input buffer latency" },
+	{ "cdi_ns", &omnibook_sim.cdi_ns, "CDI command latency" },
+	{ "smi_ns", &omnibook_sim.smi_ns, "time spent in SMM per SMI" },
+	{ "acpi_ns", &omnibook_sim.acpi_ns, "evaluation of an ACPI method" },
+	{ "lpc_device", &omnibook_sim.lpc_device, "PCI device id of the LPC bridge, 0x4377 for ATI" },
+};
+
+struct omnibook_sim_io omnibook_sim_io[OMNIBOOK_SIM_DEVS];
+
+const char *omnibook_sim_dev_name[OMNIBOOK_SIM_DEVS] = {
+	[OMNIBOOK_SIM_EC] = "ec",
+	[OMNIBOOK_SIM_KBC] = "i8042",
+	[OMNIBOOK_SIM_CDI] = "cdi",
+	[OMNIBOOK_SIM_CMOS] = "cmos",
+	[OMNIBOOK_SIM_SMI] = "smi",
+	[OMNIBOOK_SIM_GPE] = "gpe",
+	[OMNIBOOK_SIM_MAILBOX] = "mailbox",
+	[OMNIBOOK_SIM_GPIO] = "gpio",
+	[OMNIBOOK_SIM_UNCLAIMED] = "unclaimed",
+	[OMNIBOOK_SIM_ACPI] = "acpi",
+};
+
+static pthread_mutex_t omnibook_sim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Embedded controller
+ */
+
+#define EC_DATA			0x62
+#define EC_SC			0x66
+#define EC_STAT_OBF		0x01
+#define EC_STAT_IBF		0x02
+#define EC_STAT_BURST		0x10
+#define EC_CMD_READ		0x80
+#define EC_CMD_WRITE		0x81
+#define EC_CMD_BURST_ENABLE	0x82
+#define EC_CMD_BURST_DISABLE	0x83
+#define EC_BURST_ACK		0x90
+
+static struct {
+	enum {
+		EC_IDLE,
+		EC_READ_ADDR,		/* read command received, waiting for the address */
+		EC_WRITE_ADDR,		/* write command received, waiting for the address */
+		EC_WRITE_DATA,		/* waiting for the byte to write */
+	} phase;
+	u8 addr;
+	int burst;
+	ktime_t ibf_until;		/* input buffer full until then */
+	ktime_t obf_at;			/* output buffer full from then, 0 if empty */
+	u8 obf_data;
+	u8 ram[256];
+} ec;
+
+static unsigned long ec_delay(unsigned long normal)
+{
+	return ec.burst ? omnibook_sim.ec_burst_ns : normal;
+}
+
+static u8 ec_status(ktime_t now)
+{
+	u8 status = 0;
+
+	if (now < ec.ibf_until)
+		status |= EC_STAT_IBF;
+	if (ec.obf_at && now >= ec.obf_at)
+		status |= EC_STAT_OBF;
+	if (ec.burst)
+		status |= EC_STAT_BURST;
+	return status;
+}
+
+static void ec_answer(ktime_t now, u8 data)
+{
+	ec.obf_data = data;
+	ec.obf_at = ec.ibf_until + ec_delay(omnibook_sim.ec_obf_ns);
+}
+
+static void ec_command(ktime_t now, u8 cmd)
+{
+	ec.ibf_until = now + ec_delay(omnibook_sim.ec_ibf_ns);
+	switch (cmd) {
+	case EC_CMD_READ:
+		ec.phase = EC_READ_ADDR;
+		break;
+	case EC_CMD_WRITE:
+		ec.phase = EC_WRITE_ADDR;
+		break;
+	case EC_CMD_BURST_ENABLE:
+		ec.phase = EC_IDLE;
+		if (omnibook_sim.ec_no_burst) {
+			ec_answer(now, 0);
+			break;
+		}
+		ec_answer(now, EC_BURST_ACK);
+		ec.burst = 1;
+		break;
+	case EC_CMD_BURST_DISABLE:
+		ec.phase = EC_IDLE;
+		ec.burst = 0;
+		break;
+	default:
+		printk(KERN_WARNING "sim: unknown EC command 0x%02x\n", cmd);
+		ec.phase = EC_IDLE;
+	}
+}
+
+static void ec_data(ktime_t now, u8 data)
+{
+	ec.ibf_until = now + ec_delay(omnibook_sim.ec_ibf_ns);
+	switch (ec.phase) {
+	case EC_READ_ADDR:
+		ec_answer(now, ec.ram[data]);
+		ec.phase = EC_IDLE;
+		break;
+	case EC_WRITE_ADDR:
+		ec.addr = data;
+		ec.phase = EC_WRITE_DATA;
+		break;
+	case EC_WRITE_DATA:
+		ec.ram[ec.addr] = data;
+		ec.phase = EC_IDLE;
+		break;
+	default:
+		printk(KERN_WARNING "sim: EC data 0x%02x without command\n", data);
+	}
+}
+
+static u8 ec_read_data(ktime_t now)
+{
+	if (!ec.obf_at || now < ec.obf_at)
+		printk(KERN_WARNING "sim: EC data read with empty output buffer\n");
+	ec.obf_at = 0;
+	return ec.obf_data;
+}
+
+/*
+ * Keyboard controller: only commands matter, it never answers
+ */
+
+#define KBC_DATA		0x60
+#define KBC_SC			0x64
+#define KBC_STAT_IBF		0x02
+
+static struct {
+	ktime_t ibf_until;
+	u8 cmd;
+	u8 data;
+} kbc;
+
+static void kbc_write(ktime_t now, unsigned long port, u8 value)
+{
+	if (now < kbc.ibf_until)
+		printk(KERN_WARNING "sim: i8042 written with full input buffer\n");
+	kbc.ibf_until = now + omnibook_sim.kbc_ibf_ns;
+	if (port == KBC_SC)
+		kbc.cmd = value;
+	else
+		kbc.data = value;
+}
+
+/*
+ * GPIO latches of the OmniBook 500/510 chipsets
+ */
+
+static const unsigned long gpio_port[] = { 0x8034, 0x11b9, 0x118f };
+static u8 gpio_latch[ARRAY_SIZE(gpio_port)];
+
+static u8 *gpio_find(unsigned long port)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(gpio_port); i++) {
+		if (gpio_port[i] == port)
+			return &gpio_latch[i];
+	}
+	return NULL;
+}
+
+/*
+ * LPC bridge, Intel ICH or ATI IXP depending on lpc_device
+ */
+
+#define PCI_DEVICE_ID_ATI_SB400	0x4377
+#define INTEL_PMBASE		0x40
+#define INTEL_LPC_GEN1_DEC	0x84
+#define INTEL_LPC_GEN4_DEC	0x90
+#define ATI_LPC_REG		0x4a
+#define PMBASE			0x1000
+#define GPE0_EN			(PMBASE + 0x2c)
+
+static struct pci_dev lpc_bridge;
+static u32 gpe0_en;
+
+static int lpc_is_ati(void)
+{
+	return omnibook_sim.lpc_device == PCI_DEVICE_ID_ATI_SB400;
+}
+
+static int lpc_is_gen4(void)
+{
+	switch (omnibook_sim.lpc_device) {
+	case PCI_DEVICE_ID_INTEL_ICH7_0:
+	case PCI_DEVICE_ID_INTEL_ICH7_1:
+	case PCI_DEVICE_ID_INTEL_ICH7_30:
+	case PCI_DEVICE_ID_INTEL_ICH7_31:
+	case PCI_DEVICE_ID_INTEL_ICH8_4:
+		return 1;
+	}
+	return 0;
+}
+
+static u32 lpc_config_dword(int where)
+{
+	u32 val;
+
+	memcpy(&val, &lpc_bridge.config[where], sizeof(val));
+	return val;
+}
+
+static void lpc_reset(void)
+{
+	u32 pmbase = PMBASE | 1;
+
+	memset(&lpc_bridge, 0, sizeof(lpc_bridge));
+	lpc_bridge.vendor = lpc_is_ati() ? PCI_VENDOR_ID_ATI : PCI_VENDOR_ID_INTEL;
+	lpc_bridge.device = omnibook_sim.lpc_device;
+	if (!lpc_is_ati())
+		memcpy(&lpc_bridge.config[INTEL_PMBASE], &pmbase, sizeof(pmbase));
+	gpe0_en = 0xffff;
+}
+
+struct pci_dev *pci_get_device(unsigned int vendor, unsigned int device, struct pci_dev *from)
+{
+	if (from || vendor != lpc_bridge.vendor || device != lpc_bridge.device)
+		return NULL;
+	return &lpc_bridge;
+}
+
+int pci_enable_device(struct pci_dev *dev)
+{
+	return 0;
+}
+
+void pci_dev_put(struct pci_dev *dev)
+{
+}
+
+int pci_read_config_word(struct pci_dev *dev, int where, u16 *val)
+{
+	memcpy(val, &dev->config[where], sizeof(*val));
+	return 0;
+}
+
+int pci_read_config_dword(struct pci_dev *dev, int where, u32 *val)
+{
+	memcpy(val, &dev->config[where], sizeof(*val));
+	return 0;
+}
+
+int pci_write_config_word(struct pci_dev *dev, int where, u16 val)
+{
+	memcpy(&dev->config[where], &val, sizeof(val));
+	return 0;
+}
+
+int pci_write_config_dword(struct pci_dev *dev, int where, u32 val)
+{
+	memcpy(&dev->config[where], &val, sizeof(val));
+	return 0;
+}
+
+/*
+ * Compal Command/Data/Index interface, decoded once enabled in the LPC
+ * bridge. The command ports latch the last value written, the conventional
+ * idle state is 0xf432. Commands 0xfbfd (select index) and 0xfbfe (write
+ * index) are executed when the mode flag 0xfbfc is set to 1, the flag then
+ * reads 2 once done.
+ */
+
+#define CDI_COMMAND1		0x1
+#define CDI_COMMAND2		0x2
+#define CDI_DATA		0x3
+
+static struct {
+	u8 cmd1, cmd2;
+	u8 flag;
+	ktime_t done_at;		/* flag turns from 1 to 2 then */
+	u16 pending_cmd;		/* command to run when flag is set to 1 */
+	u8 pending_code;
+	u8 index;
+	u8 value[256];
+} cdi;
+
+static unsigned long cdi_base(void)
+{
+	return lpc_is_ati() ? 0xfd60 : 0xff2c;
+}
+
+static int cdi_decoded(void)
+{
+	if (lpc_is_ati())
+		return lpc_config_dword(ATI_LPC_REG) & (0x80 << 16);
+	if (lpc_is_gen4())
+		return lpc_config_dword(INTEL_LPC_GEN4_DEC) & 1;
+	return lpc_bridge.config[INTEL_LPC_GEN1_DEC] & 1;
+}
+
+static u8 cdi_flag(ktime_t now)
+{
+	if (cdi.flag == 1 && now >= cdi.done_at)
+		cdi.flag = 2;
+	return cdi.flag;
+}
+
+static u8 cdi_read(ktime_t now, unsigned long reg)
+{
+	switch (reg) {
+	case CDI_COMMAND1:
+		return cdi.cmd1;
+	case CDI_COMMAND2:
+		return cdi.cmd2;
+	}
+	switch (cdi.cmd1 << 8 | cdi.cmd2) {
+	case 0xfbfc:
+		return cdi_flag(now);
+	case 0xfbfe:
+		return cdi.value[cdi.index];
+	}
+	return 0xff;
+}
+
+static void cdi_write(ktime_t now, unsigned long reg, u8 value)
+{
+	u16 cmd;
+
+	switch (reg) {
+	case CDI_COMMAND1:
+		cdi.cmd1 = value;
+		return;
+	case CDI_COMMAND2:
+		cdi.cmd2 = value;
+		return;
+	}
+	cmd = cdi.cmd1 << 8 | cdi.cmd2;
+	if (cmd != 0xfbfc) {
+		cdi.pending_cmd = cmd;
+		cdi.pending_code = value;
+		return;
+	}
+	cdi.flag = value;
+	if (value != 1)
+		return;
+	switch (cdi.pending_cmd) {
+	case 0xfbfd:
+		cdi.index = cdi.pending_code;
+		break;
+	case 0xfbfe:
+		cdi.value[cdi.index] = cdi.pending_code;
+		break;
+	}
+	cdi.pending_cmd = 0;
+	cdi.done_at = now + omnibook_sim.cdi_ns;
+}
+
+/*
+ * CMOS buffer, SMI handler and SMSC mailbox of the Toshiba laptops
+ * The SMI handler takes its argument from the CMOS buffer and answers
+ * there, set functions store the byte read back by their get counterpart.
+ */
+
+#define CMOS_INDEX		RTC_PORT(2)
+#define CMOS_DATA		RTC_PORT(3)
+#define SMI_BUFFER_SIZE		0x20
+#define MAILBOX_INDEX		0x300
+#define MAILBOX_DATA		0x301
+
+static u8 cmos[256];
+static u8 cmos_index;
+static u8 mailbox[256];
+static u8 mailbox_index;
+static u8 smi_state[256];
+
+static const struct {
+	u8 set;
+	u8 get;
+} smi_pairs[] = {
+	{ 0xa2, 0xa3 },		/* LCD brightness */
+	{ 0xa5, 0xa6 },		/* aerial */
+	{ 0xa7, 0xa8 },		/* display state */
+	{ 0xa9, 0xaa },		/* Fn interface */
+	{ 0xac, 0xad },		/* dock */
+	{ 0xc2, 0xc2 },		/* Fn+F5 interface, write only */
+};
+
+static const u8 smi_get_only[] = {
+	0xa4,			/* kill switch */
+	0xab,			/* last Fn scancode */
+};
+
+static void smi_reset(void)
+{
+	memset(smi_state, 0, sizeof(smi_state));
+	smi_state[0xa3] = 3;	/* brightness */
+	smi_state[0xa4] = 1;	/* radios on */
+	smi_state[0xa6] = 0x4 | 0x8 | 0x1;	/* wifi present and on, bluetooth present */
+	smi_state[0xaa] = 0x1;	/* Fn keys on */
+}
+
+/* Returns eax: 0 on success */
+static u32 smi_handler(u8 function)
+{
+	u8 *buf = &cmos[lpc_is_ati() ? 0xe0 : 0x60];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(smi_pairs); i++) {
+		if (smi_pairs[i].set == function) {
+			smi_state[smi_pairs[i].get] = buf[0];
+			return 0;
+		}
+		if (smi_pairs[i].get == function) {
+			buf[0] = smi_state[function];
+			return 0;
+		}
+	}
+	for (i = 0; i < ARRAY_SIZE(smi_get_only); i++) {
+		if (smi_get_only[i] == function) {
+			buf[0] = smi_state[function];
+			return 0;
+		}
+	}
+	return 0xe400 | function;
+}
+
+u32 omnibook_sim_smi(u16 function, unsigned long port)
+{
+	u32 eax;
+
+	pthread_mutex_lock(&omnibook_sim_lock);
+	omnibook_sim_io[OMNIBOOK_SIM_SMI].out++;
+	if (port != (lpc_is_ati() ? 0xb0 : 0xb2) || (function & 0xff) != 0xe4) {
+		printk(KERN_WARNING "sim: unexpected SMI 0x%04x on port 0x%lx\n", function, port);
+		eax = function;
+		goto out;
+	}
+	/* The whole machine stops while in SMM */
+	ndelay(omnibook_sim.smi_ns);
+	eax = smi_handler(function >> 8);
+      out:
+	pthread_mutex_unlock(&omnibook_sim_lock);
+	return eax;
+}
+
+/*
+ * Port dispatch
+ */
+
+static enum omnibook_sim_dev port_dev(unsigned long port)
+{
+	switch (port) {
+	case EC_DATA:
+	case EC_SC:
+		return OMNIBOOK_SIM_EC;
+	case KBC_DATA:
+	case KBC_SC:
+		return OMNIBOOK_SIM_KBC;
+	case CMOS_INDEX:
+	case CMOS_DATA:
+		return OMNIBOOK_SIM_CMOS;
+	case MAILBOX_INDEX:
+	case MAILBOX_DATA:
+		return OMNIBOOK_SIM_MAILBOX;
+	}
+	if (gpio_find(port))
+		return OMNIBOOK_SIM_GPIO;
+	if (cdi_decoded() && port > cdi_base() && port <= cdi_base() + CDI_DATA)
+		return OMNIBOOK_SIM_CDI;
+	return OMNIBOOK_SIM_UNCLAIMED;
+}
+
+u8 inb(unsigned long port)
+{
+	enum omnibook_sim_dev dev;
+	ktime_t now;
+	u8 value = 0xff;
+
+	pthread_mutex_lock(&omnibook_sim_lock);
+	ndelay(omnibook_sim.io_ns);
+	now = ktime_get();
+	dev = port_dev(port);
+	omnibook_sim_io[dev].in++;
+	switch (dev) {
+	case OMNIBOOK_SIM_EC:
+		value = port == EC_SC ? ec_status(now) : ec_read_data(now);
+		break;
+	case OMNIBOOK_SIM_KBC:
+		value = port == KBC_SC ? (now < kbc.ibf_until ? KBC_STAT_IBF : 0) : 0;
+		break;
+	case OMNIBOOK_SIM_CMOS:
+		value = port == CMOS_DATA ? cmos[cmos_index] : cmos_index;
+		break;
+	case OMNIBOOK_SIM_MAILBOX:
+		value = port == MAILBOX_DATA ? mailbox[mailbox_index] : mailbox_index;
+		break;
+	case OMNIBOOK_SIM_GPIO:
+		value = *gpio_find(port);
+		break;
+	case OMNIBOOK_SIM_CDI:
+		value = cdi_read(now, port - cdi_base());
+		break;
+	default:
+		break;
+	}
+	pthread_mutex_unlock(&omnibook_sim_lock);
+	return value;
+}
+
+void outb(u8 value, unsigned long port)
+{
+	enum omnibook_sim_dev dev;
+	ktime_t now;
+
+	pthread_mutex_lock(&omnibook_sim_lock);
+	ndelay(omnibook_sim.io_ns);
+	now = ktime_get();
+	dev = port_dev(port);
+	omnibook_sim_io[dev].out++;
+	switch (dev) {
+	case OMNIBOOK_SIM_EC:
+		if (now < ec.ibf_until)
+			printk(KERN_WARNING "sim: EC written with full input buffer\n");
+		if (port == EC_SC)
+			ec_command(now, value);
+		else
+			ec_data(now, value);
+		break;
+	case OMNIBOOK_SIM_KBC:
+		kbc_write(now, port, value);
+		break;
+	case OMNIBOOK_SIM_CMOS:
+		if (port == CMOS_DATA)
+			cmos[cmos_index] = value;
+		else
+			cmos_index = value;
+		break;
+	case OMNIBOOK_SIM_MAILBOX:
+		if (port == MAILBOX_DATA)
+			mailbox[mailbox_index] = value;
+		else
+			mailbox_index = value;
+		break;
+	case OMNIBOOK_SIM_GPIO:
+		*gpio_find(port) = value;
+		break;
+	case OMNIBOOK_SIM_CDI:
+		cdi_write(now, port - cdi_base(), value);
+		break;
+	default:
+		break;
+	}
+	pthread_mutex_unlock(&omnibook_sim_lock);
+}
+
+u16 inw(unsigned long port)
+{
+	return inb(port) | inb(port + 1) << 8;
+}
+
+void outw(u16 value, unsigned long port)
+{
+	outb(value & 0xff, port);
+	outb(value >> 8, port + 1);
+}
+
+u32 inl(unsigned long port)
+{
+	u32 value;
+
+	if (port != GPE0_EN || lpc_is_ati())
+		return inw(port) | (u32) inw(port + 2) << 16;
+
+	pthread_mutex_lock(&omnibook_sim_lock);
+	ndelay(omnibook_sim.io_ns);
+	omnibook_sim_io[OMNIBOOK_SIM_GPE].in++;
+	value = gpe0_en;
+	pthread_mutex_unlock(&omnibook_sim_lock);
+	return value;
+}
+
+void outl(u32 value, unsigned long port)
+{
+	if (port != GPE0_EN || lpc_is_ati()) {
+		outw(value & 0xffff, port);
+		outw(value >> 16, port + 2);
+		return;
+	}
+
+	pthread_mutex_lock(&omnibook_sim_lock);
+	ndelay(omnibook_sim.io_ns);
+	omnibook_sim_io[OMNIBOOK_SIM_GPE].out++;
+	gpe0_en = value;
+	pthread_mutex_unlock(&omnibook_sim_lock);
+}
+
+/*
+ * Power-on state of all devices, also applies lpc_device
+ */
+void omnibook_sim_reset(void)
+{
+	pthread_mutex_lock(&omnibook_sim_lock);
+	memset(&ec, 0, sizeof(ec));
+	memset(&kbc, 0, sizeof(kbc));
+	memset(gpio_latch, 0, sizeof(gpio_latch));
+	memset(&cdi, 0, sizeof(cdi));
+	cdi.cmd1 = 0xf4;
+	cdi.cmd2 = 0x32;
+	memset(cmos, 0, sizeof(cmos));
+	memset(mailbox, 0, sizeof(mailbox));
+	cmos_index = mailbox_index = 0;
+	smi_reset();
+	lpc_reset();
+	memset(omnibook_sim_io, 0, sizeof(omnibook_sim_io));
+	pthread_mutex_unlock(&omnibook_sim_lock);
+	omnibook_sim_acpi_reset();
+}
+
+u8 *omnibook_sim_ec_ram(void)
+{
+	return ec.ram;
+}
+
+u8 *omnibook_sim_cdi_index(void)
+{
+	return cdi.value;
+}
+
+u8 *omnibook_sim_smi_state(void)
+{
+	return smi_state;
+}
+
+/*
+ * Set a timing from a name=value argument, or program ACPI methods from
+ * an acpi:<method>=... one, returns 0 if arg is one
+ */
+int omnibook_sim_param(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	char *end;
+	unsigned long value;
+	int i;
+
+	if (!strncmp(arg, "acpi:", 5))
+		return omnibook_sim_acpi_param(arg + 5);
+	if (!eq)
+		return -EINVAL;
+	for (i = 0; i < ARRAY_SIZE(omnibook_sim_param_table); i++) {
+		if (strlen(omnibook_sim_param_table[i].name) != eq - arg ||
+		    strncmp(omnibook_sim_param_table[i].name, arg, eq - arg))
+			continue;
+		value = strtoul(eq + 1, &end, 0);
+		if (end == eq + 1 || *end)
+			return -EINVAL;
+		*omnibook_sim_param_table[i].value = value;
+		return 0;
+	}
+	return -ENOENT;
+}
+
+void omnibook_sim_params_show(FILE *out)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(omnibook_sim_param_table); i++)
+		fprintf(out, "  %-12s %-10lu %s\n", omnibook_sim_param_table[i].name,
+			*omnibook_sim_param_table[i].value, omnibook_sim_param_table[i].desc);
+	fprintf(out, "ACPI methods, matched on the end of their path:\n"
+		"  acpi:<method>=<value>[/<ns>], acpi:<method>=/<ns> or acpi:<method>=fail\n");
+}
+
+/* End of file */
@@ -0,0 +1,1030 @@
+/*
+ * omnibook_sim.h -- user-space stand-in for the kernel API used by the
+ *                   backends
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Every <linux/...> and <asm/...> header included by the backends is
+ * generated by sim/Makefile and only includes this file. Locks map to
+ * pthreads, time to CLOCK_MONOTONIC, port I/O to the simulated devices of
+ * devices.c, everything else to the bare minimum in kernel.c.
+ * Only what the files built by sim/Makefile use is provided.
+ */
+
+#ifndef _OMNIBOOK_SIM_H
+#define _OMNIBOOK_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/types.h>
+#include <poll.h>
+
+/*
+ * Kernel version and configuration the sources are built for
+ */
+
+#define KERNEL_VERSION(a,b,c)	(((a) << 16) + ((b) << 8) + (c))
+#define LINUX_VERSION_CODE	KERNEL_VERSION(2,6,36)
+
+#define ERESTARTSYS	512
+
+/*
+ * Types
+ */
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef u8 __u8;
+typedef u16 __u16;
+typedef u32 __u32;
+typedef u64 __u64;
+typedef s32 __s32;
+typedef unsigned int gfp_t;
+typedef s64 ktime_t;		/* ns */
+
+#define GFP_KERNEL	0
+#define GFP_ATOMIC	1
+
+#define PAGE_SIZE	4096
+#define PAGE_SHIFT	12
+
+#define S_IRUGO		0444
+#define S_IWUSR		0200
+#define S_IRUSR		0400
+
+/*
+ * Compiler and module boilerplate
+ */
+
+#define __init
+#define __exit
+#define __initdata
+#define __exitdata
+#define __user
+#define __percpu
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+
+struct module;
+struct kernel_param;
+#define THIS_MODULE		((struct module *) NULL)
+#define EXPORT_SYMBOL(sym)
+#define module_param_named(name, value, type, perm)
+#define MODULE_PARM_DESC(name, desc)
+
+#define KERN_ERR		"<3>"
+#define KERN_WARNING		"<4>"
+#define KERN_INFO		"<6>"
+#define KERN_DEBUG		"<7>"
+
+int printk(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+void omnibook_sim_bug(const char *file, int line) __attribute__((noreturn));
+#define BUG()			omnibook_sim_bug(__FILE__, __LINE__)
+#define BUG_ON(cond)		do { if (unlikely(cond)) BUG(); } while (0)
+#define WARN_ON(cond) \
+({ \
+	int __ret = !!(cond); \
+	if (unlikely(__ret)) \
+		printk(KERN_WARNING "WARNING at %s:%d\n", __FILE__, __LINE__); \
+	__ret; \
+})
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define max(a, b)		((a) > (b) ? (a) : (b))
+#define min_t(type, a, b)	min((type) (a), (type) (b))
+#define max_t(type, a, b)	max((type) (a), (type) (b))
+#define clamp_t(type, val, lo, hi)	min_t(type, max_t(type, val, lo), hi)
+#define BIT(nr)			(1UL << (nr))
+#define BITS_PER_LONG		(8 * sizeof(long))
+
+#define IS_ERR(ptr)		((unsigned long) (ptr) >= (unsigned long) -4095)
+#define PTR_ERR(ptr)		((long) (ptr))
+#define ERR_PTR(err)		((void *) (long) (err))
+
+static inline int fls(unsigned int x)
+{
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+
+static inline void set_bit(int nr, volatile unsigned long *addr)
+{
+	__atomic_or_fetch(&addr[nr / BITS_PER_LONG], 1UL << (nr % BITS_PER_LONG),
+			  __ATOMIC_SEQ_CST);
+}
+
+#define do_div(n, base) \
+({ \
+	u32 __rem = (u64) (n) % (base); \
+	(n) = (u64) (n) / (base); \
+	__rem; \
+})
+
+void sort(void *base, size_t num, size_t size, int (*cmp)(const void *, const void *),
+	  void (*swap)(void *, void *, int));
+
+/*
+ * Memory
+ */
+
+#define kmalloc(size, flags)		malloc(size)
+#define kzalloc(size, flags)		calloc(1, size)
+#define kcalloc(n, size, flags)		calloc(n, size)
+#define kfree(ptr)			free((void *) (ptr))
+#define vmalloc(size)			malloc(size)
+#define vfree(ptr)			free((void *) (ptr))
+#define get_zeroed_page(flags)		((unsigned long) calloc(1, PAGE_SIZE))
+#define free_page(addr)			free((void *) (addr))
+
+/* Pages are never mapped: the mmap handlers are built, not run */
+struct page;
+struct vm_area_struct;
+
+typedef struct {
+	unsigned long pgprot;
+} pgprot_t;
+
+struct vm_operations_struct {
+	void (*open)(struct vm_area_struct *);
+	void (*close)(struct vm_area_struct *);
+};
+
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_flags;
+	unsigned long vm_pgoff;
+	pgprot_t vm_page_prot;
+	const struct vm_operations_struct *vm_ops;
+};
+
+#define VM_WRITE		0x2
+#define VM_MAYWRITE		0x20
+
+#define virt_to_phys(addr)		((unsigned long) (addr))
+#define virt_to_page(addr)		((struct page *) (addr))
+#define SetPageReserved(page)		do { } while (0)
+#define ClearPageReserved(page)		do { } while (0)
+#define remap_pfn_range(vma, addr, pfn, size, prot)	(-ENODEV)
+
+/*
+ * Barriers, interrupts, preemption and per-cpu data: the simulation
+ * behaves as a single CPU whose interrupts are never masked
+ */
+
+#define barrier()		__asm__ __volatile__("" : : : "memory")
+#define smp_mb()		__sync_synchronize()
+#define smp_rmb()		__sync_synchronize()
+#define smp_wmb()		__sync_synchronize()
+
+#define local_irq_save(flags)	do { (flags) = 0; } while (0)
+#define local_irq_restore(flags)	do { (void) (flags); } while (0)
+#define preempt_disable()	barrier()
+#define preempt_enable_no_resched()	barrier()
+
+#define get_cpu()		0
+#define put_cpu()		barrier()
+#define for_each_possible_cpu(cpu)	for ((cpu) = 0; (cpu) < 1; (cpu)++)
+#define alloc_percpu(type)	((type *) calloc(1, sizeof(type)))
+#define free_percpu(ptr)	free(ptr)
+#define per_cpu_ptr(ptr, cpu)	(ptr)
+
+/*
+ * Locking
+ */
+
+typedef struct {
+	int locked;
+} spinlock_t;
+
+#define DEFINE_SPINLOCK(x)	spinlock_t x = { 0 }
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+	lock->locked = 0;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+	while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(&lock->locked, __ATOMIC_RELAXED))
+			;
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+	__atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+#define spin_lock_irq(lock)			spin_lock(lock)
+#define spin_unlock_irq(lock)			spin_unlock(lock)
+#define spin_lock_irqsave(lock, flags)		do { (flags) = 0; spin_lock(lock); } while (0)
+#define spin_unlock_irqrestore(lock, flags)	do { (void) (flags); spin_unlock(lock); } while (0)
+
+/* A zeroed pthread mutex is an unlocked one, as for static kernel mutexes */
+struct mutex {
+	pthread_mutex_t lock;
+	int locked;
+};
+
+#define DEFINE_MUTEX(x)		struct mutex x = { PTHREAD_MUTEX_INITIALIZER, 0 }
+
+static inline void mutex_init(struct mutex *m)
+{
+	pthread_mutex_init(&m->lock, NULL);
+	m->locked = 0;
+}
+
+static inline void mutex_destroy(struct mutex *m)
+{
+}
+
+static inline void mutex_lock(struct mutex *m)
+{
+	pthread_mutex_lock(&m->lock);
+	m->locked = 1;
+}
+
+static inline int mutex_lock_interruptible(struct mutex *m)
+{
+	mutex_lock(m);
+	return 0;
+}
+
+static inline int mutex_trylock(struct mutex *m)
+{
+	if (pthread_mutex_trylock(&m->lock))
+		return 0;
+	m->locked = 1;
+	return 1;
+}
+
+static inline void mutex_unlock(struct mutex *m)
+{
+	m->locked = 0;
+	pthread_mutex_unlock(&m->lock);
+}
+
+static inline int mutex_is_locked(struct mutex *m)
+{
+	return m->locked;
+}
+
+struct kref {
+	int refcount;
+};
+
+static inline void kref_init(struct kref *kref)
+{
+	__atomic_store_n(&kref->refcount, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline void kref_get(struct kref *kref)
+{
+	__atomic_add_fetch(&kref->refcount, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline int kref_put(struct kref *kref, void (*release)(struct kref *kref))
+{
+	if (__atomic_sub_fetch(&kref->refcount, 1, __ATOMIC_SEQ_CST))
+		return 0;
+	release(kref);
+	return 1;
+}
+
+/*
+ * Lists
+ */
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name)	{ &(name), &(name) }
+#define LIST_HEAD(name)		struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev,
+			      struct list_head *next)
+{
+	next->prev = new;
+	new->next = next;
+	new->prev = prev;
+	prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head->prev, head);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+static inline void list_splice_init(struct list_head *list, struct list_head *head)
+{
+	if (list_empty(list))
+		return;
+	list->next->prev = head;
+	list->prev->next = head->next;
+	head->next->prev = list->prev;
+	head->next = list->next;
+	INIT_LIST_HEAD(list);
+}
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_entry((head)->next, typeof(*pos), member); \
+	     &pos->member != (head); \
+	     pos = list_entry(pos->member.next, typeof(*pos), member))
+
+#define list_for_each_entry_safe(pos, n, head, member) \
+	for (pos = list_entry((head)->next, typeof(*pos), member), \
+	     n = list_entry(pos->member.next, typeof(*pos), member); \
+	     &pos->member != (head); \
+	     pos = n, n = list_entry(n->member.next, typeof(*n), member))
+
+/*
+ * Time: jiffies tick at HZ over CLOCK_MONOTONIC, delays busy-wait as
+ * they do in the kernel, sleeps sleep.
+ */
+
+#define HZ			1000
+#define NSEC_PER_USEC		1000L
+#define NSEC_PER_MSEC		1000000L
+#define USEC_PER_MSEC		1000L
+#define NSEC_PER_SEC		1000000000L
+
+ktime_t ktime_get(void);
+unsigned long omnibook_sim_jiffies(void);
+#define jiffies			omnibook_sim_jiffies()
+
+#define ktime_sub(a, b)		((a) - (b))
+#define ktime_to_ns(kt)		((s64) (kt))
+#define ktime_to_us(kt)		((s64) (kt) / NSEC_PER_USEC)
+
+#define time_after(a, b)	((long) ((b) - (a)) < 0)
+#define time_before(a, b)	time_after(b, a)
+
+#define msecs_to_jiffies(ms)	((unsigned long) (ms))
+#define usecs_to_jiffies(us)	(((unsigned long) (us) + 999) / 1000)
+#define jiffies_to_msecs(j)	((unsigned int) (j))
+
+void ndelay(unsigned long nsecs);
+#define udelay(usecs)		ndelay((usecs) * NSEC_PER_USEC)
+#define mdelay(msecs)		ndelay((msecs) * NSEC_PER_MSEC)
+void usleep_range(unsigned long min, unsigned long max);
+void msleep(unsigned int msecs);
+
+/*
+ * Wait queues and completions
+ */
+
+typedef struct {
+	int unused;
+} wait_queue_head_t;
+
+#define DECLARE_WAIT_QUEUE_HEAD(name)	wait_queue_head_t name = { 0 }
+#define init_waitqueue_head(wq)		do { (void) (wq); } while (0)
+#define wake_up(wq)			do { (void) (wq); } while (0)
+#define wake_up_interruptible(wq)	wake_up(wq)
+
+/* Never interrupted: a signal is not delivered to the harness threads */
+#define wait_event_interruptible(wq, condition) \
+({ \
+	(void) &(wq); \
+	while (!(condition)) \
+		usleep_range(10, 20); \
+	0; \
+})
+
+/* Nothing wakes us up: poll the condition between short sleeps */
+#define wait_event_timeout(wq, condition, timeout) \
+({ \
+	unsigned long __end = jiffies + (timeout); \
+	long __ret = 0; \
+	(void) &(wq); \
+	for (;;) { \
+		if (condition) { \
+			__ret = max_t(long, (long) (__end - jiffies), 1); \
+			break; \
+		} \
+		if (time_after(jiffies, __end)) \
+			break; \
+		usleep_range(10, 20); \
+	} \
+	__ret; \
+})
+
+struct completion {
+	pthread_mutex_t lock;
+	pthread_cond_t wait;
+	unsigned int done;
+};
+
+void init_completion(struct completion *x);
+void complete(struct completion *x);
+void wait_for_completion(struct completion *x);
+
+/*
+ * Workqueues: one thread per queue, the shared one included
+ */
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	struct list_head entry;
+	work_func_t func;
+	int pending;
+};
+
+#define INIT_WORK(work, f) \
+do { \
+	INIT_LIST_HEAD(&(work)->entry); \
+	(work)->func = (f); \
+	(work)->pending = 0; \
+} while (0)
+
+struct workqueue_struct;
+
+struct workqueue_struct *create_singlethread_workqueue(const char *name);
+void destroy_workqueue(struct workqueue_struct *wq);
+int queue_work(struct workqueue_struct *wq, struct work_struct *work);
+int schedule_work(struct work_struct *work);
+void flush_scheduled_work(void);
+void flush_workqueue(struct workqueue_struct *wq);
+
+#define DECLARE_WORK(n, f) \
+	struct work_struct n = { LIST_HEAD_INIT((n).entry), (f), 0 }
+
+/*
+ * Delayed works: there is no timer in the harness, they are never run so
+ * that periodic pollers do not add I/O behind the harness back
+ */
+
+struct timer_list {
+	unsigned long expires;
+};
+
+struct delayed_work {
+	struct work_struct work;
+	struct timer_list timer;
+};
+
+#define DECLARE_DELAYED_WORK(n, f) \
+	struct delayed_work n = { { LIST_HEAD_INIT((n).work.entry), (f), 0 }, { 0 } }
+
+static inline int queue_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork,
+				     unsigned long delay)
+{
+	if (dwork->work.pending)
+		return 0;
+	dwork->work.pending = 1;
+	dwork->timer.expires = jiffies + delay;
+	return 1;
+}
+
+#define schedule_delayed_work(dwork, delay)	queue_delayed_work(NULL, dwork, delay)
+
+static inline int cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+	int pending = dwork->work.pending;
+
+	dwork->work.pending = 0;
+	return pending;
+}
+
+/*
+ * Kernel threads and high resolution timers over pthreads. Threads are
+ * not bound to a CPU nor scheduled by priority: the harness has no
+ * interrupt to mask, latencies measured here are those of user space.
+ */
+
+#define NR_CPUS			1
+#define cpu_online(cpu)		((cpu) == 0)
+
+#define TASK_RUNNING		0
+#define TASK_INTERRUPTIBLE	1
+#define TASK_UNINTERRUPTIBLE	2
+
+/* SCHED_FIFO and struct sched_param come from sched.h */
+#define MAX_RT_PRIO		100
+
+struct task_struct;
+
+struct task_struct *omnibook_sim_current(void);
+#define current			omnibook_sim_current()
+
+struct task_struct *kthread_create(int (*fn)(void *data), void *data, const char *namefmt, ...);
+#define kthread_bind(task, cpu)	do { (void) (task); (void) (cpu); } while (0)
+int kthread_should_stop(void);
+int kthread_stop(struct task_struct *task);
+int wake_up_process(struct task_struct *task);
+/* Simulated tasks are only freed by kthread_stop */
+#define get_task_struct(task)	do { (void) (task); } while (0)
+#define put_task_struct(task)	do { (void) (task); } while (0)
+void set_current_state(long state);
+#define __set_current_state(state)	set_current_state(state)
+void schedule(void);
+#define cond_resched()		sched_yield()
+
+static inline int omnibook_sim_setscheduler(struct task_struct *task, int policy,
+					    const struct sched_param *param)
+{
+	return 0;
+}
+#define sched_setscheduler(task, policy, param)	omnibook_sim_setscheduler(task, policy, param)
+
+#define ktime_add_ns(kt, ns)	((kt) + (ns))
+
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+
+enum hrtimer_mode {
+	HRTIMER_MODE_ABS,
+	HRTIMER_MODE_REL,
+	HRTIMER_MODE_ABS_PINNED,
+};
+
+/* One thread per timer, sleeping until the timer is armed and expires */
+struct hrtimer {
+	enum hrtimer_restart (*function)(struct hrtimer *timer);
+	ktime_t expires;
+	int armed;
+	int running;		/* function being called */
+	int started;		/* thread created */
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wait;
+};
+
+void hrtimer_init(struct hrtimer *timer, clockid_t clock, enum hrtimer_mode mode);
+int hrtimer_start(struct hrtimer *timer, ktime_t time, enum hrtimer_mode mode);
+int hrtimer_cancel(struct hrtimer *timer);
+
+/*
+ * Port I/O, dispatched to the simulated devices
+ */
+
+u8 inb(unsigned long port);
+u16 inw(unsigned long port);
+u32 inl(unsigned long port);
+void outb(u8 value, unsigned long port);
+void outw(u16 value, unsigned long port);
+void outl(u32 value, unsigned long port);
+
+/* Trigger a Toshiba SMI, returns what the SMI handler leaves in eax */
+u32 omnibook_sim_smi(u16 function, unsigned long port);
+
+#define RTC_PORT(x)		(0x70 + (x))
+
+struct resource {
+	unsigned long start;
+	unsigned long n;
+};
+
+struct resource *request_region(unsigned long start, unsigned long n, const char *name);
+void release_region(unsigned long start, unsigned long n);
+
+/*
+ * Interrupts: there is no interrupt line to hand out
+ */
+
+typedef int irqreturn_t;
+#define IRQ_NONE		0
+#define IRQ_HANDLED		1
+#define IRQF_SHARED		0x80
+
+static inline int request_irq(unsigned int irq, irqreturn_t (*handler)(int, void *),
+			      unsigned long flags, const char *name, void *dev)
+{
+	return -EBUSY;
+}
+
+static inline void free_irq(unsigned int irq, void *dev)
+{
+}
+
+/*
+ * PCI: a single LPC bridge, see devices.c
+ */
+
+#define PCI_ANY_ID			(~0)
+#define PCI_VENDOR_ID_INTEL		0x8086
+#define PCI_VENDOR_ID_ATI		0x1002
+#define PCI_DEVICE_ID_INTEL_82801AA_0	0x2410
+#define PCI_DEVICE_ID_INTEL_82801AB_0	0x2420
+#define PCI_DEVICE_ID_INTEL_82801BA_0	0x2440
+#define PCI_DEVICE_ID_INTEL_82801BA_10	0x244c
+#define PCI_DEVICE_ID_INTEL_82801CA_0	0x2480
+#define PCI_DEVICE_ID_INTEL_82801CA_12	0x248c
+#define PCI_DEVICE_ID_INTEL_82801DB_0	0x24c0
+#define PCI_DEVICE_ID_INTEL_82801DB_12	0x24cc
+#define PCI_DEVICE_ID_INTEL_82801E_0	0x2450
+#define PCI_DEVICE_ID_INTEL_82801EB_0	0x24d0
+#define PCI_DEVICE_ID_INTEL_ESB_1	0x25a1
+#define PCI_DEVICE_ID_INTEL_ICH6_0	0x2640
+#define PCI_DEVICE_ID_INTEL_ICH6_1	0x2641
+#define PCI_DEVICE_ID_INTEL_ICH6_2	0x2642
+#define PCI_DEVICE_ID_INTEL_ICH7_0	0x27b8
+#define PCI_DEVICE_ID_INTEL_ICH7_1	0x27b9
+#define PCI_DEVICE_ID_INTEL_ICH7_30	0x27b0
+#define PCI_DEVICE_ID_INTEL_ICH7_31	0x27bd
+#define PCI_DEVICE_ID_INTEL_ICH8_4	0x2815
+
+struct pci_dev {
+	unsigned short vendor;
+	unsigned short device;
+	u8 config[256];
+};
+
+struct pci_device_id {
+	u32 vendor, device;
+	u32 subvendor, subdevice;
+	u32 class, class_mask;
+	unsigned long driver_data;
+};
+
+struct pci_dev *pci_get_device(unsigned int vendor, unsigned int device, struct pci_dev *from);
+int pci_enable_device(struct pci_dev *dev);
+void pci_dev_put(struct pci_dev *dev);
+int pci_read_config_word(struct pci_dev *dev, int where, u16 *val);
+int pci_read_config_dword(struct pci_dev *dev, int where, u32 *val);
+int pci_write_config_word(struct pci_dev *dev, int where, u16 val);
+int pci_write_config_dword(struct pci_dev *dev, int where, u32 val);
+
+/*
+ * ACPI: the namespace and the AML methods used by acpi.c are stood in
+ * for by acpica.c
+ */
+
+typedef void *acpi_handle;
+typedef u32 acpi_status;
+typedef char *acpi_string;
+
+#define AE_OK			0x0000
+#define AE_ERROR		0x0001
+#define AE_NOT_FOUND		0x0005
+#define AE_BAD_PARAMETER	0x1001
+#define AE_BUFFER_OVERFLOW	0x000B
+
+#define ACPI_TYPE_INTEGER	0x01
+#define ACPI_TYPE_PACKAGE	0x04
+
+union acpi_object {
+	u32 type;
+	struct {
+		u32 type;
+		u64 value;
+	} integer;
+	struct {
+		u32 type;
+		u32 count;
+		union acpi_object *elements;
+	} package;
+};
+
+struct acpi_object_list {
+	u32 count;
+	union acpi_object *pointer;
+};
+
+struct acpi_buffer {
+	size_t length;
+	void *pointer;
+};
+
+extern int acpi_disabled;
+
+acpi_status acpi_get_handle(acpi_handle parent, acpi_string pathname, acpi_handle *ret_handle);
+acpi_status acpi_evaluate_object(acpi_handle handle, acpi_string pathname,
+				 struct acpi_object_list *params, struct acpi_buffer *ret);
+
+struct acpi_device_id {
+	const char id[9];
+	unsigned long driver_data;
+};
+
+struct acpi_device {
+	acpi_handle handle;
+	struct {
+		char device_name[40];
+		char device_class[20];
+	} pnp;
+};
+
+#define acpi_device_name(d)	((d)->pnp.device_name)
+#define acpi_device_class(d)	((d)->pnp.device_class)
+
+struct acpi_driver {
+	const char *name;
+	const char *class;
+	const struct acpi_device_id *ids;
+	struct {
+		int (*add)(struct acpi_device *device);
+		int (*remove)(struct acpi_device *device, int type);
+	} ops;
+};
+
+int acpi_bus_register_driver(struct acpi_driver *driver);
+void acpi_bus_unregister_driver(struct acpi_driver *driver);
+
+/*
+ * Input: devices are accepted and never hear of anything, the last
+ * registered handler is kept so that events can be injected into it
+ */
+
+#define EV_KEY			0x01
+#define EV_MSC			0x04
+#define MSC_SCAN		0x04
+#define BUS_I8042		0x11
+#define BUS_HOST		0x19
+#define KEY_MAX			0x2ff
+#define EV_MAX			0x1f
+
+#define KEY_ESC			1
+#define KEY_F1			59
+#define KEY_F2			60
+#define KEY_F3			61
+#define KEY_F4			62
+#define KEY_F5			63
+#define KEY_F6			64
+#define KEY_F7			65
+#define KEY_F8			66
+#define KEY_F9			67
+#define KEY_SPACE		57
+#define KEY_MUTE		113
+#define KEY_VOLUMEDOWN		114
+#define KEY_VOLUMEUP		115
+#define KEY_SLEEP		142
+#define KEY_PROG1		148
+#define KEY_COFFEE		152
+#define KEY_SUSPEND		205
+#define KEY_BRIGHTNESSDOWN	224
+#define KEY_BRIGHTNESSUP	225
+#define KEY_SWITCHVIDEOMODE	227
+#define KEY_BATTERY		236
+#define KEY_WLAN		238
+#define KEY_ZOOM		0x174
+#define KEY_ZOOMIN		0x1a2
+#define KEY_ZOOMOUT		0x1a3
+#define KEY_ZOOMRESET		0x1a4
+#define KEY_FN			0x1d0
+#define KEY_FN_F1		0x1d2
+#define KEY_FN_F9		0x1da
+
+struct input_id {
+	u16 bustype, vendor, product, version;
+};
+
+struct input_handle;
+
+struct input_dev {
+	const char *name;
+	const char *phys;
+	struct input_id id;
+	unsigned long evbit[EV_MAX / BITS_PER_LONG + 1];
+	unsigned long keybit[KEY_MAX / BITS_PER_LONG + 1];
+	struct input_handle *grab;
+};
+
+#define INPUT_DEVICE_ID_MATCH_EVBIT	0x0010
+
+struct input_device_id {
+	unsigned long flags;
+	unsigned long evbit[EV_MAX / BITS_PER_LONG + 1];
+};
+
+struct input_handler {
+	void *private;
+	void (*event)(struct input_handle *handle, unsigned int type, unsigned int code, int value);
+	int (*connect)(struct input_handler *handler, struct input_dev *dev,
+		       const struct input_device_id *id);
+	void (*disconnect)(struct input_handle *handle);
+	const char *name;
+	const struct input_device_id *id_table;
+};
+
+struct input_handle {
+	void *private;
+	const char *name;
+	struct input_dev *dev;
+	struct input_handler *handler;
+};
+
+#define input_allocate_device()		((struct input_dev *) calloc(1, sizeof(struct input_dev)))
+#define input_free_device(dev)		free(dev)
+#define input_register_device(dev)	0
+#define input_unregister_device(dev)	free(dev)
+extern struct input_handler *omnibook_sim_input_handler;
+
+#define input_register_handler(handler)	(omnibook_sim_input_handler = (handler), 0)
+#define input_unregister_handler(handler)	(omnibook_sim_input_handler = NULL)
+#define input_register_handle(handle)	0
+#define input_unregister_handle(handle)	do { } while (0)
+#define input_open_device(handle)	0
+#define input_close_device(handle)	do { } while (0)
+#define input_report_key(dev, code, value)	do { } while (0)
+#define input_sync(dev)			do { } while (0)
+
+/*
+ * seq_file, enough for single_open users; debugfs itself is left out
+ * (CONFIG_DEBUG_FS is not set) so the files are never created.
+ */
+
+struct inode {
+	void *i_private;
+};
+
+#ifndef O_NONBLOCK
+#define O_NONBLOCK		04000
+#endif
+
+struct poll_table_struct;
+
+struct file {
+	void *private_data;
+	unsigned int f_mode;
+	unsigned int f_flags;
+};
+
+#define FMODE_READ		0x1
+#define FMODE_WRITE		0x2
+
+
+struct file_operations {
+	struct module *owner;
+	int (*open)(struct inode *, struct file *);
+	ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
+	ssize_t (*write)(struct file *, const char __user *, size_t, loff_t *);
+	loff_t (*llseek)(struct file *, loff_t, int);
+	int (*release)(struct inode *, struct file *);
+	long (*unlocked_ioctl)(struct file *, unsigned int, unsigned long);
+	long (*compat_ioctl)(struct file *, unsigned int, unsigned long);
+	int (*mmap)(struct file *, struct vm_area_struct *);
+	unsigned int (*poll)(struct file *, struct poll_table_struct *);
+};
+
+typedef struct poll_table_struct poll_table;
+
+#define poll_wait(file, wq, wait)	do { } while (0)
+#define nonseekable_open(inode, file)	0
+#define no_llseek			NULL
+
+#define _IOC(dir, type, nr, size)	(((dir) << 30) | ((size) << 16) | ((type) << 8) | (nr))
+#define _IOR(type, nr, t)		_IOC(2U, (type), (nr), sizeof(t))
+
+/* Misc devices are accepted and never opened */
+#define MISC_DYNAMIC_MINOR	255
+
+struct miscdevice {
+	int minor;
+	const char *name;
+	const struct file_operations *fops;
+};
+
+static inline int misc_register(struct miscdevice *misc)
+{
+	return 0;
+}
+
+static inline int misc_deregister(struct miscdevice *misc)
+{
+	return 0;
+}
+
+struct seq_file {
+	char *buf;
+	size_t size;
+	size_t count;
+	void *private;
+	int (*show)(struct seq_file *, void *);
+};
+
+int seq_printf(struct seq_file *m, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data);
+int single_release(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char __user *buf, size_t size, loff_t *ppos);
+loff_t seq_lseek(struct file *file, loff_t offset, int whence);
+ssize_t simple_read_from_buffer(void __user *to, size_t count, loff_t *ppos,
+				const void *from, size_t available);
+
+/* User and kernel space are the same here */
+#define copy_from_user(to, from, n)	(memcpy(to, from, n), 0)
+#define copy_to_user(to, from, n)	(memcpy(to, from, n), 0)
+#define simple_strtoul(cp, endp, base)	strtoul(cp, endp, base)
+
+/*
+ * DMI, the harness machine has no identity
+ */
+
+enum dmi_field {
+	DMI_NONE,
+	DMI_BIOS_VENDOR,
+	DMI_BIOS_VERSION,
+	DMI_BIOS_DATE,
+	DMI_SYS_VENDOR,
+	DMI_PRODUCT_NAME,
+	DMI_PRODUCT_VERSION,
+	DMI_PRODUCT_SERIAL,
+	DMI_PRODUCT_UUID,
+	DMI_BOARD_VENDOR,
+	DMI_BOARD_NAME,
+	DMI_BOARD_VERSION,
+};
+
+#define dmi_get_system_info(field)	((const char *) "omnibook-sim")
+
+/* Console blanking hook, see blank.c */
+extern int (*console_blank_hook) (int);
+
+/*
+ * Device attributes: the harness has no sysfs, nothing is created
+ */
+
+struct kobject {
+	const char *name;
+};
+
+struct device {
+	struct kobject kobj;
+};
+
+struct attribute {
+	const char *name;
+	unsigned int mode;
+};
+
+struct device_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr, char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr, const char *buf,
+			 size_t count);
+};
+
+#define __ATTR(_name, _mode, _show, _store) \
+	{ .attr = { .name = #_name, .mode = _mode }, .show = _show, .store = _store }
+
+#define device_create_file(dev, attr)		(-ENODEV)
+#define device_remove_file(dev, attr)		do { (void) (dev); (void) (attr); } while (0)
+#define sysfs_notify(kobj, dir, attr)		do { } while (0)
+
+struct dentry;
+
+static inline void debugfs_remove(struct dentry *dentry)
+{
+}
+
+#endif /* _OMNIBOOK_SIM_H */
@@ -0,0 +1,577 @@
+/*
+ * kernel.c -- user-space implementation of the kernel services used by
+ *             the backends
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <stdarg.h>
+#include <time.h>
+
+#include "omnibook_sim.h"
+#include "sim.h"
+
+/*
+ * Messages at or below this level are printed on stderr
+ */
+int omnibook_sim_loglevel = 4;
+
+int printk(const char *fmt, ...)
+{
+	va_list args;
+	int level = 4;
+	int len;
+
+	if (fmt[0] == '<' && fmt[1] >= '0' && fmt[1] <= '7' && fmt[2] == '>') {
+		level = fmt[1] - '0';
+		fmt += 3;
+	}
+	if (level > omnibook_sim_loglevel)
+		return 0;
+
+	va_start(args, fmt);
+	len = vfprintf(stderr, fmt, args);
+	va_end(args);
+	return len;
+}
+
+void omnibook_sim_bug(const char *file, int line)
+{
+	fprintf(stderr, "BUG at %s:%d\n", file, line);
+	abort();
+}
+
+void sort(void *base, size_t num, size_t size, int (*cmp)(const void *, const void *),
+	  void (*swap)(void *, void *, int))
+{
+	qsort(base, num, size, cmp);
+}
+
+/*
+ * Time
+ */
+
+ktime_t ktime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ktime_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+unsigned long omnibook_sim_jiffies(void)
+{
+	return ktime_get() / (NSEC_PER_SEC / HZ);
+}
+
+void ndelay(unsigned long nsecs)
+{
+	ktime_t end = ktime_get() + nsecs;
+
+	while (ktime_get() < end)
+		;
+}
+
+/*
+ * A user space sleep overshoots by tens of us where an hrtimer is off by
+ * a few, which would hide the timing of a replayed trace: spin below 1 ms.
+ */
+void usleep_range(unsigned long min, unsigned long max)
+{
+	struct timespec ts = { 0, min * NSEC_PER_USEC };
+
+	if (min < USEC_PER_MSEC)
+		ndelay(min * NSEC_PER_USEC);
+	else
+		nanosleep(&ts, NULL);
+}
+
+void msleep(unsigned int msecs)
+{
+	struct timespec ts = { msecs / 1000, (msecs % 1000) * NSEC_PER_MSEC };
+
+	nanosleep(&ts, NULL);
+}
+
+/*
+ * Completions
+ */
+
+void init_completion(struct completion *x)
+{
+	pthread_mutex_init(&x->lock, NULL);
+	pthread_cond_init(&x->wait, NULL);
+	x->done = 0;
+}
+
+void complete(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	x->done++;
+	pthread_cond_signal(&x->wait);
+	pthread_mutex_unlock(&x->lock);
+}
+
+void wait_for_completion(struct completion *x)
+{
+	pthread_mutex_lock(&x->lock);
+	while (!x->done)
+		pthread_cond_wait(&x->wait, &x->lock);
+	x->done--;
+	pthread_mutex_unlock(&x->lock);
+}
+
+/*
+ * Workqueues
+ * A work queued while pending is not queued again, a work queued while
+ * running is run once more, as in the kernel.
+ */
+
+struct workqueue_struct {
+	const char *name;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wait;	/* work queued or dying */
+	pthread_cond_t idle;	/* list empty and nothing running */
+	struct list_head list;
+	int running;
+	int dying;
+};
+
+static void *omnibook_sim_worker(void *data)
+{
+	struct workqueue_struct *wq = data;
+	struct work_struct *work;
+
+	pthread_mutex_lock(&wq->lock);
+	for (;;) {
+		while (list_empty(&wq->list) && !wq->dying)
+			pthread_cond_wait(&wq->wait, &wq->lock);
+		if (list_empty(&wq->list))
+			break;
+		work = list_entry(wq->list.next, struct work_struct, entry);
+		list_del(&work->entry);
+		INIT_LIST_HEAD(&work->entry);
+		work->pending = 0;
+		wq->running = 1;
+		pthread_mutex_unlock(&wq->lock);
+		work->func(work);
+		pthread_mutex_lock(&wq->lock);
+		wq->running = 0;
+		if (list_empty(&wq->list))
+			pthread_cond_broadcast(&wq->idle);
+	}
+	pthread_mutex_unlock(&wq->lock);
+	return NULL;
+}
+
+struct workqueue_struct *create_singlethread_workqueue(const char *name)
+{
+	struct workqueue_struct *wq;
+
+	wq = calloc(1, sizeof(struct workqueue_struct));
+	if (!wq)
+		return NULL;
+	wq->name = name;
+	pthread_mutex_init(&wq->lock, NULL);
+	pthread_cond_init(&wq->wait, NULL);
+	pthread_cond_init(&wq->idle, NULL);
+	INIT_LIST_HEAD(&wq->list);
+	if (pthread_create(&wq->thread, NULL, omnibook_sim_worker, wq)) {
+		free(wq);
+		return NULL;
+	}
+	return wq;
+}
+
+void flush_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->lock);
+	while (!list_empty(&wq->list) || wq->running)
+		pthread_cond_wait(&wq->idle, &wq->lock);
+	pthread_mutex_unlock(&wq->lock);
+}
+
+/* Pending works are run before the thread exits */
+void destroy_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->lock);
+	wq->dying = 1;
+	pthread_cond_signal(&wq->wait);
+	pthread_mutex_unlock(&wq->lock);
+	pthread_join(wq->thread, NULL);
+	free(wq);
+}
+
+int queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	int queued = 0;
+
+	pthread_mutex_lock(&wq->lock);
+	if (!work->pending) {
+		work->pending = 1;
+		list_add_tail(&work->entry, &wq->list);
+		pthread_cond_signal(&wq->wait);
+		queued = 1;
+	}
+	pthread_mutex_unlock(&wq->lock);
+	return queued;
+}
+
+static struct workqueue_struct *omnibook_sim_events;
+static pthread_once_t omnibook_sim_events_once = PTHREAD_ONCE_INIT;
+
+static void omnibook_sim_events_init(void)
+{
+	omnibook_sim_events = create_singlethread_workqueue("events");
+	if (!omnibook_sim_events)
+		BUG();
+}
+
+int schedule_work(struct work_struct *work)
+{
+	pthread_once(&omnibook_sim_events_once, omnibook_sim_events_init);
+	return queue_work(omnibook_sim_events, work);
+}
+
+void flush_scheduled_work(void)
+{
+	if (omnibook_sim_events)
+		flush_workqueue(omnibook_sim_events);
+}
+
+int (*console_blank_hook) (int);
+
+/*
+ * Kernel threads: a task sleeps in schedule() until its state is set
+ * back to running by wake_up_process()
+ */
+
+struct task_struct {
+	int (*fn)(void *data);
+	void *data;
+	long state;
+	int started;
+	int should_stop;
+	int retval;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wait;
+};
+
+static __thread struct task_struct *omnibook_sim_task;
+static struct task_struct omnibook_sim_main_task = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wait = PTHREAD_COND_INITIALIZER,
+};
+
+struct task_struct *omnibook_sim_current(void)
+{
+	return omnibook_sim_task ? omnibook_sim_task : &omnibook_sim_main_task;
+}
+
+static void *omnibook_sim_kthread(void *data)
+{
+	struct task_struct *task = data;
+
+	omnibook_sim_task = task;
+	task->retval = task->fn(task->data);
+	return NULL;
+}
+
+struct task_struct *kthread_create(int (*fn)(void *data), void *data, const char *namefmt, ...)
+{
+	struct task_struct *task;
+
+	task = calloc(1, sizeof(struct task_struct));
+	if (!task)
+		return ERR_PTR(-ENOMEM);
+	task->fn = fn;
+	task->data = data;
+	task->state = TASK_UNINTERRUPTIBLE;
+	pthread_mutex_init(&task->lock, NULL);
+	pthread_cond_init(&task->wait, NULL);
+	return task;
+}
+
+int wake_up_process(struct task_struct *task)
+{
+	int woken;
+
+	pthread_mutex_lock(&task->lock);
+	woken = task->state != TASK_RUNNING;
+	task->state = TASK_RUNNING;
+	if (!task->started) {
+		task->started = 1;
+		pthread_create(&task->thread, NULL, omnibook_sim_kthread, task);
+	}
+	pthread_cond_signal(&task->wait);
+	pthread_mutex_unlock(&task->lock);
+	return woken;
+}
+
+void set_current_state(long state)
+{
+	struct task_struct *task = current;
+
+	pthread_mutex_lock(&task->lock);
+	task->state = state;
+	pthread_mutex_unlock(&task->lock);
+}
+
+void schedule(void)
+{
+	struct task_struct *task = current;
+
+	pthread_mutex_lock(&task->lock);
+	while (task->state != TASK_RUNNING)
+		pthread_cond_wait(&task->wait, &task->lock);
+	pthread_mutex_unlock(&task->lock);
+}
+
+int kthread_should_stop(void)
+{
+	return current->should_stop;
+}
+
+/* Also frees the task, unlike the kernel which keeps a reference */
+int kthread_stop(struct task_struct *task)
+{
+	int retval;
+
+	pthread_mutex_lock(&task->lock);
+	task->should_stop = 1;
+	pthread_mutex_unlock(&task->lock);
+	wake_up_process(task);
+	pthread_join(task->thread, NULL);
+	retval = task->retval;
+	free(task);
+	return retval;
+}
+
+/*
+ * High resolution timers
+ */
+
+static void *omnibook_sim_hrtimer(void *data)
+{
+	struct hrtimer *timer = data;
+	struct timespec ts;
+
+	pthread_mutex_lock(&timer->lock);
+	for (;;) {
+		while (!timer->armed)
+			pthread_cond_wait(&timer->wait, &timer->lock);
+		ts.tv_sec = timer->expires / NSEC_PER_SEC;
+		ts.tv_nsec = timer->expires % NSEC_PER_SEC;
+		pthread_mutex_unlock(&timer->lock);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		pthread_mutex_lock(&timer->lock);
+		if (!timer->armed || ktime_get() < timer->expires)
+			continue;
+		timer->armed = 0;
+		timer->running = 1;
+		pthread_mutex_unlock(&timer->lock);
+		timer->function(timer);
+		pthread_mutex_lock(&timer->lock);
+		timer->running = 0;
+		pthread_cond_broadcast(&timer->wait);
+	}
+	return NULL;
+}
+
+/* The thread of a timer outlives it: timers must not be freed */
+void hrtimer_init(struct hrtimer *timer, clockid_t clock, enum hrtimer_mode mode)
+{
+	if (timer->started)
+		return;
+	pthread_mutex_init(&timer->lock, NULL);
+	pthread_cond_init(&timer->wait, NULL);
+	timer->armed = 0;
+	timer->running = 0;
+}
+
+int hrtimer_start(struct hrtimer *timer, ktime_t time, enum hrtimer_mode mode)
+{
+	int active;
+
+	pthread_mutex_lock(&timer->lock);
+	if (!timer->started) {
+		timer->started = 1;
+		pthread_create(&timer->thread, NULL, omnibook_sim_hrtimer, timer);
+		pthread_detach(timer->thread);
+	}
+	active = timer->armed;
+	timer->expires = mode == HRTIMER_MODE_REL ? ktime_get() + time : time;
+	timer->armed = 1;
+	pthread_cond_broadcast(&timer->wait);
+	pthread_mutex_unlock(&timer->lock);
+	return active;
+}
+
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	int active;
+
+	if (!timer->started)
+		return 0;
+	pthread_mutex_lock(&timer->lock);
+	active = timer->armed;
+	timer->armed = 0;
+	while (timer->running)
+		pthread_cond_wait(&timer->wait, &timer->lock);
+	pthread_mutex_unlock(&timer->lock);
+	return active;
+}
+
+/*
+ * Input handler registered last, events are injected through it
+ */
+struct input_handler *omnibook_sim_input_handler;
+
+/*
+ * I/O regions: a region cannot be requested twice, so that a backend
+ * leaking one shows up.
+ */
+
+#define OMNIBOOK_SIM_REGIONS	32
+
+static struct resource omnibook_sim_region[OMNIBOOK_SIM_REGIONS];
+static pthread_mutex_t omnibook_sim_region_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct resource *request_region(unsigned long start, unsigned long n, const char *name)
+{
+	struct resource *res = NULL;
+	struct resource *r;
+	int i;
+
+	pthread_mutex_lock(&omnibook_sim_region_lock);
+	for (i = 0; i < OMNIBOOK_SIM_REGIONS; i++) {
+		r = &omnibook_sim_region[i];
+		if (!r->n) {
+			if (!res)
+				res = r;
+			continue;
+		}
+		if (start < r->start + r->n && r->start < start + n) {
+			res = NULL;
+			goto out;
+		}
+	}
+	if (res) {
+		res->start = start;
+		res->n = n;
+	}
+      out:
+	pthread_mutex_unlock(&omnibook_sim_region_lock);
+	return res;
+}
+
+void release_region(unsigned long start, unsigned long n)
+{
+	int i;
+
+	pthread_mutex_lock(&omnibook_sim_region_lock);
+	for (i = 0; i < OMNIBOOK_SIM_REGIONS; i++) {
+		if (omnibook_sim_region[i].start == start && omnibook_sim_region[i].n == n) {
+			omnibook_sim_region[i].n = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&omnibook_sim_region_lock);
+	if (i == OMNIBOOK_SIM_REGIONS)
+		printk(KERN_WARNING "Releasing unknown region 0x%lx-0x%lx\n", start,
+		       start + n - 1);
+}
+
+/*
+ * seq_file: show is run once at the first read
+ */
+
+#define OMNIBOOK_SIM_SEQ_SIZE	65536
+
+int seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	if (m->count >= m->size)
+		return -1;
+	va_start(args, fmt);
+	len = vsnprintf(m->buf + m->count, m->size - m->count, fmt, args);
+	va_end(args);
+	m->count = min(m->count + len, m->size);
+	return 0;
+}
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data)
+{
+	struct seq_file *m;
+
+	m = calloc(1, sizeof(struct seq_file));
+	if (!m)
+		return -ENOMEM;
+	m->show = show;
+	m->private = data;
+	file->private_data = m;
+	return 0;
+}
+
+int single_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	free(m->buf);
+	free(m);
+	return 0;
+}
+
+ssize_t seq_read(struct file *file, char __user *buf, size_t size, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	int retval;
+
+	if (!m->buf) {
+		m->buf = malloc(OMNIBOOK_SIM_SEQ_SIZE);
+		if (!m->buf)
+			return -ENOMEM;
+		m->size = OMNIBOOK_SIM_SEQ_SIZE;
+		retval = m->show(m, NULL);
+		if (retval)
+			return retval;
+	}
+	if (*ppos >= m->count)
+		return 0;
+	size = min(size, m->count - (size_t) *ppos);
+	memcpy(buf, m->buf + *ppos, size);
+	*ppos += size;
+	return size;
+}
+
+loff_t seq_lseek(struct file *file, loff_t offset, int whence)
+{
+	return -ESPIPE;
+}
+
+ssize_t simple_read_from_buffer(void __user *to, size_t count, loff_t *ppos,
+				const void *from, size_t available)
+{
+	if (*ppos < 0)
+		return -EINVAL;
+	if (*ppos >= available)
+		return 0;
+	count = min(count, available - (size_t) *ppos);
+	memcpy(to, (const char *) from + *ppos, count);
+	*ppos += count;
+	return count;
+}
+
+/* End of file */
@@ -0,0 +1,183 @@
+/*
+ * sim.c -- init.c counterpart of the user-space harness
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+#include "hardware.h"
+#include "sim.h"
+
+/*
+ * init.c is not built: procfs and the platform device have no business
+ * here. What the backends need from it is defined below, the ectype is
+ * set by the harness before a backend or the features are initialised.
+ */
+
+enum omnibook_ectype_t omnibook_ectype = NONE;
+
+struct omnibook_backend *omnibook_backends[] = {
+	&kbc_backend,
+	&pio_backend,
+	&ec_backend,
+	&acpi_backend,
+	&nbsmi_backend,
+	&compal_backend,
+	&sim_backend,
+	NULL,
+};
+
+/* Delimiters of the .features section, see features.lds */
+extern struct omnibook_feature _start_features_driver[];
+extern struct omnibook_feature _end_features_driver[];
+
+/* Loaded features, as omnibook_available_feature of init.c */
+LIST_HEAD(omnibook_sim_features);
+
+/* Pristine .features section, feature init functions may modify it */
+static struct omnibook_feature *omnibook_sim_features_orig;
+
+struct omnibook_feature *omnibook_find_feature(char *name)
+{
+	struct omnibook_feature *feature;
+
+	list_for_each_entry(feature, &omnibook_sim_features, list) {
+		if (!strcmp(feature->name, name))
+			return feature;
+	}
+	return NULL;
+}
+
+/*
+ * omnibook_backend_match of init.c, without the debugfs files
+ */
+static struct omnibook_operation *omnibook_sim_backend_match(struct omnibook_tbl *tbl)
+{
+	int i;
+
+	for (i = 0; tbl[i].ectypes; i++) {
+		if (omnibook_ectype & tbl[i].ectypes) {
+			if (omnibook_simulated)
+				tbl[i].io_op.backend = &sim_backend;
+			if (tbl[i].io_op.backend->init && tbl[i].io_op.backend->init(&tbl[i].io_op))
+				continue;
+			return &tbl[i].io_op;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * omnibook_init of init.c, without the procfs file
+ */
+static int omnibook_sim_feature_init(struct omnibook_feature *feature)
+{
+	struct omnibook_operation *op;
+	int retval;
+
+	if (feature->tbl) {
+		op = omnibook_sim_backend_match(feature->tbl);
+		if (!op)
+			return -ENODEV;
+		feature->io_op = kmalloc(sizeof(struct omnibook_operation), GFP_KERNEL);
+		if (!feature->io_op)
+			return -ENOMEM;
+		memcpy(feature->io_op, op, sizeof(struct omnibook_operation));
+		feature->io_op->feature = feature->name;
+	}
+
+	if (feature->init && (retval = feature->init(feature->io_op))) {
+		printk(O_ERR "Init function of %s failed with error %i.\n", feature->name, retval);
+		if (feature->io_op && feature->io_op->backend->exit)
+			feature->io_op->backend->exit(feature->io_op);
+		kfree(feature->io_op);
+		return retval;
+	}
+	list_add_tail(&feature->list, &omnibook_sim_features);
+	return 0;
+}
+
+/*
+ * Load the features of omnibook_ectype, as omnibook_probe does, all of
+ * them if all is set, regardless of their module parameter
+ */
+int omnibook_sim_features_load(int all)
+{
+	struct omnibook_feature *feature;
+	size_t size = (char *) _end_features_driver - (char *) _start_features_driver;
+
+	if (!omnibook_sim_features_orig) {
+		omnibook_sim_features_orig = malloc(size);
+		if (!omnibook_sim_features_orig)
+			return -ENOMEM;
+		memcpy(omnibook_sim_features_orig, _start_features_driver, size);
+	} else
+		memcpy(_start_features_driver, omnibook_sim_features_orig, size);
+
+	INIT_LIST_HEAD(&omnibook_sim_features);
+	for (feature = _start_features_driver; feature < _end_features_driver; feature++) {
+		if (!feature->name || !(feature->enabled || all))
+			continue;
+		if ((omnibook_ectype & feature->ectypes) || !feature->ectypes)
+			omnibook_sim_feature_init(feature);
+	}
+	return 0;
+}
+
+/*
+ * omnibook_remove of init.c
+ */
+void omnibook_sim_features_unload(void)
+{
+	struct omnibook_feature *feature, *temp;
+
+	list_for_each_entry_safe(feature, temp, &omnibook_sim_features, list) {
+		list_del(&feature->list);
+		if (feature->exit)
+			feature->exit(feature->io_op);
+		if (feature->io_op && feature->io_op->backend->exit)
+			feature->io_op->backend->exit(feature->io_op);
+		kfree(feature->io_op);
+	}
+}
+
+/*
+ * Module init sequence, minus the features
+ */
+int omnibook_sim_setup(void)
+{
+	int i;
+
+	omnibook_sim_reset();
+
+	mutex_init(&kbc_backend.mutex);
+	mutex_init(&pio_backend.mutex);
+	mutex_init(&ec_backend.mutex);
+	mutex_init(&sim_backend.mutex);
+
+	for (i = 0; omnibook_backends[i]; i++) {
+		omnibook_latency_init(omnibook_backends[i]);
+		omnibook_histogram_init(omnibook_backends[i]);
+	}
+
+	omnibook_flight_init();
+	if (omnibook_queue_init())
+		return -ENOMEM;
+	return 0;
+}
+
+void omnibook_sim_cleanup(void)
+{
+	omnibook_queue_exit();
+	omnibook_flight_exit();
+}
+
+/* End of file */
@@ -0,0 +1,84 @@
+/*
+ * sim.h -- simulated hardware of the user-space harness
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef _OMNIBOOK_SIM_SIM_H
+#define _OMNIBOOK_SIM_SIM_H
+
+/*
+ * Timings of the simulated devices, in ns, set with name=value on the
+ * command line, see omnibook_sim_param()
+ */
+struct omnibook_sim_params {
+	unsigned long io_ns;		/* duration of any port access (LPC cycle) */
+	unsigned long ec_ibf_ns;	/* EC takes a byte from its input buffer */
+	unsigned long ec_obf_ns;	/* then fills its output buffer */
+	unsigned long ec_burst_ns;	/* both, in burst mode */
+	unsigned long ec_no_burst;	/* EC refuses burst mode */
+	unsigned long kbc_ibf_ns;	/* i8042 takes a byte from its input buffer */
+	unsigned long cdi_ns;		/* CDI command execution */
+	unsigned long smi_ns;		/* time spent in SMM by an SMI */
+	unsigned long acpi_ns;		/* evaluation of an AML method */
+	unsigned long lpc_device;	/* PCI device id of the LPC bridge */
+};
+
+extern struct omnibook_sim_params omnibook_sim;
+
+/*
+ * Port accesses by simulated device, for I/O cost accounting, SMIs and
+ * ACPI evaluations are counted as outs
+ */
+enum omnibook_sim_dev {
+	OMNIBOOK_SIM_EC,
+	OMNIBOOK_SIM_KBC,
+	OMNIBOOK_SIM_CDI,
+	OMNIBOOK_SIM_CMOS,
+	OMNIBOOK_SIM_SMI,	/* SMIs triggered */
+	OMNIBOOK_SIM_GPE,
+	OMNIBOOK_SIM_MAILBOX,
+	OMNIBOOK_SIM_GPIO,
+	OMNIBOOK_SIM_UNCLAIMED,	/* nothing decodes the port */
+	OMNIBOOK_SIM_ACPI,	/* AML methods evaluated */
+	OMNIBOOK_SIM_DEVS,
+};
+
+struct omnibook_sim_io {
+	unsigned long in;
+	unsigned long out;
+};
+
+extern struct omnibook_sim_io omnibook_sim_io[OMNIBOOK_SIM_DEVS];
+extern const char *omnibook_sim_dev_name[OMNIBOOK_SIM_DEVS];
+extern int omnibook_sim_loglevel;
+
+int omnibook_sim_param(const char *arg);
+void omnibook_sim_params_show(FILE *out);
+void omnibook_sim_reset(void);
+
+/* Register files of the devices, to seed or check them */
+u8 *omnibook_sim_ec_ram(void);
+u8 *omnibook_sim_cdi_index(void);
+u8 *omnibook_sim_smi_state(void);
+
+/* ACPI stand-in, see acpica.c */
+void omnibook_sim_acpi_reset(void);
+int omnibook_sim_acpi_param(const char *arg);
+
+/* init.c counterpart, see sim.c */
+int omnibook_sim_setup(void);
+void omnibook_sim_cleanup(void);
+extern struct list_head omnibook_sim_features;
+int omnibook_sim_features_load(int all);
+void omnibook_sim_features_unload(void);
+
+#endif /* _OMNIBOOK_SIM_SIM_H */
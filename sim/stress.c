@@ -0,0 +1,452 @@
+/*
+ * stress.c -- concurrent readers and writers of /proc/omnibook
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+/*
+ * Unlike the rest of the harness this is a plain program, run against
+ * the loaded module, typically in a VM with ectype=sim:<n> and
+ * sim_delay=<us>. Reader threads read the procfs files in turn, each
+ * from its own starting point, writer threads write them while they do.
+ *
+ * Reported are the rate and latency of reads by file, how evenly the
+ * readers were served (Jain's index of their read counts, 1 is perfectly
+ * fair) and, when debugfs is mounted, what the backend mutex went
+ * through during the run according to omnibook/<backend>/lock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#define ARRAY_SIZE(x)		(sizeof(x) / sizeof((x)[0]))
+#define STRESS_MAX_FILES	16
+#define STRESS_MAX_OWNERS	16
+
+static const char *stress_readable[] = {
+	"temperature", "fan", "battery", "ac", "lcd", "display", "wifi", "bluetooth",
+};
+
+/* Files written and the values written in turn */
+static const struct {
+	const char *name;
+	const char *value[2];
+} stress_writable[] = {
+	{ "fan", { "1", "0" } },
+	{ "lcd", { "5", "2" } },
+	{ "touchpad", { "1", "0" } },
+};
+
+static const char *stress_root = "/proc/omnibook";
+static const char *stress_debugfs = "/sys/kernel/debug/omnibook";
+static const char *stress_backend = "sim";
+static unsigned int stress_readers = 4;
+static unsigned int stress_writers;
+static unsigned int stress_seconds = 10;
+static unsigned int stress_interval;	/* us between writes of a writer */
+static int stress_force;
+
+/* Files present, readers only use those */
+static const char *stress_files[STRESS_MAX_FILES];
+static unsigned int stress_nfiles;
+
+static volatile int stress_stop;
+
+struct stress_sample {
+	uint32_t ns;
+	uint32_t file;
+};
+
+struct stress_thread {
+	pthread_t thread;
+	unsigned int id;
+	struct stress_sample *samples;
+	unsigned long count;
+	unsigned long size;
+	unsigned long errors;
+};
+
+static uint64_t stress_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int stress_add(struct stress_thread *t, uint64_t ns, unsigned int file)
+{
+	struct stress_sample *samples;
+
+	if (t->count == t->size) {
+		t->size = t->size ? 2 * t->size : 4096;
+		samples = realloc(t->samples, t->size * sizeof(struct stress_sample));
+		if (!samples)
+			return -ENOMEM;
+		t->samples = samples;
+	}
+	t->samples[t->count].ns = ns > UINT32_MAX ? UINT32_MAX : ns;
+	t->samples[t->count].file = file;
+	t->count++;
+	return 0;
+}
+
+static int stress_read(const char *name)
+{
+	char path[256], buf[4096];
+	ssize_t n;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", stress_root, name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		;
+	close(fd);
+	return n < 0 ? -errno : 0;
+}
+
+static int stress_write(const char *name, const char *value)
+{
+	char path[256];
+	ssize_t n;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", stress_root, name);
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -errno;
+	n = write(fd, value, strlen(value));
+	close(fd);
+	return n < 0 ? -errno : 0;
+}
+
+static void *stress_reader(void *arg)
+{
+	struct stress_thread *t = arg;
+	unsigned int file = t->id % stress_nfiles;
+	uint64_t start;
+
+	while (!stress_stop) {
+		start = stress_ns();
+		if (stress_read(stress_files[file]))
+			t->errors++;
+		if (stress_add(t, stress_ns() - start, file))
+			break;
+		file = (file + 1) % stress_nfiles;
+	}
+	return NULL;
+}
+
+static void *stress_writer(void *arg)
+{
+	struct stress_thread *t = arg;
+	unsigned int file = t->id % ARRAY_SIZE(stress_writable);
+	unsigned long i;
+	uint64_t start;
+
+	for (i = 0; !stress_stop; i++) {
+		start = stress_ns();
+		if (stress_write(stress_writable[file].name, stress_writable[file].value[i & 1]))
+			t->errors++;
+		if (stress_add(t, stress_ns() - start, file))
+			break;
+		if (stress_interval)
+			usleep(stress_interval);
+	}
+	return NULL;
+}
+
+/*
+ * Backend mutex statistics, see lockstat.c
+ */
+
+struct stress_owner {
+	char name[32];
+	unsigned long acquired;
+	unsigned long contended;
+	unsigned long wait_total;	/* us */
+	unsigned long hold_total;	/* us */
+};
+
+static int stress_lockstat(struct stress_owner *owner)
+{
+	char path[256], line[256];
+	unsigned long wait_max, wait_avg, hold_max;
+	int n = 0;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s/lock", stress_debugfs, stress_backend);
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+	while (n < STRESS_MAX_OWNERS && fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%31s %lu %lu %lu us %lu us %lu us %lu us %lu us", owner[n].name,
+			   &owner[n].acquired, &owner[n].contended, &owner[n].wait_total,
+			   &wait_max, &wait_avg, &owner[n].hold_total, &hold_max) == 8)
+			n++;
+	}
+	fclose(f);
+	return n;
+}
+
+static void stress_lockstat_report(const struct stress_owner *before, int nbefore,
+				   const struct stress_owner *after, int nafter)
+{
+	struct stress_owner d;
+	int i, j;
+
+	printf("\nbackend %s mutex during the run\n", stress_backend);
+	printf("%-16s %10s %10s %12s %12s %12s\n", "owner", "acquired", "contended",
+	       "wait total", "wait avg", "hold avg");
+	for (i = 0; i < nafter; i++) {
+		d = after[i];
+		for (j = 0; j < nbefore; j++) {
+			if (strcmp(before[j].name, d.name))
+				continue;
+			d.acquired -= before[j].acquired;
+			d.contended -= before[j].contended;
+			d.wait_total -= before[j].wait_total;
+			d.hold_total -= before[j].hold_total;
+		}
+		if (!d.acquired)
+			continue;
+		printf("%-16s %10lu %10lu %9lu us %9lu us %9lu us\n", d.name, d.acquired,
+		       d.contended, d.wait_total, d.contended ? d.wait_total / d.contended : 0,
+		       d.hold_total / d.acquired);
+	}
+}
+
+/*
+ * Latency report of the samples of some threads, by file
+ */
+
+static int stress_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void stress_line(const char *name, uint32_t *ns, unsigned long count,
+			unsigned long errors, double seconds)
+{
+	double total = 0;
+	unsigned long i;
+
+	if (!count)
+		return;
+	qsort(ns, count, sizeof(uint32_t), stress_cmp);
+	for (i = 0; i < count; i++)
+		total += ns[i];
+	printf("%-12s %9lu %10.0f %9.1f %9.1f %9.1f %9.1f %9.1f %6lu\n", name, count,
+	       count / seconds, total / count / 1000, ns[count / 2] / 1000.0,
+	       ns[(count * 99 + 99) / 100 - 1] / 1000.0,
+	       ns[(count * 999 + 999) / 1000 - 1] / 1000.0, ns[count - 1] / 1000.0, errors);
+}
+
+static void stress_report(const char *what, struct stress_thread *threads, unsigned int n,
+			  const char **names, unsigned int nnames, double seconds)
+{
+	unsigned long total = 0, count, errors = 0;
+	uint32_t *ns;
+	unsigned int i, f;
+	unsigned long j;
+
+	for (i = 0; i < n; i++) {
+		total += threads[i].count;
+		errors += threads[i].errors;
+	}
+	ns = malloc((total ? total : 1) * sizeof(uint32_t));
+	if (!ns)
+		return;
+
+	printf("\n%-12s %9s %10s %9s %9s %9s %9s %9s %6s\n", what, "count", "per s", "mean us",
+	       "p50 us", "p99 us", "p99.9 us", "max us", "errors");
+	for (f = 0; f < nnames; f++) {
+		count = 0;
+		for (i = 0; i < n; i++)
+			for (j = 0; j < threads[i].count; j++)
+				if (threads[i].samples[j].file == f)
+					ns[count++] = threads[i].samples[j].ns;
+		stress_line(names[f], ns, count, 0, seconds);
+	}
+	count = 0;
+	for (i = 0; i < n; i++)
+		for (j = 0; j < threads[i].count; j++)
+			ns[count++] = threads[i].samples[j].ns;
+	stress_line("all", ns, count, errors, seconds);
+	free(ns);
+}
+
+/* Jain's fairness index of the reads of each reader */
+static void stress_fairness(struct stress_thread *threads, unsigned int n)
+{
+	double sum = 0, sum2 = 0;
+	unsigned long min = ~0UL, max = 0;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		sum += threads[i].count;
+		sum2 += (double) threads[i].count * threads[i].count;
+		if (threads[i].count < min)
+			min = threads[i].count;
+		if (threads[i].count > max)
+			max = threads[i].count;
+	}
+	printf("\nreads per reader: min %lu, max %lu, fairness %.3f\n", min, max,
+	       sum2 ? sum * sum / (n * sum2) : 0);
+}
+
+/*
+ * Writers change the machine state, only let them loose on the
+ * simulated backend
+ */
+static int stress_simulated(void)
+{
+	char buf[32] = "";
+	FILE *f;
+
+	f = fopen("/sys/module/omnibook/parameters/ectype", "r");
+	if (!f)
+		return 0;
+	if (!fgets(buf, sizeof(buf), f))
+		buf[0] = '\0';
+	fclose(f);
+	return !strncmp(buf, "sim:", 4);
+}
+
+static void stress_usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-r readers] [-w writers] [-t seconds] [-i us] [-b backend] [-d dir] [-f] [file ...]\n"
+		"  -r readers  reader threads (default %u)\n"
+		"  -w writers  writer threads on fan, lcd and touchpad (default 0)\n"
+		"  -t seconds  duration (default %u)\n"
+		"  -i us       pause of a writer between writes (default 0)\n"
+		"  -b backend  backend whose mutex statistics are reported (default %s)\n"
+		"  -d dir      where the files are (default %s)\n"
+		"  -f          allow writers on real hardware\n"
+		"files default to temperature fan battery ac lcd display wifi bluetooth\n",
+		prog, stress_readers, stress_seconds, stress_backend, stress_root);
+}
+
+int main(int argc, char **argv)
+{
+	struct stress_owner before[STRESS_MAX_OWNERS], after[STRESS_MAX_OWNERS];
+	const char *writable[ARRAY_SIZE(stress_writable)];
+	struct stress_thread *readers, *writers;
+	char path[256];
+	int nbefore, nafter;
+	uint64_t start;
+	double seconds;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:w:t:i:b:d:fh")) != -1) {
+		switch (opt) {
+		case 'r':
+			stress_readers = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			stress_writers = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			stress_seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			stress_interval = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			stress_backend = optarg;
+			break;
+		case 'd':
+			stress_root = optarg;
+			break;
+		case 'f':
+			stress_force = 1;
+			break;
+		default:
+			stress_usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+
+	for (i = optind; i < argc && stress_nfiles < STRESS_MAX_FILES; i++)
+		stress_files[stress_nfiles++] = argv[i];
+	for (i = 0; optind == argc && i < ARRAY_SIZE(stress_readable); i++) {
+		snprintf(path, sizeof(path), "%s/%s", stress_root, stress_readable[i]);
+		if (!access(path, R_OK))
+			stress_files[stress_nfiles++] = stress_readable[i];
+	}
+	if (!stress_nfiles || !stress_readers) {
+		fprintf(stderr, "%s: nothing to read in %s\n", argv[0], stress_root);
+		return 1;
+	}
+	if (stress_writers && !stress_force && !stress_simulated()) {
+		fprintf(stderr, "%s: omnibook is not loaded with ectype=sim:<n>, "
+			"use -f to write to the hardware\n", argv[0]);
+		return 1;
+	}
+	for (i = 0; i < ARRAY_SIZE(stress_writable); i++)
+		writable[i] = stress_writable[i].name;
+
+	readers = calloc(stress_readers, sizeof(struct stress_thread));
+	writers = calloc(stress_writers + 1, sizeof(struct stress_thread));
+	if (!readers || !writers)
+		return 1;
+
+	nbefore = stress_lockstat(before);
+	start = stress_ns();
+	for (i = 0; i < stress_readers; i++) {
+		readers[i].id = i;
+		if (pthread_create(&readers[i].thread, NULL, stress_reader, &readers[i]))
+			return 1;
+	}
+	for (i = 0; i < stress_writers; i++) {
+		writers[i].id = i;
+		if (pthread_create(&writers[i].thread, NULL, stress_writer, &writers[i]))
+			return 1;
+	}
+
+	sleep(stress_seconds);
+	stress_stop = 1;
+	for (i = 0; i < stress_readers; i++)
+		pthread_join(readers[i].thread, NULL);
+	for (i = 0; i < stress_writers; i++)
+		pthread_join(writers[i].thread, NULL);
+	seconds = (stress_ns() - start) / 1e9;
+	nafter = stress_lockstat(after);
+
+	printf("%u readers, %u writers, %.1f s\n", stress_readers, stress_writers, seconds);
+	stress_report("read", readers, stress_readers, stress_files, stress_nfiles, seconds);
+	stress_fairness(readers, stress_readers);
+	if (stress_writers)
+		stress_report("write", writers, stress_writers, writable, ARRAY_SIZE(stress_writable),
+			      seconds);
+	if (nbefore >= 0 && nafter >= 0)
+		stress_lockstat_report(before, nbefore, after, nafter);
+	else
+		printf("\n%s/%s/lock not readable, no mutex statistics\n", stress_debugfs,
+		       stress_backend);
+	return 0;
+}
+
+/* End of file */
@@ -0,0 +1,422 @@
+/*
+ * simulated.c -- RAM backed backend, for use without the hardware
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/types.h>
+#include <linux/delay.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <asm/uaccess.h>
+
+#include "hardware.h"
+
+/*
+ * Loading with ectype=sim:<n> makes the module behave as on ectype <n>,
+ * but every feature table entry is routed to this backend, see
+ * omnibook_backend_match in init.c. Reads and writes go to a 256 bytes
+ * register file indexed by the low byte of the address, the other
+ * backend calls keep their state here. Each call costs sim_delay us and
+ * one in sim_fail calls fails with -sim_errno, unless a trace of real
+ * hardware is replayed, see below.
+ *
+ * All functions are called with the backend mutex held.
+ */
+
+int omnibook_simulated = 0;
+
+static unsigned int omnibook_sim_delay = 0;
+static unsigned int omnibook_sim_fail = 0;
+static int omnibook_sim_errno = EIO;
+
+#define OMNIBOOK_SIM_REGS	256
+
+static struct {
+	u8 regs[OMNIBOOK_SIM_REGS];
+	unsigned int aerial;
+	unsigned int hotkeys;
+	unsigned int display;
+	unsigned int throttle;
+	unsigned long calls;		/* backend calls */
+	unsigned long failures;		/* injected failures */
+} sim_state;
+
+/*
+ * Replay of a trace taken by record.c: each call takes the duration,
+ * result and read value of the next recorded call of the same type,
+ * wrapping around at the end of the trace. Calls of a type missing from
+ * the trace fall back to sim_delay and sim_fail.
+ */
+static struct {
+	struct omnibook_record *rec;
+	unsigned int count;
+	unsigned int next;		/* where to look for the next call */
+	unsigned long replayed;		/* calls found in the trace */
+	unsigned long missed;		/* calls not found */
+} sim_replay;
+
+/*
+ * Load a trace, header first. An empty trace stops the replay.
+ */
+int omnibook_sim_replay_load(const void *trace, size_t len)
+{
+	const struct omnibook_record_header *hdr = trace;
+	struct omnibook_record *rec = NULL, *old;
+
+	if (len < sizeof(*hdr) || memcmp(hdr->magic, OMNIBOOK_RECORD_MAGIC, sizeof(hdr->magic)) ||
+	    hdr->version != OMNIBOOK_RECORD_VERSION ||
+	    hdr->record_size != sizeof(struct omnibook_record) ||
+	    hdr->count > (len - sizeof(*hdr)) / sizeof(struct omnibook_record))
+		return -EINVAL;
+
+	if (hdr->count) {
+		rec = vmalloc(hdr->count * sizeof(struct omnibook_record));
+		if (!rec)
+			return -ENOMEM;
+		memcpy(rec, hdr + 1, hdr->count * sizeof(struct omnibook_record));
+	}
+
+	omnibook_backend_lock(&sim_backend, "replay");
+	old = sim_replay.rec;
+	sim_replay.rec = rec;
+	sim_replay.count = hdr->count;
+	sim_replay.next = 0;
+	sim_replay.replayed = 0;
+	sim_replay.missed = 0;
+	omnibook_backend_unlock(&sim_backend);
+
+	vfree(old);
+	return 0;
+}
+
+static const struct omnibook_record *omnibook_sim_replay_next(enum omnibook_record_type type)
+{
+	unsigned int i, n;
+
+	for (i = 0; i < sim_replay.count; i++) {
+		n = (sim_replay.next + i) % sim_replay.count;
+		if (sim_replay.rec[n].type == type) {
+			sim_replay.next = n + 1;
+			sim_replay.replayed++;
+			return &sim_replay.rec[n];
+		}
+	}
+	sim_replay.missed++;
+	return NULL;
+}
+
+/*
+ * Spin for short delays, sleep otherwise
+ * usleep_range appeared in 2.6.36
+ */
+static void omnibook_sim_wait(unsigned int ns)
+{
+	unsigned int delay = ns / 1000;
+
+	if (delay < 20)
+		ndelay(ns);
+	else
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36))
+		usleep_range(delay, delay + delay / 4);
+#else
+		msleep(DIV_ROUND_UP(delay, 1000));
+#endif
+}
+
+/*
+ * Cost and result of a call. A replayed read overrides *value.
+ */
+static int omnibook_sim_call(enum omnibook_record_type type, unsigned int *value)
+{
+	const struct omnibook_record *rec = NULL;
+
+	sim_state.calls++;
+	if (sim_replay.count)
+		rec = omnibook_sim_replay_next(type);
+	if (rec) {
+		omnibook_sim_wait(rec->duration);
+		if (value)
+			*value = rec->value;
+		return rec->retval;
+	}
+
+	omnibook_sim_wait(omnibook_sim_delay * 1000);
+	if (omnibook_sim_fail && !(sim_state.calls % omnibook_sim_fail)) {
+		sim_state.failures++;
+		return -omnibook_sim_errno;
+	}
+	return 0;
+}
+
+static int omnibook_sim_read(const struct omnibook_operation *io_op, u8 *value)
+{
+	unsigned int data = sim_state.regs[io_op->read_addr % OMNIBOOK_SIM_REGS];
+	int retval;
+
+	if ((retval = omnibook_sim_call(OMNIBOOK_REC_READ, &data)))
+		return retval;
+
+	*value = data;
+	if (io_op->read_mask)
+		*value &= io_op->read_mask;
+	return 0;
+}
+
+static int omnibook_sim_write(const struct omnibook_operation *io_op, u8 value)
+{
+	int retval;
+
+	if ((retval = omnibook_sim_call(OMNIBOOK_REC_WRITE, NULL)))
+		return retval;
+
+	sim_state.regs[io_op->write_addr % OMNIBOOK_SIM_REGS] = value;
+	return 0;
+}
+
+static int omnibook_sim_block_read(const struct omnibook_operation *io_op, unsigned long addr,
+				   u8 *buf, int len)
+{
+	int retval, i;
+
+	if ((retval = omnibook_sim_call(OMNIBOOK_REC_BLOCK_READ, NULL)))
+		return retval;
+
+	for (i = 0; i < len; i++)
+		buf[i] = sim_state.regs[(addr + i) % OMNIBOOK_SIM_REGS];
+	return 0;
+}
+
+static int omnibook_sim_block_write(const struct omnibook_operation *io_op, unsigned long addr,
+				    const u8 *buf, int len)
+{
+	int retval, i;
+
+	if ((retval = omnibook_sim_call(OMNIBOOK_REC_BLOCK_WRITE, NULL)))
+		return retval;
+
+	for (i = 0; i < len; i++)
+		sim_state.regs[(addr + i) % OMNIBOOK_SIM_REGS] = buf[i];
+	return 0;
+}
+
+/*
+ * State of the other backend calls, every capability is advertised
+ * unless a replayed get recorded the capabilities of the real backend.
+ */
+#define sim_state_func(func, FUNC, mask, caps) \
+static int omnibook_sim_##func##_get(const struct omnibook_operation *io_op, unsigned int *state) \
+{ \
+	unsigned int data = sim_state.func; \
+	int retval; \
+	if ((retval = omnibook_sim_call(OMNIBOOK_REC_##FUNC##_GET, &data)) < 0) \
+		return retval; \
+	*state = data; \
+	return retval ? retval : caps; \
+} \
+static int omnibook_sim_##func##_set(const struct omnibook_operation *io_op, unsigned int state) \
+{ \
+	int retval; \
+	if ((retval = omnibook_sim_call(OMNIBOOK_REC_##FUNC##_SET, NULL))) \
+		return retval; \
+	sim_state.func = state & (mask); \
+	return 0; \
+}
+
+sim_state_func(aerial, AERIAL, WIFI_EX | WIFI_STA | BT_EX | BT_STA, 0)
+sim_state_func(hotkeys, HOTKEYS, (1 << (HKEY_LAST_SHIFT + 1)) - 1, 0)
+sim_state_func(display, DISPLAY, 0xff, 0xff)
+sim_state_func(throttle, THROTTLE, 7, 0)
+
+static int omnibook_sim_regs_show(struct seq_file *m, void *v)
+{
+	struct omnibook_backend *backend = m->private;
+	int i;
+
+	omnibook_backend_lock(backend, "debugfs");
+	seq_printf(m, "calls:    %lu\n", sim_state.calls);
+	seq_printf(m, "failures: %lu\n", sim_state.failures);
+	seq_printf(m, "replay:   %u records, %lu replayed, %lu missed\n", sim_replay.count,
+		   sim_replay.replayed, sim_replay.missed);
+	for (i = 0; i < OMNIBOOK_SIM_REGS; i++)
+		seq_printf(m, "%s%02x", (i % 16) ? " " : (i ? "\n" : ""), sim_state.regs[i]);
+	seq_printf(m, "\n");
+	omnibook_backend_unlock(backend);
+	return 0;
+}
+
+static int omnibook_sim_regs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omnibook_sim_regs_show, inode->i_private);
+}
+
+static const struct file_operations omnibook_sim_regs_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_sim_regs_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Writing a trace to omnibook/sim/replay loads it once the file is closed
+ * The upload buffer doubles as needed, so that a trace written in small
+ * chunks is not copied over at each of them.
+ */
+
+#define OMNIBOOK_SIM_REPLAY_MAX	(16 << 20)
+#define OMNIBOOK_SIM_REPLAY_MIN	(64 << 10)	/* first buffer size */
+
+struct omnibook_sim_upload {
+	void *trace;
+	size_t len;
+	size_t size;		/* of the trace buffer */
+};
+
+static int omnibook_sim_replay_open(struct inode *inode, struct file *file)
+{
+	file->private_data = kzalloc(sizeof(struct omnibook_sim_upload), GFP_KERNEL);
+	return file->private_data ? 0 : -ENOMEM;
+}
+
+static ssize_t omnibook_sim_replay_write(struct file *file, const char __user *buf,
+					 size_t count, loff_t *ppos)
+{
+	struct omnibook_sim_upload *up = file->private_data;
+	size_t size;
+	void *trace;
+
+	if (up->len + count > OMNIBOOK_SIM_REPLAY_MAX)
+		return -EFBIG;
+	if (up->len + count > up->size) {
+		size = max_t(size_t, up->size, OMNIBOOK_SIM_REPLAY_MIN);
+		while (size < up->len + count)
+			size *= 2;
+		size = min_t(size_t, size, OMNIBOOK_SIM_REPLAY_MAX);
+		trace = vmalloc(size);
+		if (!trace)
+			return -ENOMEM;
+		if (up->trace)
+			memcpy(trace, up->trace, up->len);
+		vfree(up->trace);
+		up->trace = trace;
+		up->size = size;
+	}
+	if (copy_from_user(up->trace + up->len, buf, count))
+		return -EFAULT;
+	up->len += count;
+	*ppos += count;
+	return count;
+}
+
+static int omnibook_sim_replay_release(struct inode *inode, struct file *file)
+{
+	struct omnibook_sim_upload *up = file->private_data;
+	int retval = 0;
+
+	if (up->len) {
+		retval = omnibook_sim_replay_load(up->trace, up->len);
+		if (retval)
+			printk(O_WARN "Invalid trace for the simulated backend.\n");
+	}
+	vfree(up->trace);
+	kfree(up);
+	return retval;
+}
+
+static const struct file_operations omnibook_sim_replay_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_sim_replay_open,
+	.write = omnibook_sim_replay_write,
+	.release = omnibook_sim_replay_release,
+};
+
+static struct dentry *sim_regs_file;
+static struct dentry *sim_replay_file;
+
+/*
+ * Backend init: the simulated hardware is always there
+ * This function can be called blindly as it use a kref
+ */
+static int omnibook_sim_init(const struct omnibook_operation *io_op)
+{
+	if (!io_op->backend->data) {
+		dprintk("Init simulated backend\n");
+		kref_init(&io_op->backend->kref);
+		io_op->backend->data = &sim_state;
+		sim_state.aerial = WIFI_EX | WIFI_STA | BT_EX | BT_STA;
+		sim_state.display = DISPLAY_LCD_ON | DISPLAY_LCD_DET;
+		sim_regs_file = omnibook_debugfs_file(io_op->backend, "regs", S_IRUGO,
+						      &omnibook_sim_regs_fops);
+		sim_replay_file = omnibook_debugfs_file(io_op->backend, "replay", S_IWUSR,
+							&omnibook_sim_replay_fops);
+	} else
+		kref_get(&io_op->backend->kref);
+	return 0;
+}
+
+static void omnibook_sim_free(struct kref *ref)
+{
+	struct omnibook_backend *backend;
+
+	backend = container_of(ref, struct omnibook_backend, kref);
+	dprintk("Simulated backend not used anymore: disposing\n");
+	debugfs_remove(sim_regs_file);
+	debugfs_remove(sim_replay_file);
+	sim_regs_file = NULL;
+	sim_replay_file = NULL;
+	vfree(sim_replay.rec);
+	sim_replay.rec = NULL;
+	sim_replay.count = 0;
+	backend->data = NULL;
+}
+
+static void omnibook_sim_exit(const struct omnibook_operation *io_op)
+{
+	kref_put(&io_op->backend->kref, omnibook_sim_free);
+}
+
+/*
+ * Backend interface declarations
+ */
+
+struct omnibook_backend sim_backend = {
+	.name = "sim",
+	.hotkeys_read_cap = (1 << (HKEY_LAST_SHIFT + 1)) - 1,
+	.hotkeys_write_cap = (1 << (HKEY_LAST_SHIFT + 1)) - 1,
+	.init = omnibook_sim_init,
+	.exit = omnibook_sim_exit,
+	.byte_read = omnibook_sim_read,
+	.byte_write = omnibook_sim_write,
+	.block_read = omnibook_sim_block_read,
+	.block_write = omnibook_sim_block_write,
+	.aerial_get = omnibook_sim_aerial_get,
+	.aerial_set = omnibook_sim_aerial_set,
+	.hotkeys_get = omnibook_sim_hotkeys_get,
+	.hotkeys_set = omnibook_sim_hotkeys_set,
+	.display_get = omnibook_sim_display_get,
+	.display_set = omnibook_sim_display_set,
+	.throttle_get = omnibook_sim_throttle_get,
+	.throttle_set = omnibook_sim_throttle_set,
+};
+
+module_param_named(sim_delay, omnibook_sim_delay, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sim_delay, "Duration in us of each call to the simulated backend (ectype=sim:<n>)");
+module_param_named(sim_fail, omnibook_sim_fail, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sim_fail, "Make one in sim_fail calls to the simulated backend fail, 0 never");
+module_param_named(sim_errno, omnibook_sim_errno, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sim_errno, "Error returned by the failing calls, e.g. 62 (ETIME) to trip the breaker");
+
+/* End of file */
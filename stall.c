@@ -0,0 +1,364 @@
+/*
+ * stall.c -- interrupt and scheduling latency injected by backend calls
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <linux/version.h>
+#include <asm/uaccess.h>
+#include "hardware.h"
+
+/*
+ * SMI calls run with interrupts and preemption disabled, the KBC waits
+ * with a spinlock held with interrupts off: while they run the CPU serves
+ * nothing else. This measures by how much, cyclictest style.
+ *
+ * Writing "<reads> [<cpu>]" to omnibook/stall in debugfs reads every
+ * feature <reads> times from a thread bound to <cpu> (0 by default).
+ * Meanwhile a timer fires every stall_period us on the same CPU and
+ * wakes a SCHED_FIFO thread: how late the timer runs is the interrupt
+ * latency, how late the thread runs the scheduling latency. The worst of
+ * both seen during each backend operation is charged to it, by backend
+ * and operation type as in the latency histograms, and during each read
+ * to the feature. A first pass with the CPU idle gives the baseline.
+ *
+ * Reading omnibook/stall shows the results of the last run, in ns.
+ */
+
+#define OMNIBOOK_STALL_BACKENDS	8
+#define OMNIBOOK_STALL_IDLE	100	/* ms of baseline */
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,30))
+#define OMNIBOOK_STALL_MODE	HRTIMER_MODE_ABS_PINNED
+#else
+#define OMNIBOOK_STALL_MODE	HRTIMER_MODE_ABS
+#endif
+
+enum {
+	OMNIBOOK_STALL_IRQ,		/* timer lateness */
+	OMNIBOOK_STALL_SCHED,		/* measuring thread lateness */
+	OMNIBOOK_STALL_KINDS,
+};
+
+struct omnibook_stall_max {
+	unsigned long count;
+	u32 max[OMNIBOOK_STALL_KINDS];	/* ns */
+};
+
+/* Read only features, all of them are read */
+static const char *omnibook_stall_features[] = {
+	"ac", "battery", "bluetooth", "cooling", "display", "dock", "fan", "fan_policy",
+	"hotkeys", "lcd", "muteled", "temperature", "throttling", "touchpad", "wifi",
+};
+
+int omnibook_stalling = 0;
+
+static unsigned int omnibook_stall_period = 100;
+
+static DEFINE_MUTEX(omnibook_stall_mutex);	/* one run at a time, results */
+static DEFINE_SPINLOCK(omnibook_stall_lock);	/* samples */
+
+static struct {
+	struct hrtimer timer;
+	ktime_t expires;		/* of the pending timer */
+	struct task_struct *measure;	/* SCHED_FIFO thread woken by the timer */
+	struct task_struct *worker;	/* thread reading the features */
+	struct completion done;		/* worker finished */
+	int idle;			/* baseline pass */
+	u32 op[OMNIBOOK_STALL_KINDS];	/* worst since the last operation */
+	u32 read[OMNIBOOK_STALL_KINDS];	/* worst since the start of the read */
+
+	/* Results */
+	unsigned int reads;
+	unsigned int cpu;
+	struct omnibook_stall_max baseline;
+	struct omnibook_stall_max backend[OMNIBOOK_STALL_BACKENDS][OMNIBOOK_HIST_TYPES];
+	struct omnibook_stall_max feature[ARRAY_SIZE(omnibook_stall_features)];
+} omnibook_stall;
+
+static void omnibook_stall_max(struct omnibook_stall_max *max, const u32 *sample)
+{
+	int i;
+
+	max->count++;
+	for (i = 0; i < OMNIBOOK_STALL_KINDS; i++)
+		if (sample[i] > max->max[i])
+			max->max[i] = sample[i];
+}
+
+static void omnibook_stall_sample(int kind, ktime_t late)
+{
+	s64 ns = ktime_to_ns(late);
+	unsigned long flags;
+	u32 sample;
+
+	sample = ns < 0 ? 0 : min_t(s64, ns, ~0U);
+	spin_lock_irqsave(&omnibook_stall_lock, flags);
+	if (omnibook_stall.idle) {
+		omnibook_stall.baseline.count += kind == OMNIBOOK_STALL_SCHED;
+		omnibook_stall.baseline.max[kind] = max(omnibook_stall.baseline.max[kind], sample);
+	}
+	omnibook_stall.op[kind] = max(omnibook_stall.op[kind], sample);
+	omnibook_stall.read[kind] = max(omnibook_stall.read[kind], sample);
+	spin_unlock_irqrestore(&omnibook_stall_lock, flags);
+}
+
+/*
+ * Called as an operation of the worker completes, see omnibook_histogram_add
+ */
+void __omnibook_stall_op(struct omnibook_backend *backend, enum omnibook_hist_type type)
+{
+	unsigned long flags;
+	int i;
+
+	if (current != omnibook_stall.worker)
+		return;
+	for (i = 0; i < OMNIBOOK_STALL_BACKENDS && omnibook_backends[i]; i++)
+		if (omnibook_backends[i] == backend)
+			break;
+	if (i == OMNIBOOK_STALL_BACKENDS || !omnibook_backends[i])
+		return;
+
+	spin_lock_irqsave(&omnibook_stall_lock, flags);
+	omnibook_stall_max(&omnibook_stall.backend[i][type], omnibook_stall.op);
+	memset(omnibook_stall.op, 0, sizeof(omnibook_stall.op));
+	spin_unlock_irqrestore(&omnibook_stall_lock, flags);
+}
+
+static enum hrtimer_restart omnibook_stall_timer(struct hrtimer *timer)
+{
+	omnibook_stall_sample(OMNIBOOK_STALL_IRQ, ktime_sub(ktime_get(), omnibook_stall.expires));
+	wake_up_process(omnibook_stall.measure);
+	return HRTIMER_NORESTART;
+}
+
+static int omnibook_stall_measure(void *data)
+{
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+	ktime_t expires;
+
+	sched_setscheduler(current, SCHED_FIFO, &param);
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		expires = ktime_add_ns(ktime_get(), omnibook_stall_period * NSEC_PER_USEC);
+		omnibook_stall.expires = expires;
+		hrtimer_start(&omnibook_stall.timer, expires, OMNIBOOK_STALL_MODE);
+		schedule();
+		omnibook_stall_sample(OMNIBOOK_STALL_SCHED, ktime_sub(ktime_get(), expires));
+	}
+	hrtimer_cancel(&omnibook_stall.timer);
+	return 0;
+}
+
+static int omnibook_stall_worker(void *data)
+{
+	struct omnibook_feature *feature;
+	struct seq_file m;		/* a procfs read, without the file */
+	unsigned long flags;
+	unsigned int i, n;
+
+	memset(&m, 0, sizeof(m));
+	m.buf = data;
+	m.size = PAGE_SIZE;
+
+	msleep(OMNIBOOK_STALL_IDLE);
+	spin_lock_irqsave(&omnibook_stall_lock, flags);
+	omnibook_stall.idle = 0;
+	memset(omnibook_stall.op, 0, sizeof(omnibook_stall.op));
+	spin_unlock_irqrestore(&omnibook_stall_lock, flags);
+
+	for (i = 0; i < ARRAY_SIZE(omnibook_stall_features); i++) {
+		feature = omnibook_find_feature((char *) omnibook_stall_features[i]);
+		if (!feature || !feature->read)
+			continue;
+		for (n = 0; n < omnibook_stall.reads; n++) {
+			spin_lock_irqsave(&omnibook_stall_lock, flags);
+			memset(omnibook_stall.read, 0, sizeof(omnibook_stall.read));
+			spin_unlock_irqrestore(&omnibook_stall_lock, flags);
+
+			m.count = 0;
+			feature->read(&m, feature->io_op);
+
+			spin_lock_irqsave(&omnibook_stall_lock, flags);
+			omnibook_stall_max(&omnibook_stall.feature[i], omnibook_stall.read);
+			spin_unlock_irqrestore(&omnibook_stall_lock, flags);
+			cond_resched();
+		}
+	}
+
+	complete(&omnibook_stall.done);
+	return 0;
+}
+
+/*
+ * Run the benchmark, results replace those of the previous run
+ */
+int omnibook_stall_run(unsigned int reads, unsigned int cpu)
+{
+	struct task_struct *measure, *worker;
+	unsigned long flags;
+	char *page;
+	int retval = 0;
+
+	if (cpu >= NR_CPUS || !cpu_online(cpu))
+		return -EINVAL;
+	page = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!page)
+		return -ENOMEM;
+
+	mutex_lock(&omnibook_stall_mutex);
+	omnibook_stall.worker = NULL;
+	memset(omnibook_stall.op, 0, sizeof(omnibook_stall.op));
+	memset(&omnibook_stall.baseline, 0, sizeof(omnibook_stall.baseline));
+	memset(omnibook_stall.backend, 0, sizeof(omnibook_stall.backend));
+	memset(omnibook_stall.feature, 0, sizeof(omnibook_stall.feature));
+	omnibook_stall.reads = reads;
+	omnibook_stall.cpu = cpu;
+	omnibook_stall.idle = 1;
+	init_completion(&omnibook_stall.done);
+	hrtimer_init(&omnibook_stall.timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	omnibook_stall.timer.function = omnibook_stall_timer;
+
+	measure = kthread_create(omnibook_stall_measure, NULL, "omnibook-stall/%u", cpu);
+	if (IS_ERR(measure)) {
+		retval = PTR_ERR(measure);
+		goto out;
+	}
+	worker = kthread_create(omnibook_stall_worker, page, "omnibook-bench/%u", cpu);
+	if (IS_ERR(worker)) {
+		retval = PTR_ERR(worker);
+		kthread_stop(measure);
+		goto out;
+	}
+	kthread_bind(measure, cpu);
+	kthread_bind(worker, cpu);
+	omnibook_stall.measure = measure;
+	/*
+	 * The worker exits on its own: hold it so that its task_struct is not
+	 * reused by another task __omnibook_stall_op would then account
+	 */
+	get_task_struct(worker);
+	omnibook_stall.worker = worker;
+
+	omnibook_stalling = 1;
+	wake_up_process(measure);
+	wake_up_process(worker);
+	wait_for_completion(&omnibook_stall.done);
+	omnibook_stalling = 0;
+	kthread_stop(measure);
+
+	spin_lock_irqsave(&omnibook_stall_lock, flags);
+	omnibook_stall.worker = NULL;
+	spin_unlock_irqrestore(&omnibook_stall_lock, flags);
+	put_task_struct(worker);
+
+      out:
+	mutex_unlock(&omnibook_stall_mutex);
+	kfree(page);
+	return retval;
+}
+
+static void omnibook_stall_show_max(struct seq_file *m, const struct omnibook_stall_max *max)
+{
+	seq_printf(m, " %10lu %10u %10u\n", max->count, max->max[OMNIBOOK_STALL_IRQ],
+		   max->max[OMNIBOOK_STALL_SCHED]);
+}
+
+int omnibook_stall_show(struct seq_file *m, void *v)
+{
+	int i, j;
+
+	mutex_lock(&omnibook_stall_mutex);
+	if (!omnibook_stall.reads) {
+		seq_printf(m, "No run yet, write <reads> [<cpu>] to start one.\n");
+		goto out;
+	}
+
+	seq_printf(m, "cpu %u, timer every %u us, %u reads per feature\n", omnibook_stall.cpu,
+		   omnibook_stall_period, omnibook_stall.reads);
+	seq_printf(m, "%-24s %10s %10s %10s\n", "", "count", "irq ns", "sched ns");
+	seq_printf(m, "%-24s", "baseline (idle)");
+	omnibook_stall_show_max(m, &omnibook_stall.baseline);
+
+	for (i = 0; i < OMNIBOOK_STALL_BACKENDS && omnibook_backends[i]; i++) {
+		for (j = 0; j < OMNIBOOK_HIST_TYPES; j++) {
+			if (!omnibook_stall.backend[i][j].count)
+				continue;
+			seq_printf(m, "%-8s %-15s", omnibook_backends[i]->name, omnibook_hist_name[j]);
+			omnibook_stall_show_max(m, &omnibook_stall.backend[i][j]);
+		}
+	}
+	for (i = 0; i < ARRAY_SIZE(omnibook_stall_features); i++) {
+		if (!omnibook_stall.feature[i].count)
+			continue;
+		seq_printf(m, "%-8s %-15s", "feature", omnibook_stall_features[i]);
+		omnibook_stall_show_max(m, &omnibook_stall.feature[i]);
+	}
+
+      out:
+	mutex_unlock(&omnibook_stall_mutex);
+	return 0;
+}
+
+static int omnibook_stall_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omnibook_stall_show, inode->i_private);
+}
+
+static ssize_t omnibook_stall_write(struct file *file, const char __user *buf, size_t count,
+				    loff_t *ppos)
+{
+	char tmp[32];
+	unsigned long reads;
+	unsigned int cpu = 0;
+	char *endp;
+	int retval;
+
+	if (count > sizeof(tmp) - 1)
+		return -EINVAL;
+	if (copy_from_user(tmp, buf, count))
+		return -EFAULT;
+	tmp[count] = 0;
+
+	reads = simple_strtoul(tmp, &endp, 0);
+	if (*endp == ' ')
+		cpu = simple_strtoul(endp + 1, NULL, 0);
+	if (!reads || reads > 100000)
+		return -EINVAL;
+	retval = omnibook_stall_run(reads, cpu);
+	return retval ? retval : count;
+}
+
+static const struct file_operations omnibook_stall_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_stall_open,
+	.read = seq_read,
+	.write = omnibook_stall_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+void omnibook_stall_debugfs(void)
+{
+	omnibook_debugfs_file(NULL, "stall", S_IRUSR | S_IWUSR, &omnibook_stall_fops);
+}
+
+module_param_named(stall_period, omnibook_stall_period, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(stall_period, "Timer period in us of the stall benchmark, see debugfs omnibook/stall");
+
+/* End of file */
@@ -0,0 +1,324 @@
+/*
+ * telemetry.c -- /dev/omnibook, binary snapshot of the features
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/fs.h>
+#include <linux/jiffies.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
+#include <asm/io.h>
+#include <asm/uaccess.h>
+#include "hardware.h"
+
+/*
+ * A snapshot is taken in one pass per backend: its mutex is taken once
+ * and the telemetry function of each of its features, see struct
+ * omnibook_feature, is called with it held. Features are those below,
+ * the ones worth sampling; see omnibook_telemetry.h for the layout.
+ */
+
+static const struct {
+	const char *name;
+	u32 valid;		/* OMNIBOOK_TM_* bit it fills */
+} omnibook_telemetry_features[] = {
+	{ "temperature", OMNIBOOK_TM_TEMPERATURE },
+	{ "fan", OMNIBOOK_TM_FAN },
+	{ "ac", OMNIBOOK_TM_AC },
+	{ "battery", OMNIBOOK_TM_BATTERY },
+	{ "lcd", OMNIBOOK_TM_LCD },
+	{ "display", OMNIBOOK_TM_DISPLAY },
+	{ "wifi", OMNIBOOK_TM_WIFI },
+	{ "bluetooth", OMNIBOOK_TM_BLUETOOTH },
+	{ "dock", OMNIBOOK_TM_DOCK },
+};
+
+/*
+ * Fill t with the features whose OMNIBOOK_TM_* bit is in mask, return 0
+ * or -ERESTARTSYS if interrupted waiting for a backend. Every snapshot is
+ * also checked for changes, see notify.c and events.c
+ */
+int omnibook_telemetry_sample(struct omnibook_telemetry *t, u32 mask)
+{
+	struct omnibook_feature *feature;
+	struct omnibook_backend *backend;
+	int i, j, locked;
+
+	memset(t, 0, sizeof(struct omnibook_telemetry));
+	t->version = OMNIBOOK_TELEMETRY_VERSION;
+	t->size = sizeof(struct omnibook_telemetry);
+	t->ectype = omnibook_ectype;
+	t->timestamp = ktime_to_ns(ktime_get());
+
+	for (i = 0; (backend = omnibook_backends[i]); i++) {
+		locked = 0;
+		for (j = 0; j < ARRAY_SIZE(omnibook_telemetry_features); j++) {
+			if (!(omnibook_telemetry_features[j].valid & mask))
+				continue;
+			feature = omnibook_find_feature((char *) omnibook_telemetry_features[j].name);
+			if (!feature || !feature->telemetry || !feature->io_op ||
+			    feature->io_op->backend != backend)
+				continue;
+			if (!locked) {
+				if (omnibook_backend_lock_interruptible(backend, "telemetry"))
+					return -ERESTARTSYS;
+				locked = 1;
+			}
+			feature->telemetry(t, feature->io_op);
+		}
+		if (locked)
+			omnibook_backend_unlock(backend);
+	}
+
+	omnibook_notify_update(t);
+	omnibook_event_telemetry(t);
+	return 0;
+}
+
+int omnibook_telemetry_snapshot(struct omnibook_telemetry *t)
+{
+	return omnibook_telemetry_sample(t, ~0U);
+}
+
+/*
+ * OMNIBOOK_TM_* bits a snapshot can fill on this model
+ */
+u32 omnibook_telemetry_available(void)
+{
+	struct omnibook_feature *feature;
+	u32 mask = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(omnibook_telemetry_features); i++) {
+		feature = omnibook_find_feature((char *) omnibook_telemetry_features[i].name);
+		if (feature && feature->telemetry)
+			mask |= omnibook_telemetry_features[i].valid;
+	}
+	return mask;
+}
+
+/*
+ * Shared page: written by omnibook_telemetry_refresh only, under
+ * refresh_mutex, while mapped and not suspended. Mappings are counted
+ * under map_mutex, the sampler runs from the first to the last one.
+ */
+
+static struct omnibook_telemetry_page *omnibook_telemetry_page;
+static unsigned int omnibook_telemetry_interval = 1000;	/* ms */
+static unsigned int omnibook_telemetry_maps;
+static int omnibook_telemetry_suspended;
+static DEFINE_MUTEX(refresh_mutex);
+static DEFINE_MUTEX(map_mutex);
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+static void omnibook_telemetry_sampler(struct work_struct *work);
+static DECLARE_DELAYED_WORK(omnibook_telemetry_work, omnibook_telemetry_sampler);
+#else
+static void omnibook_telemetry_sampler(void *data);
+static DECLARE_WORK(omnibook_telemetry_work, omnibook_telemetry_sampler, NULL);
+#endif
+
+/* Refresh period, ms */
+static unsigned int omnibook_telemetry_period(void)
+{
+	return max(omnibook_telemetry_interval, 10U);
+}
+
+static unsigned long omnibook_telemetry_delay(void)
+{
+	return msecs_to_jiffies(omnibook_telemetry_period());
+}
+
+/*
+ * Snapshot aside, then copy it to the page between two seq increments:
+ * readers only ever retry for the duration of the memcpy
+ */
+static void omnibook_telemetry_refresh(void)
+{
+	struct omnibook_telemetry_page *page = omnibook_telemetry_page;
+	struct omnibook_telemetry t;
+
+	mutex_lock(&refresh_mutex);
+	if (omnibook_telemetry_snapshot(&t))
+		goto out;
+	page->seq++;
+	smp_wmb();
+	page->interval = omnibook_telemetry_period();
+	memcpy(&page->telemetry, &t, sizeof(t));
+	smp_wmb();
+	page->seq++;
+      out:
+	mutex_unlock(&refresh_mutex);
+}
+
+#if (LINUX_VERSION_CODE > KERNEL_VERSION(2,6,19))
+static void omnibook_telemetry_sampler(struct work_struct *work)
+#else
+static void omnibook_telemetry_sampler(void *data)
+#endif
+{
+	omnibook_telemetry_refresh();
+	schedule_delayed_work(&omnibook_telemetry_work, omnibook_telemetry_delay());
+}
+
+/* map_mutex held */
+static void omnibook_telemetry_sampler_stop(void)
+{
+#ifdef OLD_WORKQUEUE_COMPAT
+	cancel_rearming_delayed_work(&omnibook_telemetry_work);
+#else
+	cancel_delayed_work_sync(&omnibook_telemetry_work);
+#endif
+}
+
+static void omnibook_telemetry_vm_open(struct vm_area_struct *vma)
+{
+	mutex_lock(&map_mutex);
+	if (!omnibook_telemetry_maps++ && !omnibook_telemetry_suspended)
+		schedule_delayed_work(&omnibook_telemetry_work, omnibook_telemetry_delay());
+	mutex_unlock(&map_mutex);
+}
+
+static void omnibook_telemetry_vm_close(struct vm_area_struct *vma)
+{
+	mutex_lock(&map_mutex);
+	if (!--omnibook_telemetry_maps && !omnibook_telemetry_suspended)
+		omnibook_telemetry_sampler_stop();
+	mutex_unlock(&map_mutex);
+}
+
+static struct vm_operations_struct omnibook_telemetry_vm_ops = {
+	.open = omnibook_telemetry_vm_open,
+	.close = omnibook_telemetry_vm_close,
+};
+
+/*
+ * Map the page read-only, filled at once so that a reader never has to
+ * wait an interval for its first sample
+ */
+static int omnibook_telemetry_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	int retval;
+
+	if (!omnibook_telemetry_page)
+		return -ENOMEM;
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start > PAGE_SIZE)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	retval = remap_pfn_range(vma, vma->vm_start,
+				 virt_to_phys(omnibook_telemetry_page) >> PAGE_SHIFT,
+				 vma->vm_end - vma->vm_start, vma->vm_page_prot);
+	if (retval)
+		return retval;
+
+	omnibook_telemetry_refresh();
+	vma->vm_ops = &omnibook_telemetry_vm_ops;
+	omnibook_telemetry_vm_open(vma);
+	return 0;
+}
+
+/*
+ * No EC access across a suspend: the sampler is stopped and restarted
+ */
+void omnibook_telemetry_suspend(void)
+{
+	mutex_lock(&map_mutex);
+	if (omnibook_telemetry_maps)
+		omnibook_telemetry_sampler_stop();
+	omnibook_telemetry_suspended = 1;
+	mutex_unlock(&map_mutex);
+}
+
+void omnibook_telemetry_resume(void)
+{
+	mutex_lock(&map_mutex);
+	omnibook_telemetry_suspended = 0;
+	if (omnibook_telemetry_maps)
+		schedule_delayed_work(&omnibook_telemetry_work, 0);
+	mutex_unlock(&map_mutex);
+}
+
+static long omnibook_telemetry_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct omnibook_telemetry t;
+	int retval;
+
+	if (cmd != OMNIBOOK_IOC_TELEMETRY)
+		return -ENOTTY;
+
+	retval = omnibook_telemetry_snapshot(&t);
+	if (retval)
+		return retval;
+	if (copy_to_user((void __user *) arg, &t, sizeof(t)))
+		return -EFAULT;
+	return 0;
+}
+
+static const struct file_operations omnibook_telemetry_fops = {
+	.owner = THIS_MODULE,
+	.unlocked_ioctl = omnibook_telemetry_ioctl,
+	.compat_ioctl = omnibook_telemetry_ioctl,
+	.mmap = omnibook_telemetry_mmap,
+};
+
+static struct miscdevice omnibook_telemetry_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = OMNIBOOK_MODULE_NAME,
+	.fops = &omnibook_telemetry_fops,
+};
+
+static int omnibook_telemetry_registered;
+
+/*
+ * Not fatal: procfs gives the same values
+ */
+void omnibook_telemetry_init(void)
+{
+	omnibook_telemetry_page = (void *) get_zeroed_page(GFP_KERNEL);
+	if (omnibook_telemetry_page)
+		SetPageReserved(virt_to_page(omnibook_telemetry_page));
+	else
+		printk(O_WARN "Unable to allocate the telemetry page, mmap unavailable.\n");
+
+	if (misc_register(&omnibook_telemetry_dev))
+		printk(O_WARN "Unable to register /dev/%s, telemetry unavailable.\n",
+		       OMNIBOOK_MODULE_NAME);
+	else
+		omnibook_telemetry_registered = 1;
+}
+
+/*
+ * Mappings hold a reference on the module: none is left here
+ */
+void omnibook_telemetry_exit(void)
+{
+	if (omnibook_telemetry_registered)
+		misc_deregister(&omnibook_telemetry_dev);
+	omnibook_telemetry_registered = 0;
+
+	if (omnibook_telemetry_page) {
+		ClearPageReserved(virt_to_page(omnibook_telemetry_page));
+		free_page((unsigned long) omnibook_telemetry_page);
+	}
+	omnibook_telemetry_page = NULL;
+}
+
+module_param_named(telemetry_interval, omnibook_telemetry_interval, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(telemetry_interval, "Refresh period in ms of the /dev/omnibook mmap page (10 or more)");
+
+/* End of file */
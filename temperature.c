@@ -18,18 +18,17 @@
 #include "omnibook.h"
 #include "hardware.h"
 
-static int omnibook_temperature_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_temperature_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	int retval;
 	u8 temp;
 
 	if ((retval = backend_byte_read(io_op, &temp)))
 		return retval;
 
-	len += sprintf(buffer + len, "CPU temperature:            %2d C\n", temp);
+	seq_printf(m, "CPU temperature:            %2d C\n", temp);
 
-	return len;
+	return 0;
 }
 
 static struct omnibook_tbl temp_table[] __initdata = {
@@ -40,10 +39,23 @@ static struct omnibook_tbl temp_table[] __initdata = {
 	{0,}
 };
 
+static int omnibook_temperature_telemetry(struct omnibook_telemetry *t,
+					  struct omnibook_operation *io_op)
+{
+	u8 temp;
+
+	if (__backend_byte_read(io_op, &temp))
+		return -EIO;
+	t->temperature = temp;
+	t->valid |= OMNIBOOK_TM_TEMPERATURE;
+	return 0;
+}
+
 static struct omnibook_feature __declared_feature temperature_driver = {
 	.name = "temperature",
 	.enabled = 1,
 	.read = omnibook_temperature_read,
+	.telemetry = omnibook_temperature_telemetry,
 	.ectypes =
 	    XE3GF | XE3GC | OB500 | OB510 | OB6000 | OB6100 | XE4500 | OB4150 | XE2 | AMILOD | TSP10
 	    | TSM70 | TSM30X | TSX205,
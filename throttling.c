@@ -24,27 +24,24 @@
  */
 static const int trate[8] = { 0, 12, 25, 37, 50, 62, 75, 87 };
 
-static int omnibook_throttle_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_throttle_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
-	int tstate = 0;
+	unsigned int tstate = 0;
 	int retval, i;
 
 	retval = backend_throttle_get(io_op, &tstate);
 	if (retval < 0)
 		return retval;
 
-	len += sprintf(buffer + len, "state count:             8\n");
-        len += sprintf(buffer + len, "active state:            T%d\n", tstate);
+	seq_printf(m, "state count:             8\n");
+        seq_printf(m, "active state:            T%u\n", tstate);
 	for (i = 0; i < 8; i += 1)
 	{
-		len += sprintf(buffer + len, "   %cT%d:                  %02d%%\n",
-			(i == tstate ? '*' : ' '),
-			i,
-			trate[i]);
+		seq_printf(m, "   %cT%d:                  %02d%%\n", (i == tstate ? '*' : ' '), i,
+			   trate[i]);
 	}
 
-	return len;
+	return 0;
 }
 
 static int omnibook_throttle_write(char *buffer, struct omnibook_operation *io_op)
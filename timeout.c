@@ -0,0 +1,245 @@
+/*
+ * timeout.c -- adaptive backend timeouts
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include "omnibook.h"
+
+#include <linux/sort.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include "hardware.h"
+
+/*
+ * Every wait on the hardware records how long it took. Once enough samples
+ * were seen the timeout of a backend becomes OMNIBOOK_TIMEOUT_MULT times the
+ * 99th percentile of the recent ones, clamped between OMNIBOOK_TIMEOUT_FLOOR
+ * and the worst case budget of the caller. A wedged controller thus stalls
+ * its callers for a few ms instead of the full budget.
+ *
+ * A wait running past a learned timeout is recorded as a sample of that
+ * length, so that a controller slower than what was learned raises the
+ * timeout, and goes on until the ceiling: a healthy but slow controller
+ * never fails. Only once a wait ran out at the ceiling is the controller
+ * believed wedged, its next waits then fail at the learned timeout until
+ * one succeeds. The samples are dropped on resume and relearned.
+ */
+
+/* Samples needed before the learned timeout is trusted */
+#define OMNIBOOK_LATENCY_MIN_SAMPLES	32
+
+/* Estimation is redone every that many new samples */
+#define OMNIBOOK_LATENCY_REFRESH	16
+
+static int omnibook_adaptive_timeout = 1;
+
+static int omnibook_latency_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *) a;
+	u32 y = *(const u32 *) b;
+
+	if (x < y)
+		return -1;
+	return x > y;
+}
+
+/*
+ * Compute percentiles and the resulting timeout, called with lock held
+ */
+static void omnibook_latency_estimate(struct omnibook_latency *lat)
+{
+	u64 timeout;
+
+	memcpy(lat->sorted, lat->samples, lat->count * sizeof(u32));
+	sort(lat->sorted, lat->count, sizeof(u32), omnibook_latency_cmp, NULL);
+
+	lat->p50 = lat->sorted[lat->count / 2];
+	lat->p99 = lat->sorted[(lat->count * 99) / 100];
+	lat->fresh = 0;
+
+	timeout = (u64) lat->p99 * OMNIBOOK_TIMEOUT_MULT;
+	if (timeout < OMNIBOOK_TIMEOUT_FLOOR)
+		timeout = OMNIBOOK_TIMEOUT_FLOOR;
+	if (timeout > OMNIBOOK_TIMEOUT * 1000)
+		timeout = OMNIBOOK_TIMEOUT * 1000;
+	lat->learned = timeout;
+}
+
+/*
+ * Add a sample of us, called with lock held
+ */
+static void omnibook_latency_sample(struct omnibook_latency *lat, s64 us)
+{
+	lat->samples[lat->head] = min_t(s64, us, OMNIBOOK_TIMEOUT * 1000);
+	lat->head = (lat->head + 1) % OMNIBOOK_LATENCY_SAMPLES;
+	if (lat->count < OMNIBOOK_LATENCY_SAMPLES)
+		lat->count++;
+	if (++lat->fresh >= OMNIBOOK_LATENCY_REFRESH &&
+	    lat->count >= OMNIBOOK_LATENCY_MIN_SAMPLES)
+		omnibook_latency_estimate(lat);
+}
+
+/*
+ * Record the duration of a successful wait started at start
+ * Can be called from atomic context
+ */
+void omnibook_latency_add(struct omnibook_backend *backend, ktime_t start)
+{
+	struct omnibook_latency *lat = &backend->latency;
+	unsigned long flags;
+	s64 delta;
+
+	delta = ktime_to_us(ktime_sub(ktime_get(), start));
+	if (delta < 0)
+		delta = 0;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	omnibook_latency_sample(lat, delta);
+	lat->wedged = 0;
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
+/*
+ * Account a wait which ran for timeout us without an answer. Return the
+ * timeout in us to keep waiting to, the ceiling, or 0 if the wait fails.
+ * Can be called from atomic context
+ */
+unsigned int omnibook_latency_expired(struct omnibook_backend *backend, unsigned int timeout,
+				      unsigned int ceiling)
+{
+	struct omnibook_latency *lat = &backend->latency;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	lat->expired++;
+	omnibook_latency_sample(lat, timeout);
+	if (timeout < ceiling && !lat->wedged)
+		timeout = ceiling;
+	else {
+		lat->wedged = 1;
+		timeout = 0;
+	}
+	spin_unlock_irqrestore(&lat->lock, flags);
+
+	return timeout;
+}
+
+/*
+ * Return the timeout in us to use for a wait whose worst case budget is
+ * ceiling us.
+ */
+unsigned int omnibook_timeout(struct omnibook_backend *backend, unsigned int ceiling)
+{
+	struct omnibook_latency *lat = &backend->latency;
+	unsigned long flags;
+	unsigned int timeout = ceiling;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	if (omnibook_adaptive_timeout && lat->learned)
+		timeout = min(lat->learned, ceiling);
+	lat->last = timeout;
+	spin_unlock_irqrestore(&lat->lock, flags);
+
+	return timeout;
+}
+
+/*
+ * Forget what was learned, e.g. after resume the controller may behave
+ * differently.
+ */
+void omnibook_latency_reset(struct omnibook_backend *backend)
+{
+	struct omnibook_latency *lat = &backend->latency;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	lat->head = 0;
+	lat->count = 0;
+	lat->fresh = 0;
+	lat->p50 = 0;
+	lat->p99 = 0;
+	lat->learned = 0;
+	lat->wedged = 0;
+	spin_unlock_irqrestore(&lat->lock, flags);
+}
+
+void omnibook_latency_init(struct omnibook_backend *backend)
+{
+	memset(&backend->latency, 0, sizeof(struct omnibook_latency));
+	spin_lock_init(&backend->latency.lock);
+}
+
+static int omnibook_latency_show(struct seq_file *m, void *v)
+{
+	struct omnibook_backend *backend = m->private;
+	struct omnibook_latency *lat = &backend->latency;
+	unsigned int count, learned, last;
+	unsigned long expired;
+	int wedged;
+	u32 p50, p99;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat->lock, flags);
+	count = lat->count;
+	p50 = lat->p50;
+	p99 = lat->p99;
+	learned = lat->learned;
+	last = lat->last;
+	expired = lat->expired;
+	wedged = lat->wedged;
+	spin_unlock_irqrestore(&lat->lock, flags);
+
+	seq_printf(m, "adaptive:\t%s\n", omnibook_adaptive_timeout ? "yes" : "no");
+	seq_printf(m, "samples:\t%u\n", count);
+	seq_printf(m, "p50:\t\t%u us\n", p50);
+	seq_printf(m, "p99:\t\t%u us\n", p99);
+	if (learned)
+		seq_printf(m, "learned:\t%u us\n", learned);
+	else
+		seq_printf(m, "learned:\tnot yet\n");
+	seq_printf(m, "last timeout:\t%u us\n", last);
+	seq_printf(m, "floor:\t\t%u us\n", OMNIBOOK_TIMEOUT_FLOOR);
+	seq_printf(m, "expired:\t%lu\n", expired);
+	seq_printf(m, "wedged:\t\t%s\n", wedged ? "yes" : "no");
+
+	return 0;
+}
+
+static int omnibook_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, omnibook_latency_show, inode->i_private);
+}
+
+static const struct file_operations omnibook_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = omnibook_latency_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Expose the timeout of a backend once it is in use
+ * Called from probe, a backend can be matched by several features.
+ */
+void omnibook_latency_debugfs(struct omnibook_backend *backend)
+{
+	if (backend->latency.dentry)
+		return;
+	backend->latency.dentry = omnibook_debugfs_file(backend, "timeout", S_IRUGO,
+							&omnibook_latency_fops);
+}
+
+module_param_named(adaptive_timeout, omnibook_adaptive_timeout, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adaptive_timeout, "Use 0 to always wait the worst case time for the hardware, 1 to learn timeouts from observed latency");
+
+/* End of file */
@@ -22,7 +22,7 @@ static int omnibook_touchpad_set(struct omnibook_operation *io_op, int status)
 {
 	int retval = 0;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
 	if ((retval = __omnibook_toggle(io_op, !!status))) {
@@ -33,7 +33,7 @@ static int omnibook_touchpad_set(struct omnibook_operation *io_op, int status)
 	io_op->backend->touchpad_state = !!status;
 
 	out:
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
@@ -43,28 +43,26 @@ static int omnibook_touchpad_set(struct omnibook_operation *io_op, int status)
 static int omnibook_touchpad_resume(struct omnibook_operation *io_op)
 {
 	int retval;
-	mutex_lock(&io_op->backend->mutex);
+	omnibook_op_lock(io_op);
 	retval = __omnibook_toggle(io_op, !!io_op->backend->touchpad_state);
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
 /*
  * Hardware query is unsupported, so reading is unreliable.
  */
-static int omnibook_touchpad_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_touchpad_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;
 
-	len +=
-	    sprintf(buffer + len, "Last touchpad action was an %s command.\n",
-		    io_op->backend->touchpad_state ? "enable" : "disable");
+	seq_printf(m, "Last touchpad action was an %s command.\n",
+		   io_op->backend->touchpad_state ? "enable" : "disable");
 
-	mutex_unlock(&io_op->backend->mutex);
-	return len;
+	omnibook_op_unlock(io_op);
+	return 0;
 }
 
 static int omnibook_touchpad_write(char *buffer, struct omnibook_operation *io_op)
@@ -85,10 +83,10 @@ static int omnibook_touchpad_write(char *buffer, struct omnibook_operation *io_o
 
 static int __init omnibook_touchpad_init(struct omnibook_operation *io_op)
 {
-	mutex_lock(&io_op->backend->mutex);
+	omnibook_op_lock(io_op);
 	/* Touchpad is assumed to be enabled by default */
 	io_op->backend->touchpad_state = 1;
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return 0;
 }
 
@@ -0,0 +1,20 @@
+/*
+ * trace.c -- instantiate the tracepoints of omnibook_trace.h
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#define CREATE_TRACE_POINTS
+
+#include "omnibook.h"
+#include "hardware.h"
+
+/* End of file */
@@ -18,25 +18,21 @@
 #include "omnibook.h"
 #include "hardware.h"
 
-static int omnibook_wifi_read(char *buffer, struct omnibook_operation *io_op)
+static int omnibook_wifi_read(struct seq_file *m, struct omnibook_operation *io_op)
 {
-	int len = 0;
 	int retval;
 	unsigned int state;
 
 	if ((retval = backend_aerial_get(io_op, &state)))
 		return retval;
 
-	len +=
-	    sprintf(buffer + len, "Wifi adapter is %s", (state & WIFI_EX) ? "present" : "absent");
+	seq_printf(m, "Wifi adapter is %s", (state & WIFI_EX) ? "present" : "absent");
 	if (state & WIFI_EX)
-		len +=
-		    sprintf(buffer + len, " and %s", (state & WIFI_STA) ? "enabled" : "disabled");
-	len += sprintf(buffer + len, ".\n");
-	len +=
-	    sprintf(buffer + len, "Wifi Kill switch is %s.\n", (state & KILLSWITCH) ? "on" : "off");
+		seq_printf(m, " and %s", (state & WIFI_STA) ? "enabled" : "disabled");
+	seq_printf(m, ".\n");
+	seq_printf(m, "Wifi Kill switch is %s.\n", (state & KILLSWITCH) ? "on" : "off");
 
-	return len;
+	return 0;
 
 }
 
@@ -45,7 +41,7 @@ static int omnibook_wifi_write(char *buffer, struct omnibook_operation *io_op)
 	int retval = 0;
 	unsigned int state;
 
-	if(mutex_lock_interruptible(&io_op->backend->mutex))
+	if(omnibook_op_lock_interruptible(io_op))
 		return -ERESTARTSYS;	
 
 	if ((retval = __backend_aerial_get(io_op, &state)))
@@ -64,7 +60,7 @@ static int omnibook_wifi_write(char *buffer, struct omnibook_operation *io_op)
 		return retval;
 
 	out:		
-	mutex_unlock(&io_op->backend->mutex);
+	omnibook_op_unlock(io_op);
 	return retval;
 }
 
@@ -94,11 +90,24 @@ static struct omnibook_tbl wireless_table[] __initdata = {
 	{0,}
 };
 
+static int omnibook_wifi_telemetry(struct omnibook_telemetry *t, struct omnibook_operation *io_op)
+{
+	unsigned int state;
+	int retval;
+
+	if ((retval = __backend_aerial_get(io_op, &state)))
+		return retval;
+	t->wifi = state & (WIFI_EX | WIFI_STA | KILLSWITCH);
+	t->valid |= OMNIBOOK_TM_WIFI;
+	return 0;
+}
+
 static struct omnibook_feature __declared_feature wifi_driver = {
 	.name = "wifi",
 	.enabled = 1,
 	.read = omnibook_wifi_read,
 	.write = omnibook_wifi_write,
+	.telemetry = omnibook_wifi_telemetry,
 	.init = omnibook_wifi_init,
 	.ectypes = TSM70 | TSM40 | TSX205,
 	.tbl = wireless_table,